@@ -0,0 +1,370 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "format.h"
+#include "qasm.h"
+#include "qsim.h"
+
+// Performance suite for the gate kernels, fused circuits, result sampling, parsing and whole example programs. Each
+// benchmark is repeated until it has run for a minimum time, and the averages are written as JSON for tracking between
+// builds.
+
+struct Benchmark_Result
+{
+	std::string name;
+	uint64_t iterations;
+	double seconds_per_iteration;
+	std::vector<std::pair<std::string, double>> counters;
+};
+
+struct Benchmark_Options
+{
+	size_t num_threads = 1;
+	Precision precision = Precision::DOUBLE;
+	Representation representation = Representation::FULL;
+	size_t cache_block_qbits = DEFAULT_CACHE_BLOCK_QBITS;
+	size_t max_qbits = 20;
+	double min_seconds = 0.2;
+	std::string filter;
+};
+
+using clock_type = std::chrono::steady_clock;
+
+// Repeats body, which returns the time it spent on the work being measured, until the total measured time reaches
+// the minimum.
+static Benchmark_Result measure(Benchmark_Options const &options, std::string const &name,
+                                std::function<double()> const &body)
+{
+	uint64_t iterations = 0;
+	double total_seconds = 0.0;
+	while (total_seconds < options.min_seconds || iterations < 3) {
+		total_seconds += body();
+		iterations += 1;
+	}
+	return { name, iterations, total_seconds / (double)iterations, {} };
+}
+
+static double seconds_since(clock_type::time_point start)
+{
+	return std::chrono::duration<double>(clock_type::now() - start).count();
+}
+
+static std::string gate_source(Gate gate, size_t qbit, size_t num_qbits)
+{
+	auto operand = [&](size_t offset) { return " q" + std::to_string((qbit + offset) % num_qbits); };
+	switch (gate) {
+		case Gate::CNOT: return "cnot" + operand(0) + operand(1);
+		case Gate::IDENTITY: return "i" + operand(0);
+		case Gate::HADAMARD: return "h" + operand(0);
+		case Gate::PAULI_X: return "x" + operand(0);
+		case Gate::PAULI_Y: return "y" + operand(0);
+		case Gate::PAULI_Z: return "z" + operand(0);
+		case Gate::R_X: return "rx" + operand(0) + " 0.3";
+		case Gate::R_Y: return "ry" + operand(0) + " 0.3";
+		case Gate::R_Z: return "rz" + operand(0) + " 0.3";
+		case Gate::S: return "s" + operand(0);
+		case Gate::S_DAG: return "sdag" + operand(0);
+		case Gate::SWAP: return "swap" + operand(0) + operand(1);
+		case Gate::T: return "t" + operand(0);
+		case Gate::T_DAG: return "tdag" + operand(0);
+		case Gate::TOFFOLI: return "toffoli" + operand(0) + operand(1) + operand(2);
+	}
+	return "";
+}
+
+static char const *gate_name(Gate gate)
+{
+	switch (gate) {
+		case Gate::CNOT: return "cnot";
+		case Gate::IDENTITY: return "i";
+		case Gate::HADAMARD: return "h";
+		case Gate::PAULI_X: return "x";
+		case Gate::PAULI_Y: return "y";
+		case Gate::PAULI_Z: return "z";
+		case Gate::R_X: return "rx";
+		case Gate::R_Y: return "ry";
+		case Gate::R_Z: return "rz";
+		case Gate::S: return "s";
+		case Gate::S_DAG: return "sdag";
+		case Gate::SWAP: return "swap";
+		case Gate::T: return "t";
+		case Gate::T_DAG: return "tdag";
+		case Gate::TOFFOLI: return "toffoli";
+	}
+	return "";
+}
+
+static void benchmark_gates(Benchmark_Options const &options, std::vector<Benchmark_Result> &results)
+{
+	// Gates are single stepped so each one is applied by its own kernel rather than being fused. The gates cycle
+	// through the qbits so that every stride is measured.
+	static size_t const num_gates = 64;
+	static Gate const gates[] = {
+		Gate::CNOT, Gate::IDENTITY, Gate::HADAMARD, Gate::PAULI_X, Gate::PAULI_Y, Gate::PAULI_Z, Gate::R_X, Gate::R_Y,
+		Gate::R_Z, Gate::S, Gate::S_DAG, Gate::SWAP, Gate::T, Gate::T_DAG, Gate::TOFFOLI,
+	};
+
+	QSim sim(options.num_threads);
+	sim.set_precision(options.precision);
+	sim.set_representation(options.representation);
+	sim.set_cache_block_qbits(options.cache_block_qbits);
+	for (size_t num_qbits = 8; num_qbits <= options.max_qbits; num_qbits += 4) {
+		for (Gate gate : gates) {
+			std::string const name = std::string("gate/") + gate_name(gate) + "/" + std::to_string(num_qbits);
+			if (name.find(options.filter) == std::string::npos) {
+				continue;
+			}
+
+			std::string source = "qbits " + std::to_string(num_qbits) + "\n";
+			for (size_t gate_index = 0; gate_index < num_gates; ++gate_index) {
+				source += gate_source(gate, gate_index, num_qbits) + "\n";
+			}
+			Quantum_Program program(source);
+			if (!program.is_valid()) {
+				std::cerr << "Generated program " << name << " failed to compile: " << program.get_build_error() << '\n';
+				std::exit(1);
+			}
+			sim.set_program(&program);
+			Benchmark_Result result = measure(options, name, [&] {
+				sim.reset();
+				auto const start = clock_type::now();
+				for (size_t gate_index = 0; gate_index < num_gates - 1; ++gate_index) {
+					sim.step(false);
+				}
+				return seconds_since(start);
+			});
+			double const gates_per_second = (double)(num_gates - 1) / result.seconds_per_iteration;
+			result.counters.push_back({ "gates_per_second", gates_per_second });
+			result.counters.push_back({ "amplitudes_per_second", gates_per_second * (double)((uint64_t)1 << num_qbits) });
+			results.push_back(result);
+		}
+	}
+}
+
+static void benchmark_circuits(Benchmark_Options const &options, std::vector<Benchmark_Result> &results)
+{
+	// Layers of rotations on every qbit followed by a ladder of cnots, run whole so the program is fused and, on wide
+	// registers, applied in cache blocked passes.
+	static size_t const num_layers = 8;
+	QSim sim(options.num_threads);
+	sim.set_precision(options.precision);
+	sim.set_representation(options.representation);
+	sim.set_cache_block_qbits(options.cache_block_qbits);
+	for (size_t num_qbits = 16; num_qbits <= options.max_qbits; num_qbits += 4) {
+		std::string const name = "circuit/" + std::to_string(num_qbits);
+		if (name.find(options.filter) == std::string::npos) {
+			continue;
+		}
+
+		std::string source = "qbits " + std::to_string(num_qbits) + "\n";
+		for (size_t layer = 0; layer < num_layers; ++layer) {
+			for (size_t qbit = 0; qbit < num_qbits; ++qbit) {
+				source += "ry q" + std::to_string(qbit) + " " + std::to_string(0.1 * (double)(layer + qbit + 1)) + "\n";
+			}
+			for (size_t qbit = 0; qbit + 1 < num_qbits; ++qbit) {
+				source += "cnot q" + std::to_string(qbit) + " q" + std::to_string(qbit + 1) + "\n";
+			}
+		}
+		Quantum_Program program(source);
+		if (!program.is_valid()) {
+			std::cerr << "Generated program " << name << " failed to compile: " << program.get_build_error() << '\n';
+			std::exit(1);
+		}
+		sim.set_program(&program);
+
+		Benchmark_Result result = measure(options, name, [&] {
+			auto const start = clock_type::now();
+			sim.run(1);
+			return seconds_since(start);
+		});
+		double const gates_per_second = (double)program.get_operations().size() / result.seconds_per_iteration;
+		result.counters.push_back({ "gates_per_second", gates_per_second });
+		result.counters.push_back({ "amplitudes_per_second", gates_per_second * (double)((uint64_t)1 << num_qbits) });
+		results.push_back(result);
+	}
+}
+
+static void benchmark_sampling(Benchmark_Options const &options, std::vector<Benchmark_Result> &results)
+{
+	QSim sim(options.num_threads);
+	sim.set_precision(options.precision);
+	sim.set_representation(options.representation);
+	sim.set_cache_block_qbits(options.cache_block_qbits);
+	for (size_t num_qbits : { 8, 16 }) {
+		std::string source = "qbits " + std::to_string(num_qbits) + "\n";
+		for (size_t qbit = 0; qbit < num_qbits; ++qbit) {
+			source += "ry q" + std::to_string(qbit) + " " + std::to_string(0.1 * (double)(qbit + 1)) + "\n";
+		}
+		Quantum_Program program(source);
+		sim.set_program(&program);
+
+		for (int num_runs = 1000; num_runs <= 10000000; num_runs *= 10) {
+			std::string const name = "sample/" + std::to_string(num_qbits) + "/" + std::to_string(num_runs);
+			if (name.find(options.filter) == std::string::npos) {
+				continue;
+			}
+			Benchmark_Result result = measure(options, name, [&] {
+				auto const start = clock_type::now();
+				sim.run(num_runs);
+				return seconds_since(start);
+			});
+			result.counters.push_back({ "shots_per_second", (double)num_runs / result.seconds_per_iteration });
+			results.push_back(result);
+		}
+	}
+}
+
+static void benchmark_parsing(Benchmark_Options const &options, std::vector<Benchmark_Result> &results)
+{
+	static size_t const num_lines = 100000;
+	static Gate const gates[] = { Gate::CNOT, Gate::HADAMARD, Gate::R_Y, Gate::T, Gate::SWAP, Gate::TOFFOLI };
+
+	std::string const name = "parse/" + std::to_string(num_lines);
+	if (name.find(options.filter) == std::string::npos) {
+		return;
+	}
+
+	std::mt19937 rng;
+	std::string source = "qbits 20\n";
+	for (size_t line = 0; line < num_lines; ++line) {
+		source += gate_source(gates[rng() % std::size(gates)], rng() % 20, 20) + "  # generated\n";
+	}
+
+	Benchmark_Result result = measure(options, name, [&] {
+		auto const start = clock_type::now();
+		Quantum_Program program(source);
+		double const seconds = seconds_since(start);
+		if (!program.is_valid()) {
+			std::cerr << "Generated program failed to compile: " << program.get_build_error() << '\n';
+			std::exit(1);
+		}
+		return seconds;
+	});
+	result.counters.push_back({ "lines_per_second", (double)num_lines / result.seconds_per_iteration });
+	results.push_back(result);
+}
+
+static void benchmark_examples(Benchmark_Options const &options, std::vector<Benchmark_Result> &results)
+{
+	static int const num_runs = 1000;
+	QSim sim(options.num_threads);
+	sim.set_precision(options.precision);
+	sim.set_representation(options.representation);
+	sim.set_cache_block_qbits(options.cache_block_qbits);
+	for (char const *example : { "grover", "deutsch-jozsa" }) {
+		std::string const name = std::string("example/") + example;
+		if (name.find(options.filter) == std::string::npos) {
+			continue;
+		}
+
+		std::ifstream file_stream { std::string(FQCSIM_EXAMPLES_DIR) + "/" + example + ".qasm" };
+		if (!file_stream.is_open()) {
+			std::cerr << "Failed to open example " << example << '\n';
+			std::exit(1);
+		}
+		std::string const source { std::istreambuf_iterator<char>(file_stream), std::istreambuf_iterator<char>() };
+		Quantum_Program program(source);
+		if (!program.is_valid()) {
+			std::cerr << "Failed to compile example " << example << ": " << program.get_build_error() << '\n';
+			std::exit(1);
+		}
+
+		Benchmark_Result result = measure(options, name, [&] {
+			auto const start = clock_type::now();
+			sim.set_program(&program);
+			sim.run(num_runs);
+			return seconds_since(start);
+		});
+		double const gates_per_second = (double)program.get_operations().size() / result.seconds_per_iteration;
+		result.counters.push_back({ "gates_per_second", gates_per_second });
+		result.counters.push_back({ "amplitudes_per_second", gates_per_second * (double)((uint64_t)1 << program.get_num_qbits()) });
+		results.push_back(result);
+	}
+}
+
+static void write_json(std::ostream &stream, Benchmark_Options const &options, std::vector<Benchmark_Result> const &results)
+{
+	stream << "{\n";
+	stream << "  \"context\": {\n";
+	stream << "    \"num_threads\": " << options.num_threads << ",\n";
+	stream << "    \"precision\": \"" << (options.precision == Precision::SINGLE ? "single" : "double") << "\",\n";
+	stream << "    \"representation\": \"" << representation_names[(size_t)options.representation] << "\",\n";
+	stream << "    \"cache_block_qbits\": " << options.cache_block_qbits << ",\n";
+	stream << "    \"hardware_concurrency\": " << std::thread::hardware_concurrency() << "\n";
+	stream << "  },\n";
+	stream << "  \"benchmarks\": [\n";
+	for (size_t index = 0; index < results.size(); ++index) {
+		Benchmark_Result const &result = results[index];
+		stream << "    {\n";
+		stream << "      \"name\": \"" << result.name << "\",\n";
+		stream << "      \"iterations\": " << result.iterations << ",\n";
+		stream << "      \"real_time_ns\": " << (result.seconds_per_iteration * 1e9);
+		for (auto const &[counter, value] : result.counters) {
+			stream << ",\n      \"" << counter << "\": " << value;
+		}
+		stream << "\n    }" << (index + 1 < results.size() ? "," : "") << "\n";
+	}
+	stream << "  ]\n";
+	stream << "}\n";
+}
+
+int main(int argc, char const **argv)
+{
+	Benchmark_Options options;
+	char const *output_file = nullptr;
+	for (int arg_index = 1; arg_index < argc; ++arg_index) {
+		bool const has_value = (arg_index + 1) < argc;
+		if (std::strcmp(argv[arg_index], "--threads") == 0 && has_value && parse_number(argv[arg_index + 1], (size_t)1, MAX_THREADS)) {
+			options.num_threads = *parse_number(argv[++arg_index], (size_t)1, MAX_THREADS);
+		} else if (std::strcmp(argv[arg_index], "--precision") == 0 && has_value &&
+		           (std::strcmp(argv[arg_index + 1], "double") == 0 || std::strcmp(argv[arg_index + 1], "single") == 0)) {
+			options.precision = std::strcmp(argv[++arg_index], "single") == 0 ? Precision::SINGLE : Precision::DOUBLE;
+		} else if (std::strcmp(argv[arg_index], "--representation") == 0 && has_value && find_representation(argv[arg_index + 1])) {
+			options.representation = *find_representation(argv[++arg_index]);
+		} else if (std::strcmp(argv[arg_index], "--cache-block-qbits") == 0 && has_value && parse_number(argv[arg_index + 1], (size_t)0, MAX_QBITS)) {
+			options.cache_block_qbits = *parse_number(argv[++arg_index], (size_t)0, MAX_QBITS);
+		} else if (std::strcmp(argv[arg_index], "--max-qbits") == 0 && has_value && parse_number(argv[arg_index + 1], (size_t)1, MAX_QBITS)) {
+			options.max_qbits = *parse_number(argv[++arg_index], (size_t)1, MAX_QBITS);
+		} else if (std::strcmp(argv[arg_index], "--min-time") == 0 && has_value && parse_number(argv[arg_index + 1], 0.0, 3600.0)) {
+			options.min_seconds = *parse_number(argv[++arg_index], 0.0, 3600.0);
+		} else if (std::strcmp(argv[arg_index], "--filter") == 0 && has_value) {
+			options.filter = argv[++arg_index];
+		} else if (std::strcmp(argv[arg_index], "--output") == 0 && has_value) {
+			output_file = argv[++arg_index];
+		} else {
+			std::cerr << "usage: bench_fqcsim [--threads N] [--precision double|single] [--representation full|factored|stabilizer] [--cache-block-qbits N] [--max-qbits N] [--min-time SECONDS] [--filter TEXT] [--output results.json]\n";
+			return 1;
+		}
+	}
+
+	std::vector<Benchmark_Result> results;
+	benchmark_gates(options, results);
+	benchmark_circuits(options, results);
+	benchmark_sampling(options, results);
+	benchmark_parsing(options, results);
+	benchmark_examples(options, results);
+
+	if (output_file) {
+		std::ofstream file_stream { output_file };
+		if (!file_stream.is_open()) {
+			std::cerr << "Failed to save file " << output_file << '\n';
+			return 1;
+		}
+		write_json(file_stream, options, results);
+	} else {
+		write_json(std::cout, options, results);
+	}
+
+	return 0;
+}
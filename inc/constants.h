@@ -4,6 +4,15 @@ constexpr double CONST_PI = 3.14159265358979323846;
 constexpr float CONST_PI_F = (float)CONST_PI;
 constexpr double CONST_TAU = CONST_PI * 2.0;
 constexpr float CONST_TAU_F = CONST_PI_F * 2.0f;
+constexpr double CONST_SQRT1_2 = 0.70710678118654752440;
 
-constexpr size_t NUM_QBITS = 8;
-constexpr size_t STATE_VEC_SIZE = 256;
+constexpr size_t DEFAULT_NUM_QBITS = 8;
+constexpr size_t MAX_QBITS = 30;
+// the most threads the front ends start for a simulation, beyond which they couldn't each get a share of the work
+constexpr size_t MAX_THREADS = 1024;
+// Gates on the last qbits are applied to blocks of 2^DEFAULT_CACHE_BLOCK_QBITS amplitudes at a time, which is 512 KiB in
+// double precision, small enough to stay in a core's L2 cache.
+constexpr size_t DEFAULT_CACHE_BLOCK_QBITS = 15;
+// Registers up to this wide can be simulated on a stabilizer tableau, if they only use Clifford gates. A tableau this
+// wide takes 8 MiB, and listing its support, as sampling does, about 10^9 word operations.
+constexpr size_t MAX_STABILIZER_QBITS = 4096;
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <complex>
+#include <random>
+#include <vector>
+
+#include "constants.h"
+#include "fusion.h"
+#include "kernels.h"
+#include "process_group.h"
+#include "qasm.h"
+#include "qsim.h"
+#include "sampler.h"
+
+// Gates on qbits at this bit of the state index or above take the vector kernels, as 2^3 amplitudes fill the widest
+// register.
+constexpr size_t MIN_VECTOR_QBIT_BIT = 3;
+// Each rank keeps at least 2^MIN_LOCAL_QBITS amplitudes, so however many qbits of an operation are global, there are
+// enough local qbits at or above MIN_VECTOR_QBIT_BIT for them to be swapped with.
+constexpr size_t MIN_LOCAL_QBITS = MIN_VECTOR_QBIT_BIT + MAX_FUSED_QBITS;
+// every chunk holds whole sampling segments
+static_assert(MIN_LOCAL_QBITS >= SAMPLING_SEGMENT_QBITS);
+
+// Simulates a program on the full state vector split across the 2^k ranks of a process group. The first k qbits are
+// global: each rank holds the 2^(N-k) amplitudes whose global qbits spell its rank, and the other qbits are local to
+// each of those chunks. Operations on local qbits and tables of phases apply to each chunk on its own. For an operation
+// on global qbits, each of them is swapped with a local qbit the operation doesn't act on, each rank exchanging half its
+// chunk with the rank that differs from it only in that qbit, the operation applies to each chunk on its own, and the
+// qbits are swapped back. Operations are fused and scheduled as by QSim with the same cache block setting, and each
+// amplitude goes through the same arithmetic, so the state is bit-identical to that of a QSim running on one thread.
+// Every rank makes the same calls in the same order.
+class Distributed_QSim
+{
+	Process_Group &group;
+	uint64_t seed = std::mt19937::default_seed;
+	uint64_t num_samplings = 0;
+
+	Quantum_Program const *program = nullptr;
+	std::vector<double> parameter_values;
+	// fused as by QSim, by bind_and_fuse_operations
+	std::vector<Fused_Operation> fused_operations;
+	size_t num_prefix_fused_operations = 0;
+
+	size_t num_qbits = 0;
+	size_t num_global_qbits = 0;
+	size_t num_local_qbits = 0;
+	size_t cache_block_qbits = DEFAULT_CACHE_BLOCK_QBITS;
+	Precision precision = Precision::DOUBLE;
+	// this rank's amplitudes
+	std::vector<std::complex<double>> chunk;
+	// used in place of chunk in single precision
+	std::vector<std::complex<float>> single_chunk;
+
+	std::vector<Result> results;
+	Alias_Table alias_table;
+
+	Gate_Kernels<double> const *gate_kernels;
+	Gate_Kernels<float> const *single_gate_kernels;
+
+public:
+	// The group must have a power of two ranks. It is only used through the simulator's calls, so each rank can spawn the
+	// group and then create its own simulator.
+	Distributed_QSim(Process_Group &group);
+
+	void set_program(Quantum_Program const *new_program);
+	void set_seed(uint64_t new_seed);
+	void set_precision(Precision new_precision);
+	// Binds values to the program's parameters as QSim::set_parameters does, and resets.
+	void set_parameters(std::vector<double> const &values);
+	// Takes the same setting as QSim::set_cache_block_qbits. Blocks wider than a chunk are swept as a whole instead, which
+	// reaches the same state.
+	void set_cache_block_qbits(size_t new_cache_block_qbits) { cache_block_qbits = new_cache_block_qbits; }
+
+	// Resets every qbit to zero. Returns false, leaving no state, if the group's size isn't a power of two or the chunk
+	// of each rank would hold fewer than 2^MIN_LOCAL_QBITS or more than 2^MAX_QBITS amplitudes.
+	bool reset();
+	// Resets, applies the program and samples num_runs measurements. Rank 0 picks the sampling segment of each shot and
+	// the rank holding it picks the state, with the random numbers of a QSim on one thread, so the results are the same
+	// as that QSim's for the same seed. They are collected on rank 0, and other ranks have none. Returns false if the
+	// state can't be split across the group or a connection fails.
+	bool run(int num_runs);
+
+	// Returns this rank's non-zero amplitudes in order of state, with their states indexed in the whole register.
+	std::vector<Amplitude> get_amplitudes() const;
+	// Collects the non-zero amplitudes of every rank on rank 0, in order of state, and gives the other ranks none. This
+	// brings the whole state into one process, so it suits small registers and checking against QSim. Returns false if a
+	// connection fails.
+	bool gather_amplitudes(std::vector<Amplitude> &amplitudes) const;
+	std::vector<Result> const &get_results() const { return results; }
+	size_t get_num_qbits() const { return num_qbits; }
+	size_t get_num_global_qbits() const { return num_global_qbits; }
+	// the register index of this rank's first amplitude
+	uint64_t get_first_state() const { return (uint64_t)group.get_rank() << num_local_qbits; }
+	uint64_t get_num_chunk_states() const { return (uint64_t)1 << num_local_qbits; }
+
+private:
+	void bind_operations();
+	bool sample(int num_runs);
+
+	template <typename Real>
+	std::vector<std::complex<Real>> &get_chunk();
+	template <typename Real>
+	std::vector<std::complex<Real>> const &get_chunk() const;
+	template <typename Real>
+	Gate_Kernels<Real> const &get_kernels() const;
+
+	template <typename Real>
+	bool perform_fused_operations(std::vector<Fused_Operation>::const_iterator begin, std::vector<Fused_Operation>::const_iterator end);
+	template <typename Real>
+	bool perform_fused_operation(Fused_Operation const &fused_operation);
+	// Swaps the global qbit at the given bit of the rank with the local qbit at the given bit of the chunk's index, a
+	// segment of the buffer's size at a time.
+	template <typename Real>
+	bool swap_global_qbit(size_t global_bit, uint64_t local_bit, std::vector<std::complex<Real>> &buffer);
+	template <typename Real>
+	void build_alias_table();
+};
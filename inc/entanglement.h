@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Disjoint sets of entangled qbits. Merges and lookups take near constant time through union by size and path halving.
+// Each group is identified by its root qbit, and its members are linked in a cycle so that a group can be walked
+// without touching the others.
+class Entanglement_Tracker
+{
+	// lookups halve the paths they walk, which changes no group
+	mutable std::vector<uint16_t> parents;
+	std::vector<uint16_t> next_members;
+	// the number of qbits in each group, stored at its root
+	std::vector<uint16_t> group_sizes;
+	size_t num_groups = 0;
+
+public:
+	// Places each of the qbits in a group of its own.
+	void reset(size_t num_qbits);
+
+	// Merges the groups of the two qbits and returns the root of the merged group.
+	uint16_t merge(uint16_t first_qbit, uint16_t second_qbit);
+
+	uint16_t find_root(uint16_t qbit) const
+	{
+		while (parents[qbit] != qbit) {
+			parents[qbit] = parents[parents[qbit]];
+			qbit = parents[qbit];
+		}
+		return qbit;
+	}
+
+	bool is_root(uint16_t qbit) const { return parents[qbit] == qbit; }
+	bool are_entangled(uint16_t first_qbit, uint16_t second_qbit) const { return find_root(first_qbit) == find_root(second_qbit); }
+	size_t get_num_qbits() const { return parents.size(); }
+	size_t get_num_groups() const { return num_groups; }
+	size_t get_group_size(uint16_t qbit) const { return group_sizes[find_root(qbit)]; }
+
+	// Calls function(member) for each qbit in the group of the given qbit, in no particular order.
+	template <typename Function>
+	void for_each_member(uint16_t qbit, Function const &function) const
+	{
+		uint16_t member = qbit;
+		do {
+			function(member);
+			member = next_members[member];
+		} while (member != qbit);
+	}
+
+	// Returns a copy of the groups, ordered by their lowest qbit, with the qbits of each in ascending order.
+	std::vector<std::vector<uint16_t>> get_groups() const;
+};
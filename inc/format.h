@@ -0,0 +1,33 @@
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "qsim.h"
+
+std::string to_binary_string(uint64_t state, size_t num_qbits);
+// Returns the same string as for the state's index, with the last qbit first.
+std::string to_binary_string(std::vector<bool> const &qbits);
+
+// Writes results as CSV, one row per measured state.
+void write_results_csv(std::ostream &stream, std::vector<Result> const &results, size_t num_qbits);
+void write_results_csv(std::ostream &stream, std::vector<Wide_Result> const &results);
+
+// Returns the argument as a number if all of it is one, from min_value to max_value, as the front ends read their
+// options.
+template <typename Number>
+std::optional<Number> parse_number(char const *argument, Number min_value, Number max_value)
+{
+	char const *const end = argument + std::strlen(argument);
+	Number value = 0;
+	auto const [ptr, ec] = std::from_chars(argument, end, value);
+	if (ec != std::errc() || ptr != end || value < min_value || value > max_value) {
+		return std::nullopt;
+	}
+	return value;
+}
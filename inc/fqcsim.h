@@ -0,0 +1,11 @@
+#pragma once
+
+// Public interface of the fqcsim_core library: compile programs with Quantum_Program and run them with QSim, or across
+// processes with Distributed_QSim.
+
+#include "distributed.h"
+#include "format.h"
+#include "observable.h"
+#include "qasm.h"
+#include "qsim.h"
+#include "sweep.h"
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <complex>
+#include <vector>
+
+#include "qasm.h"
+
+// largest number of qbits a dense fused block may cover
+constexpr size_t MAX_FUSED_QBITS = 4;
+// largest number of qbits a fused table of phases may cover
+constexpr size_t MAX_FUSED_DIAGONAL_QBITS = 10;
+
+enum class Fused_Kind : uint8_t
+{
+	GATE,     // a single source operation, applied with the kernel for its gate
+	MATRIX,   // a dense matrix over qbits
+	DIAGONAL, // a table of phases over qbits
+};
+
+struct Fused_Operation
+{
+	Fused_Kind kind;
+	Operation operation;
+
+	// The qbits a MATRIX or DIAGONAL operation acts on, in ascending order. The first qbit is the most significant bit
+	// of the row, column or table index.
+	std::vector<uint16_t> qbits;
+
+	// Row major 2^n x 2^n matrix for MATRIX operations, or the 2^n phases for DIAGONAL operations.
+	std::vector<std::complex<double>> elements;
+
+	// The operands of each multi qbit gate folded into a MATRIX operation, for entanglement tracking.
+	std::vector<std::vector<uint16_t>> entangled_qbits;
+};
+
+// Compiles a program's operations into a list that applies the same transformation in fewer passes over the state
+// vector: inverse pairs are cancelled, runs of single qbit gates on a qbit are multiplied into one matrix, runs of
+// diagonal gates are combined into one table of phases and neighbouring gates on a few qbits form dense blocks.
+std::vector<Fused_Operation> fuse_operations(std::vector<Operation> const &operations);
+
+// Where bind_and_fuse_operations splits the fused operations: the index of the first parameterised operation, or the
+// number of operations if there is none, and the number of fused operations applying the operations before it.
+struct Fused_Split
+{
+	size_t num_prefix_operations;
+	size_t num_prefix_fused_operations;
+};
+
+// Binds the values to the immediates of the parameterised operations, with zero for parameters beyond them, and fuses
+// the operations into fused_operations. The operations before the first parameterised one are the same for every set of
+// values, so they are fused apart from the rest and a simulation can keep a checkpoint between the two parts. Every
+// simulator binding the same values fuses the same way, so they reach bit-identical states.
+Fused_Split bind_and_fuse_operations(std::vector<Operation> &operations, std::vector<double> const &parameter_values,
+                                     std::vector<Fused_Operation> &fused_operations);
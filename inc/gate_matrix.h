@@ -0,0 +1,50 @@
+#pragma once
+
+#include <array>
+#include <complex>
+#include <cstddef>
+
+// Row major 2^n x 2^n matrix of a gate over n qbits, with the first qbit as the most significant bit of the row and
+// column indices. The elements are stored inline and the dimensions are known at compile time, so fixed gates can be
+// built as constants and kernels can be specialised for the size. A 2x2 matrix fills exactly one cache line.
+template <size_t Num_Qbits>
+struct alignas(64) Gate_Matrix
+{
+	static constexpr size_t size = (size_t)1 << Num_Qbits;
+
+	std::array<std::complex<double>, size * size> elements;
+
+	constexpr std::complex<double> &operator[](size_t index) { return elements[index]; }
+	constexpr std::complex<double> const &operator[](size_t index) const { return elements[index]; }
+
+	constexpr std::complex<double> &operator()(size_t row, size_t column) { return elements[(row * size) + column]; }
+	constexpr std::complex<double> const &operator()(size_t row, size_t column) const { return elements[(row * size) + column]; }
+
+	// Copies a matrix out of row major storage holding size * size elements.
+	static Gate_Matrix from_elements(std::complex<double> const *source)
+	{
+		Gate_Matrix matrix;
+		for (size_t index = 0; index < size * size; ++index) {
+			matrix.elements[index] = source[index];
+		}
+		return matrix;
+	}
+};
+
+// Returns the matrix applying rhs and then lhs.
+template <size_t Num_Qbits>
+Gate_Matrix<Num_Qbits> operator*(Gate_Matrix<Num_Qbits> const &lhs, Gate_Matrix<Num_Qbits> const &rhs)
+{
+	constexpr size_t size = Gate_Matrix<Num_Qbits>::size;
+	Gate_Matrix<Num_Qbits> product;
+	for (size_t row = 0; row < size; ++row) {
+		for (size_t column = 0; column < size; ++column) {
+			std::complex<double> element = 0.0;
+			for (size_t index = 0; index < size; ++index) {
+				element += lhs(row, index) * rhs(index, column);
+			}
+			product(row, column) = element;
+		}
+	}
+	return product;
+}
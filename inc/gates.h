@@ -0,0 +1,63 @@
+#pragma once
+
+#include <array>
+#include <complex>
+#include <iterator>
+#include <optional>
+
+#include "gate_matrix.h"
+#include "kernels.h"
+#include "qasm.h"
+
+struct Gate_Info
+{
+	uint8_t num_operands;
+	Fixed_Gate fixed_gate;
+	// maps Pauli strings to Pauli strings, so it can be applied to a stabilizer tableau
+	bool is_clifford;
+};
+
+// Properties of each gate, indexed by its Gate value.
+constexpr Gate_Info gate_table[] = {
+	{ 2, Fixed_Gate::NONE, true },      // CNOT
+	{ 1, Fixed_Gate::NONE, true },      // IDENTITY
+	{ 1, Fixed_Gate::HADAMARD, true },  // HADAMARD
+	{ 1, Fixed_Gate::PAULI_X, true },   // PAULI_X
+	{ 1, Fixed_Gate::PAULI_Y, true },   // PAULI_Y
+	{ 1, Fixed_Gate::PAULI_Z, true },   // PAULI_Z
+	{ 1, Fixed_Gate::NONE, false },     // R_X
+	{ 1, Fixed_Gate::NONE, false },     // R_Y
+	{ 1, Fixed_Gate::NONE, false },     // R_Z
+	{ 1, Fixed_Gate::NONE, true },      // S
+	{ 1, Fixed_Gate::NONE, true },      // S_DAG
+	{ 2, Fixed_Gate::NONE, true },      // SWAP
+	{ 1, Fixed_Gate::NONE, false },     // T
+	{ 1, Fixed_Gate::NONE, false },     // T_DAG
+	{ 3, Fixed_Gate::NONE, false },     // TOFFOLI
+};
+static_assert(std::size(gate_table) == (size_t)Gate::TOFFOLI + 1, "gate_table needs an entry for every gate");
+
+constexpr uint8_t get_num_operands(Gate gate)
+{
+	return gate_table[(size_t)gate].num_operands;
+}
+
+constexpr Fixed_Gate get_fixed_gate(Gate gate)
+{
+	return gate_table[(size_t)gate].fixed_gate;
+}
+
+constexpr bool is_clifford_gate(Gate gate)
+{
+	return gate_table[(size_t)gate].is_clifford;
+}
+
+// Returns the 2x2 matrix of a single qbit gate.
+Gate_Matrix<1> get_gate_matrix(Operation const &operation);
+
+// Returns the phases applied to the zero and one states of the target qbit for gates whose matrix is diagonal, or
+// nothing for gates that mix the two states.
+std::optional<std::array<std::complex<double>, 2>> get_diagonal_phases(Operation const &operation);
+
+// Returns true if applying rhs directly after lhs leaves every state unchanged.
+bool is_inverse(Operation const &lhs, Operation const &rhs);
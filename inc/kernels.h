@@ -0,0 +1,146 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <complex>
+#include <cstdint>
+
+#include "gate_matrix.h"
+
+enum class Instruction_Set : uint8_t
+{
+	SCALAR,
+	AVX2,
+	AVX512,
+};
+
+// Single qbit gates with a kernel specialised for their constant matrix, which avoids multiplies where the math allows.
+enum class Fixed_Gate : uint8_t
+{
+	PAULI_X,  // swaps each pair of amplitudes
+	PAULI_Y,  // swaps each pair and rotates by i or -i
+	PAULI_Z,  // negates the one amplitude
+	HADAMARD, // sum and difference of each pair, with one scale
+	NONE,     // no specialised kernel, the gate is applied through its matrix
+};
+
+constexpr size_t NUM_FIXED_GATES = (size_t)Fixed_Gate::NONE;
+
+// Kernels applying a single qbit gate to the amplitude pairs [begin, end) of a state vector of complex<Real>. Pair
+// index k refers to the two states formed by inserting a zero bit and a one bit into k at the target bit position.
+// Gate matrices and phases are always given in double precision and rounded to Real by the kernel.
+template <typename Real>
+struct Gate_Kernels
+{
+	Instruction_Set instruction_set;
+	void (*apply_matrix)(std::complex<Real> *state, uint64_t bit, Gate_Matrix<1> const &gate,
+	                     uint64_t begin, uint64_t end);
+	void (*apply_diagonal)(std::complex<Real> *state, uint64_t bit, std::complex<double> zero_phase,
+	                       std::complex<double> one_phase, uint64_t begin, uint64_t end);
+	// indexed by Fixed_Gate
+	void (*apply_fixed[NUM_FIXED_GATES])(std::complex<Real> *state, uint64_t bit, uint64_t begin, uint64_t end);
+};
+
+inline uint64_t insert_zero_bit(uint64_t index, uint64_t bit)
+{
+	uint64_t const low_bits = index & (((uint64_t)1 << bit) - 1);
+	return ((index ^ low_bits) << 1) | low_bits;
+}
+
+// The gate loops below work on a range of a state's groups of amplitudes, indexed as for the kernels, so a sweep over
+// the whole state, over one cache block and over one process's part of a distributed state share them.
+
+template <typename Real, size_t Num_Qbits>
+void apply_dense_range(std::complex<Real> *state, Gate_Matrix<Num_Qbits> const &gate,
+                       std::array<uint64_t, Num_Qbits> const &bits, uint64_t begin, uint64_t end)
+{
+	// the first bit is the most significant bit of the matrix row and column indices
+	constexpr size_t size = Gate_Matrix<Num_Qbits>::size;
+	std::array<uint64_t, Num_Qbits> sorted_bits = bits;
+	std::array<uint64_t, size> offsets = {};
+	for (size_t index = 0; index < Num_Qbits; ++index) {
+		for (size_t local_index = 0; local_index < size; ++local_index) {
+			if ((local_index >> (Num_Qbits - 1 - index)) & 1) {
+				offsets[local_index] |= (uint64_t)1 << bits[index];
+			}
+		}
+	}
+	std::sort(sorted_bits.begin(), sorted_bits.end());
+
+	// the block is multiplied in double precision whatever the precision of the state vector
+	std::array<std::complex<double>, size> amplitudes;
+	for (uint64_t index = begin; index < end; ++index) {
+		uint64_t base_index = index;
+		for (size_t bit_index = 0; bit_index < Num_Qbits; ++bit_index) {
+			base_index = insert_zero_bit(base_index, sorted_bits[bit_index]);
+		}
+		for (size_t local_index = 0; local_index < size; ++local_index) {
+			amplitudes[local_index] = std::complex<double>(state[base_index | offsets[local_index]]);
+		}
+		for (size_t row = 0; row < size; ++row) {
+			std::complex<double> amplitude = 0.0;
+			for (size_t column = 0; column < size; ++column) {
+				amplitude += gate(row, column) * amplitudes[column];
+			}
+			state[base_index | offsets[row]] = std::complex<Real>(amplitude);
+		}
+	}
+}
+
+// Multiplies each amplitude by the phase indexed by its bits, the first bit being the least significant bit of the
+// table index. first_index is the register index of state[0].
+template <typename Real>
+void apply_diagonal_table_range(std::complex<Real> *state, uint64_t first_index, uint64_t const *bits,
+                                size_t num_table_bits, std::complex<double> const *phase_table, uint64_t begin, uint64_t end)
+{
+	for (uint64_t index = begin; index < end; ++index) {
+		size_t table_index = 0;
+		for (size_t table_bit = 0; table_bit < num_table_bits; ++table_bit) {
+			table_index |= (((first_index + index) >> bits[table_bit]) & 1) << table_bit;
+		}
+		state[index] *= phase_table[table_index];
+	}
+}
+
+template <typename Real>
+void apply_cnot_range(std::complex<Real> *state, uint64_t control_bit, uint64_t target_bit, uint64_t begin, uint64_t end)
+{
+	uint64_t const control_mask = (uint64_t)1 << control_bit;
+	uint64_t const target_mask = (uint64_t)1 << target_bit;
+	for (uint64_t index = begin; index < end; ++index) {
+		uint64_t const base_index = insert_zero_bit(insert_zero_bit(index, std::min(control_bit, target_bit)),
+		                                            std::max(control_bit, target_bit));
+		std::swap(state[base_index | control_mask], state[base_index | control_mask | target_mask]);
+	}
+}
+
+template <typename Real>
+void apply_swap_range(std::complex<Real> *state, uint64_t first_bit, uint64_t second_bit, uint64_t begin, uint64_t end)
+{
+	uint64_t const first_mask = (uint64_t)1 << first_bit;
+	uint64_t const second_mask = (uint64_t)1 << second_bit;
+	for (uint64_t index = begin; index < end; ++index) {
+		uint64_t const base_index = insert_zero_bit(insert_zero_bit(index, std::min(first_bit, second_bit)),
+		                                            std::max(first_bit, second_bit));
+		std::swap(state[base_index | first_mask], state[base_index | second_mask]);
+	}
+}
+
+// bits holds the two control bits followed by the target bit
+template <typename Real>
+void apply_toffoli_range(std::complex<Real> *state, std::array<uint64_t, 3> bits, uint64_t begin, uint64_t end)
+{
+	uint64_t const control_mask = ((uint64_t)1 << bits[0]) | ((uint64_t)1 << bits[1]);
+	uint64_t const target_mask = (uint64_t)1 << bits[2];
+	std::sort(bits.begin(), bits.end());
+	for (uint64_t index = begin; index < end; ++index) {
+		uint64_t const base_index = insert_zero_bit(insert_zero_bit(insert_zero_bit(index, bits[0]), bits[1]), bits[2]);
+		std::swap(state[base_index | control_mask], state[base_index | control_mask | target_mask]);
+	}
+}
+
+Instruction_Set detect_instruction_set();
+
+// Defined for double and float amplitudes.
+template <typename Real>
+Gate_Kernels<Real> const &get_gate_kernels(Instruction_Set instruction_set);
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+// A file mapped into memory for reading and writing. The OS pages its contents in and out on demand, so it can be
+// larger than physical memory, and they stay in the file once it is closed.
+class Mapped_File
+{
+	uint8_t *data = nullptr;
+	uint64_t size = 0;
+	// the file descriptor on Linux, and the file and mapping handles on Windows
+	intptr_t file_handle = -1;
+	intptr_t mapping_handle = 0;
+
+public:
+	Mapped_File() = default;
+	~Mapped_File();
+
+	Mapped_File(Mapped_File const &) = delete;
+	Mapped_File &operator=(Mapped_File const &) = delete;
+
+	// Opens the file for reading and writing, creating it if it doesn't exist, and maps its contents. Returns false,
+	// leaving no file open, if it can't be opened or mapped.
+	bool open(std::filesystem::path const &path);
+	// Grows or shrinks the file and maps it again, which may move the data. New bytes are zero. Returns false, leaving no
+	// file open, if the file can't be resized or mapped, such as when the disk is full.
+	bool resize(uint64_t new_size);
+	// Writes the mapped contents in the range back to the file and waits for them to reach the disk. The offset must be a
+	// multiple of the page size.
+	void flush(uint64_t offset, uint64_t length);
+	void flush() { flush(0, size); }
+	void close();
+
+	bool is_open() const { return file_handle != -1; }
+	uint8_t *get_data() const { return data; }
+	uint64_t get_size() const { return size; }
+
+private:
+	bool map();
+	void unmap();
+};
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+enum class Pauli : uint8_t
+{
+	X,
+	Y,
+	Z,
+};
+
+struct Pauli_Factor
+{
+	Pauli pauli;
+	uint16_t qbit;
+};
+
+// A real coefficient times a product of Pauli operators, applied in order, with the identity on every unlisted qbit.
+// A term with no factors is the identity.
+struct Pauli_Term
+{
+	double coefficient;
+	std::vector<Pauli_Factor> factors;
+};
+
+// Weighted sum of Pauli strings, e.g. { { 0.5, { { Pauli::Z, 0 }, { Pauli::Z, 1 } } }, { -1.0, { { Pauli::X, 0 } } } }.
+using Observable = std::vector<Pauli_Term>;
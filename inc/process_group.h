@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A fixed set of processes on one machine, each with a rank from 0, connected in pairs by Unix domain sockets. It stands
+// in for the fabric of a cluster, so work split across processes can be run and tested on a single box. Processes are
+// only spawned on Linux.
+class Process_Group
+{
+	size_t rank = 0;
+	size_t num_ranks = 1;
+	// the socket connected to each rank, and -1 for this one
+	std::vector<intptr_t> sockets;
+	// the process IDs of the other ranks, kept by rank 0 to wait for them
+	std::vector<intptr_t> processes;
+
+public:
+	Process_Group() = default;
+	// A rank other than 0 that destroys its group without finishing exits the process with a failure status, so it never
+	// returns into code meant for rank 0 alone.
+	~Process_Group();
+
+	Process_Group(Process_Group const &) = delete;
+	Process_Group &operator=(Process_Group const &) = delete;
+
+	// Forks the calling process into new_num_ranks processes, which all return from spawn, the caller as rank 0. Only the
+	// calling thread is copied into the new processes, so spawn before starting any others, such as those of a QSim.
+	// Returns false, in the calling process alone, if the processes or their sockets can't be created, or on Windows for
+	// more than one rank.
+	bool spawn(size_t new_num_ranks);
+	// Ends the group. Every rank but 0 exits the process, with a status of 0 if is_success, and rank 0 waits for them and
+	// returns whether every rank, itself included, succeeded.
+	bool finish(bool is_success);
+
+	size_t get_rank() const { return rank; }
+	size_t get_num_ranks() const { return num_ranks; }
+
+	// Sends size bytes to the peer while receiving size bytes from it, so both ranks of a pair can call it at once without
+	// either blocking on a full socket. A null send_data or receive_data leaves out that direction. Returns false if the
+	// connection fails, such as when the peer has exited.
+	bool exchange(size_t peer, void const *send_data, void *receive_data, size_t size);
+	bool send(size_t peer, void const *data, size_t size) { return exchange(peer, data, nullptr, size); }
+	bool receive(size_t peer, void *data, size_t size) { return exchange(peer, nullptr, data, size); }
+};
@@ -1,7 +1,9 @@
 #pragma once
 
 #include <array>
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 
 enum class Gate : uint8_t
@@ -23,17 +25,28 @@ enum class Gate : uint8_t
 	TOFFOLI,
 };
 
+// marks an operation whose immediate is a literal rather than a named parameter
+constexpr uint16_t NO_PARAMETER = UINT16_MAX;
+
 struct Operation
 {
 	Gate gate;
-	std::array<uint8_t, 3> operands;
+	std::array<uint16_t, 3> operands;
 	double immediate;
+	// Index into the program's parameter names of the parameter supplying the immediate. The immediate of a
+	// parameterised operation is zero until a value is bound.
+	uint16_t parameter = NO_PARAMETER;
 };
 
 class Quantum_Program
 {
 	std::vector<Operation> operations;
-	std::vector<uint8_t> active_qbits;
+	std::vector<uint16_t> active_qbits;
+	// flags the qbits in active_qbits, which registers of thousands of qbits would be slow to search
+	std::vector<bool> is_active_qbit;
+	std::vector<std::string> parameter_names;
+	size_t num_qbits;
+	bool clifford = true;
 
 	bool valid = true;
 	std::string error_message;
@@ -45,9 +58,15 @@ public:
 	std::string get_build_error() const;
 
 	std::vector<Operation> const &get_operations() const;
-	std::vector<uint8_t> const &get_active_qbits() const;
+	std::vector<uint16_t> const &get_active_qbits() const;
+	size_t get_num_qbits() const;
+	std::vector<std::string> const &get_parameter_names() const;
+	// Returns true if every operation is a Clifford gate, so the program can run on a stabilizer tableau.
+	bool is_clifford() const;
 
 private:
+	void set_num_qbits(struct Expression const &expression);
 	void add_operation(Gate gate, struct Expression const &expression, uint8_t num_operands, bool has_immediate = false);
+	uint16_t get_parameter_index(std::string_view name);
 	void set_error(uint32_t line_number, std::string const &error);
 };
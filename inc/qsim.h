@@ -1,58 +1,311 @@
 #pragma once
 
+#include <array>
 #include <complex>
+#include <filesystem>
+#include <iterator>
+#include <optional>
 #include <random>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
-class Quantum_Program;
+#include "constants.h"
+#include "entanglement.h"
+#include "fusion.h"
+#include "gate_matrix.h"
+#include "kernels.h"
+#include "mapped_file.h"
+#include "observable.h"
+#include "sampler.h"
+#include "schedule.h"
+#include "stabilizer.h"
+#include "thread_pool.h"
 
 struct Amplitude
 {
-	uint32_t state;
+	uint64_t state;
 	std::complex<double> amplitude;
 };
 
 struct Result
 {
-	uint32_t state;
+	uint64_t state;
 	uint32_t num_times;
 };
 
-template <typename Type>
-using matrix = std::vector<std::vector<Type>>;
+// A measured basis state of a register too wide for a state index, with the value of each qbit, qbit 0 first.
+struct Wide_Result
+{
+	std::vector<bool> qbits;
+	uint32_t num_times;
+};
+
+// Precision of the amplitudes in the state vector. Single precision halves the memory per amplitude, doubling the
+// register width that fits in a given budget and the amplitudes per vector register, at the cost of rounding error.
+enum class Precision : uint8_t
+{
+	DOUBLE,
+	SINGLE,
+};
+
+// How the state is stored. The full representation keeps one vector of 2^N amplitudes. The factored representation
+// keeps one vector per group of entangled qbits and only forms the tensor product of two groups when a multi qbit gate
+// links them, so it needs memory in proportion to the largest group rather than the whole register. The stabilizer
+// representation keeps a tableau of O(N^2) bits and applies only to programs of Clifford gates, which are always run on
+// a tableau when their register is too wide for a state vector. Other programs fall back to the full representation.
+enum class Representation : uint8_t
+{
+	FULL,
+	FACTORED,
+	STABILIZER,
+};
+
+// names of the representations, indexed by their Representation value, as taken by the front ends
+constexpr char const *representation_names[] = { "full", "factored", "stabilizer" };
+
+inline std::optional<Representation> find_representation(std::string_view name)
+{
+	for (size_t index = 0; index < std::size(representation_names); ++index) {
+		if (name == representation_names[index]) {
+			return (Representation)index;
+		}
+	}
+	return std::nullopt;
+}
+
+// Copy of the simulation state after the first gate_index operations of a program, which a QSim can restore to resume
+// from that point instead of running those operations again.
+struct QSim_Snapshot
+{
+	size_t gate_index = 0;
+	// identifies the register width and the operations that produced the state, with their bound parameter values
+	uint64_t prefix_hash = 0;
+	Precision precision = Precision::DOUBLE;
+	// the representation in use, rather than the one asked for
+	Representation representation = Representation::FULL;
+	std::vector<std::complex<double>> state_vector;
+	std::vector<std::complex<float>> single_state_vector;
+	std::vector<std::vector<std::complex<double>>> group_state_vectors;
+	std::vector<std::vector<std::complex<float>>> single_group_state_vectors;
+	Entanglement_Tracker entanglements;
+	Stabilizer_Tableau tableau;
+};
 
 class QSim
 {
-	std::mt19937 rng;
-	std::uniform_real_distribution<double> random_distribution;
+	uint64_t seed = std::mt19937::default_seed;
+	uint64_t num_samplings = 0;
 
-	Quantum_Program const *program;
+	Quantum_Program const *program = nullptr;
+	std::vector<double> parameter_values;
+	// the program's operations with parameter values bound to their immediates
+	std::vector<Operation> operations;
 	size_t next_gate_index = 0;
+	std::vector<Fused_Operation> fused_operations;
+	// prefix_hashes[i] is the QSim_Snapshot::prefix_hash of the state after the first i operations
+	std::vector<uint64_t> prefix_hashes;
+	// Run keeps a checkpoint after the operations up to the first parameterised one, or after all of them. The fused
+	// operations are split there, with the first num_prefix_fused_operations producing the checkpoint.
+	size_t checkpoint_gate_index = 0;
+	size_t num_prefix_fused_operations = 0;
 
+	size_t max_checkpoints = 0;
+	std::vector<QSim_Snapshot> checkpoints;
+	// the value of checkpoint_clock when each checkpoint was last used, to replace the least recently used one
+	std::vector<uint64_t> checkpoint_uses;
+	uint64_t checkpoint_clock = 0;
+
+	size_t num_qbits = 0;
+	size_t cache_block_qbits = DEFAULT_CACHE_BLOCK_QBITS;
+	Precision precision = Precision::DOUBLE;
 	std::vector<std::complex<double>> state_vector;
-	std::vector<std::vector<uint8_t>> qbit_groups;
+	// used in place of state_vector in single precision
+	std::vector<std::complex<float>> single_state_vector;
+	// When open, holds the full state in place of the state vectors, after a header naming the operations that produced
+	// it. The header is only marked current once the state has been flushed to the file.
+	Mapped_File state_file;
+	bool is_state_file_current = false;
+	Representation representation = Representation::FULL;
+	// the representation in use for the current program, which differs from the one asked for where it can't apply
+	Representation active_representation = Representation::FULL;
+	Entanglement_Tracker entanglements;
+	// Used in place of the state vectors in the factored representation, with one vector for each group of entangled
+	// qbits, indexed by the root qbit of the group. The vectors of other qbits are empty.
+	std::vector<std::vector<std::complex<double>>> group_state_vectors;
+	std::vector<std::vector<std::complex<float>>> single_group_state_vectors;
+	// The qbits of each group in ascending order, indexed by root qbit, and the bit of each qbit in its group's state
+	// index. The first qbit of a group is the most significant bit.
+	std::vector<std::vector<uint16_t>> group_qbits;
+	std::vector<uint16_t> group_bits;
+	// where two groups are merged before being copied into the vectors of the merged group's root
+	std::vector<std::complex<double>> merged_group_state;
+	std::vector<std::complex<float>> single_merged_group_state;
+	std::vector<uint16_t> merged_group_qbits;
+	// used in place of the state vectors in the stabilizer representation
+	Stabilizer_Tableau tableau;
 
 	std::vector<Result> results;
+	std::vector<Wide_Result> wide_results;
+	Alias_Table alias_table;
+	// the alias table of each group in the factored representation, and the register state of each of its entries
+	std::vector<Alias_Table> group_alias_tables;
+	std::vector<std::vector<uint64_t>> group_entry_states;
+	// the number of times each stream drew each state, where the register is too wide for a histogram over all of them
+	std::vector<std::unordered_map<uint64_t, uint32_t>> stream_state_counts;
+	// the same for registers on a tableau, which can be too wide for a state index
+	std::vector<std::unordered_map<std::vector<bool>, uint32_t>> stream_qbit_counts;
+	std::vector<std::vector<uint32_t>> stream_counts;
+
+	Thread_Pool thread_pool;
+	Gate_Kernels<double> const *gate_kernels;
+	Gate_Kernels<float> const *single_gate_kernels;
 
 public:
-	QSim();
+	QSim(size_t num_threads = 1);
 	~QSim();
 
 	void set_program(Quantum_Program const *new_program);
+	void set_seed(uint64_t new_seed);
+	void set_precision(Precision new_precision);
+	void set_representation(Representation new_representation);
+	// Binds values to the program's parameters in the order of Quantum_Program::get_parameter_names, and resets.
+	// Parameters without a value are zero. Values are cleared when the program changes.
+	void set_parameters(std::vector<double> const &values);
+	// Keeps up to this many checkpoints of the state. Run resumes from a checkpoint whose operations match the start
+	// of the current program, even if it was taken with another program or parameter values, and seek resumes from the
+	// nearest checkpoint before its target. Each checkpoint holds a copy of the state vector. Zero frees them all.
+	void set_max_checkpoints(size_t new_max_checkpoints);
+	// Keeps the full state in the file, mapped into memory, so it can be larger than physical memory and outlives the
+	// process. If the file holds a current state of operations matching the start of the program, at the same
+	// precision, the simulation resumes from it, and otherwise it starts over in the file. Set the program, parameters,
+	// precision and representation first, as changing them resets the state. The other representations stay in
+	// memory. Returns false, keeping the state in memory, if the file can't be opened or grown to the size of the state,
+	// or if it isn't empty and wasn't written by a simulation, in which case it is left untouched.
+	bool set_state_file(std::filesystem::path const &path);
+	// Run applies the program to registers wider than this in passes over blocks of 2^n amplitudes, each applying a run
+	// of gates on the last n qbits while the block is in cache. Zero sweeps the whole state once per fused operation.
+	void set_cache_block_qbits(size_t new_cache_block_qbits) { cache_block_qbits = new_cache_block_qbits; }
+	// Flushes and closes the state file, and resets with the state in memory.
+	void clear_state_file();
+	// Writes the state back to the file and marks it current, so a later set_state_file can resume from it. Run does this
+	// once it has applied the program.
+	void flush_state_file();
 
 	void reset();
 	void run(int num_runs);
 	void step(bool is_single_step = true);
+	// Moves to the state after the first gate_index operations, stepping forwards from the current state or the nearest
+	// checkpoint. Checkpoints are kept at regular intervals on the way when enabled.
+	void seek(size_t gate_index);
+
+	// Copies the current state into the snapshot, reusing its storage.
+	void save_snapshot(QSim_Snapshot &snapshot) const;
+	// Restores a snapshot taken with the same precision and representation, and with operations matching the start of
+	// the current program, and returns false without changing the state otherwise.
+	bool restore_snapshot(QSim_Snapshot const &snapshot);
 
+	// Returns the non-zero amplitudes in order of state. On a tableau the amplitudes are only known up to a global phase,
+	// and states with more than 2^20 of them, or of more than 64 qbits, give none.
 	std::vector<Amplitude> get_amplitudes() const;
+	// Returns the results of the last run in order of state. Registers of more than 64 qbits, which only run on a
+	// tableau, only have wide results.
 	std::vector<Result> const &get_results() const { return results; }
-	std::vector<std::vector<uint8_t>> const &get_qbit_groups() const { return qbit_groups; }
+	// Returns the results of the last run on a tableau, at any width, in order of state.
+	std::vector<Wide_Result> const &get_wide_results() const { return wide_results; }
+	Entanglement_Tracker const &get_entanglements() const { return entanglements; }
+	// Returns a copy of the groups of entangled qbits, ordered by their lowest qbit.
+	std::vector<std::vector<uint16_t>> get_qbit_groups() const { return entanglements.get_groups(); }
 	size_t get_next_gate_index() const { return next_gate_index; }
-	std::array<std::complex<double>, 2> get_qbit_state(uint8_t qbit) const;
+	bool is_state_mapped() const { return state_file.is_open() && active_representation == Representation::FULL; }
+	size_t get_num_qbits() const { return num_qbits; }
+	Precision get_precision() const { return precision; }
+	Representation get_representation() const { return representation; }
+	Representation get_active_representation() const { return active_representation; }
+	Instruction_Set get_instruction_set() const { return gate_kernels->instruction_set; }
+	std::array<std::complex<double>, 2> get_qbit_state(uint16_t qbit) const;
+	// Returns the exact expectation value of the observable in the current state, without sampling. Terms that flip the
+	// same qbits share one pass over the state vector. Terms with a factor on a qbit outside the register are skipped.
+	double compute_expectation(Observable const &observable);
 
 private:
-	void perform_quantum_gate(matrix<std::complex<double>> const &gate, uint8_t qbit);
-	void perform_cnot_gate(uint8_t control_qbit, uint8_t target_qbit);
+	void bind_operations();
+	bool matches_snapshot(QSim_Snapshot const &snapshot) const;
+	void save_checkpoint();
+	size_t restore_checkpoint(size_t max_gate_index);
+	QSim_Snapshot const *find_checkpoint(size_t max_gate_index) const;
+
+	template <typename Real>
+	struct State_Span
+	{
+		std::complex<Real> *state;
+		uint64_t num_states;
+	};
+
+	void release_unused_states();
+	bool reset_state_file();
+	void invalidate_state_file();
+	uint64_t num_states() const;
+	uint64_t qbit_bit(uint16_t qbit) const;
+	void rebuild_group_qbits();
+
+	// Returns the amplitudes of the full representation, in the state file when one is open.
+	template <typename Real>
+	std::complex<Real> *get_state();
+	template <typename Real>
+	std::complex<Real> const *get_state() const;
+	template <typename Real>
+	std::vector<std::vector<std::complex<Real>>> &get_group_state_vectors();
+	template <typename Real>
+	std::vector<std::complex<Real>> &get_merged_group_state();
+	// Returns the amplitudes holding the given qbits. In the factored representation their groups are merged first.
+	template <typename Real>
+	State_Span<Real> get_state_span(uint16_t const *qbits, size_t num_span_qbits);
+	template <typename Real>
+	size_t merge_qbit_groups(uint16_t const *qbits, size_t num_merged_qbits);
+	template <typename Real>
+	Gate_Kernels<Real> const &get_kernels() const;
+
+	template <typename Function>
+	void for_each_range(uint64_t num_span_states, uint64_t count, Function const &function);
+
+	// The gate implementations are instantiated for double and float amplitudes, and run and step pick one by the
+	// current precision.
+	template <typename Real>
+	void perform_operation(Operation const &operation);
+	// applies the operation without tracking the qbits it entangles
+	template <typename Real>
+	void apply_operation(Operation const &operation);
+	template <typename Real>
+	void perform_fused_operation(Fused_Operation const &fused_operation);
+	template <typename Real>
+	void perform_gate_pass(Gate_Pass const &pass);
+
+	template <typename Real>
+	void perform_quantum_gate(Gate_Matrix<1> const &gate, uint16_t qbit);
+	template <typename Real>
+	void perform_fixed_gate(Fixed_Gate fixed_gate, uint16_t qbit);
+	template <typename Real, size_t Num_Qbits>
+	void perform_dense_gate(Gate_Matrix<Num_Qbits> const &gate, std::vector<uint16_t> const &qbits);
+	template <typename Real>
+	void perform_diagonal_gate(std::array<std::complex<double>, 2> const &phases, uint16_t qbit);
+	template <typename Real>
+	void perform_diagonal_table(std::vector<std::complex<double>> const &phases, std::vector<uint16_t> const &qbits);
+	template <typename Real>
+	void perform_cnot_gate(uint16_t control_qbit, uint16_t target_qbit);
+	template <typename Real>
+	void perform_swap_gate(uint16_t first_qbit, uint16_t second_qbit);
+	template <typename Real>
+	void perform_toffoli_gate(uint16_t first_control_qbit, uint16_t second_control_qbit, uint16_t target_qbit);
+	void perform_tableau_operation(Operation const &operation);
+	uint64_t next_sampling_seed();
 	void generate_results(int num_runs);
-	void update_entanglements(std::vector<uint8_t> const &newly_entangled);
+	template <typename Real>
+	void generate_factored_results(int num_runs);
+	void generate_stabilizer_results(int num_runs);
+	void merge_stream_state_counts(size_t num_streams);
+	template <typename Real>
+	double compute_factored_expectation(Observable const &observable);
+	double compute_stabilizer_expectation(Observable const &observable) const;
+	void update_entanglements(uint16_t const *newly_entangled, size_t num_newly_entangled);
 };
@@ -3,6 +3,7 @@
 #include <array>
 #include <string>
 #include <filesystem>
+#include <vector>
 
 #include "constants.h"
 #include "imgui.h"
@@ -24,7 +25,7 @@ class QSim_GUI
 
 	static constexpr size_t num_samples = 512;
 	std::array<float, num_samples> samples_x;
-	std::array<std::array<float, num_samples>, NUM_QBITS> samples_y;
+	std::vector<std::array<float, num_samples>> samples_y;
 
 	imgui_addons::ImGuiFileBrowser file_dialog;
 	bool open_load = false;
@@ -61,6 +62,7 @@ private:
 	void handle_reset();
 	void handle_run();
 	void handle_step();
+	void handle_step_back();
 	void handle_quit();
 
 	void load_source_file(std::filesystem::path const &source_file);
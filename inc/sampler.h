@@ -0,0 +1,172 @@
+#pragma once
+
+#include <algorithm>
+#include <complex>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// Mixes the bits of a value, so generators seeded from nearby values, such as a seed plus a counter, are unrelated.
+inline uint64_t split_mix(uint64_t value)
+{
+	value += 0x9e3779b97f4a7c15;
+	value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9;
+	value = (value ^ (value >> 27)) * 0x94d049bb133111eb;
+	return value ^ (value >> 31);
+}
+
+// Sampling picks a segment of 2^SAMPLING_SEGMENT_QBITS consecutive basis states by its probability, and then a state
+// within the segment, so a state vector split into parts of whole segments samples as it would in one piece.
+constexpr size_t SAMPLING_SEGMENT_QBITS = 7;
+
+// Returns the number of states in each sampling segment of a state vector of num_states states.
+inline uint64_t get_segment_size(uint64_t num_states)
+{
+	return std::min(num_states, (uint64_t)1 << SAMPLING_SEGMENT_QBITS);
+}
+
+// Returns the total probability of the states, summed in order in double precision, as every sampler sums a segment.
+template <typename Real>
+double get_total_probability(std::complex<Real> const *state, uint64_t num_states)
+{
+	double total_probability = 0.0;
+	for (uint64_t index = 0; index < num_states; ++index) {
+		total_probability += std::norm(std::complex<double>(state[index]));
+	}
+	return total_probability;
+}
+
+// Returns the first index whose cumulative probability exceeds random_number times the total, or the last index with a
+// non-zero probability where rounding leaves none, and nothing if every probability is zero. get_probability(index)
+// returns each index's probability, and is called twice for each.
+template <typename Get_Probability>
+std::optional<uint64_t> pick_by_cumulative_probability(uint64_t num_indices, double random_number, Get_Probability const &get_probability)
+{
+	double total_probability = 0.0;
+	for (uint64_t index = 0; index < num_indices; ++index) {
+		total_probability += get_probability(index);
+	}
+	double const target_probability = random_number * total_probability;
+
+	std::optional<uint64_t> picked_index;
+	double cumulative_probability = 0.0;
+	for (uint64_t index = 0; index < num_indices; ++index) {
+		double const probability = get_probability(index);
+		if (probability > 0.0) {
+			picked_index = index;
+			cumulative_probability += probability;
+			if (cumulative_probability > target_probability) {
+				break;
+			}
+		}
+	}
+	return picked_index;
+}
+
+// Walker alias tables over the basis states of a state vector, giving O(1) measurement samples after an O(2^N) build.
+// One table picks a sampling segment by its probability, and each segment has a table of its own over its states. Only
+// states and segments with a non-zero probability are kept, so sparse states also build and sample from smaller tables.
+class Alias_Table
+{
+	// The alias of a column is at index 0 of each pair and the column's own at index 1, so picking one is an index
+	// rather than a branch, which couldn't be predicted.
+
+	// a column of a segment's table, whose alias is an entry of the same segment
+	struct State_Column
+	{
+		double threshold;
+		uint32_t entries[2];
+	};
+	// the first entry and number of entries of a segment
+	struct Segment_Entries
+	{
+		uint32_t first_entry;
+		uint32_t num_entries;
+	};
+	// a column of the table of segments, with the scales that turn what is left of a random number that picked it
+	// into a uniform random number for picking a state within the segment
+	struct Segment_Column
+	{
+		double threshold;
+		double scales[2];
+		uint32_t segments[2];
+		Segment_Entries entries[2];
+	};
+
+	// the probability of every segment, and a column for each segment with a non-zero one
+	std::vector<double> segment_probabilities;
+	std::vector<Segment_Column> segment_columns;
+	// the states of all the segments, those of each following the last, and the entries of each segment
+	std::vector<uint64_t> states;
+	std::vector<State_Column> state_columns;
+	std::vector<Segment_Entries> segment_entries;
+
+	// work lists for the build, kept so rebuilding a table of the same size doesn't allocate
+	std::vector<double> thresholds;
+	std::vector<uint32_t> aliases;
+	std::vector<uint32_t> small_entries;
+	std::vector<uint32_t> large_entries;
+
+public:
+	// Defined for double and float amplitudes.
+	template <typename Real>
+	void build(std::complex<Real> const *state, uint64_t num_states);
+	// Builds only the table of segments from their probabilities, to pick segments whose states are held elsewhere.
+	void build_segments(double const *probabilities, uint64_t num_segments);
+
+	size_t size() const { return states.size(); }
+	uint64_t get_state(size_t entry) const { return states[entry]; }
+	uint64_t get_num_segments() const { return segment_probabilities.size(); }
+	double const *get_segment_probabilities() const { return segment_probabilities.data(); }
+	bool is_empty() const { return segment_columns.empty(); }
+
+	// Maps a uniform random number in [0, 1) to a segment, with probability proportional to its probability. The
+	// precision of the number that isn't needed to pick the segment is left in it, as a uniform random number in [0, 1)
+	// for picking a state within the segment.
+	uint64_t sample_segment(double &random_number) const
+	{
+		Segment_Column const &segment_column = sample_segment_column(random_number);
+		return segment_column.segments[pick_side(segment_column, random_number)];
+	}
+	// Maps a uniform random number in [0, 1) to an entry of a segment with a non-zero probability, with probability
+	// proportional to the entry's amplitude squared.
+	size_t sample_state(uint64_t segment, double random_number) const
+	{
+		return sample_entry(segment_entries[segment], random_number);
+	}
+	// Maps a uniform random number in [0, 1) to a table entry, picking a segment and then a state within it.
+	size_t sample(double random_number) const
+	{
+		Segment_Column const &segment_column = sample_segment_column(random_number);
+		Segment_Entries const entries = segment_column.entries[pick_side(segment_column, random_number)];
+		return sample_entry(entries, random_number);
+	}
+
+private:
+	// Returns the segment column a random number picks, and leaves what is left of the number past the column in it.
+	Segment_Column const &sample_segment_column(double &random_number) const
+	{
+		double const scaled = random_number * (double)segment_columns.size();
+		size_t const column = std::min((size_t)scaled, segment_columns.size() - 1);
+		random_number = scaled - (double)column;
+		return segment_columns[column];
+	}
+	// Returns 1 if what is left of a random number keeps the column's own segment and 0 if it picks the alias, and
+	// scales it to a uniform random number in [0, 1).
+	static size_t pick_side(Segment_Column const &segment_column, double &random_number)
+	{
+		size_t const side = random_number < segment_column.threshold;
+		random_number = (random_number - (segment_column.threshold * (double)(1 - side))) * segment_column.scales[side];
+		return side;
+	}
+	size_t sample_entry(Segment_Entries entries, double random_number) const
+	{
+		double const scaled = random_number * (double)entries.num_entries;
+		size_t const offset = std::min((size_t)scaled, (size_t)entries.num_entries - 1);
+		size_t const column = entries.first_entry + offset;
+		return state_columns[column].entries[(scaled - (double)offset) < state_columns[column].threshold];
+	}
+	void build_segment_table();
+	// Turns the probabilities of a run of columns into thresholds and aliases, by Vose's method.
+	void fill_aliases(uint32_t first_column, uint32_t num_columns, double total_probability);
+};
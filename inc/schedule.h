@@ -0,0 +1,32 @@
+#pragma once
+
+#include <complex>
+#include <cstdint>
+#include <vector>
+
+#include "fusion.h"
+#include "kernels.h"
+
+// One sweep over the state vector. A blocked pass applies all of its operations to one block of 2^block_qbits
+// consecutive amplitudes, which stays in cache, before moving on to the next block, and only holds operations that keep
+// within a block: gates on the last block_qbits qbits, which are the low bits of the state index, and tables of phases
+// on any qbits. Other passes hold one operation, applied to the whole state.
+struct Gate_Pass
+{
+	bool is_blocked;
+	std::vector<Fused_Operation> operations;
+};
+
+// Groups the fused operations of a program on num_qbits qbits into passes over blocks of 2^block_qbits amplitudes.
+// Where enough of the operations that follow a gate on a high qbit would then keep within a block, the qbit is swapped
+// with a low one that they don't use, and later operations act on the qbits in their new places. The schedule swaps
+// every qbit back before it ends. The operations' entangled_qbits still name the program's qbits, and the inserted
+// swaps have none, so entanglements can be tracked from them as for the program.
+std::vector<Gate_Pass> schedule_operations(std::vector<Fused_Operation> const &operations, size_t num_qbits, size_t block_qbits);
+
+// Applies one operation of a schedule to a block of a register of num_qbits qbits, with first_index the register index of
+// block[0]. The operation must keep within the block, as those of a blocked pass do. Defined for double and float
+// amplitudes.
+template <typename Real>
+void apply_block_operation(Gate_Kernels<Real> const &kernels, Fused_Operation const &fused_operation, size_t num_qbits,
+                           std::complex<Real> *block, uint64_t first_index, uint64_t num_block_states);
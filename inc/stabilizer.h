@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A Pauli string acting on a stabilizer state's basis states as |s> -> i^phase * (-1)^|s & sign| * |s ^ flip|. Basis
+// states and both masks hold the value of each qbit, packed 64 qbits to a word as a tableau row packs its bits.
+struct Stabilizer_Generator
+{
+	std::vector<uint64_t> flip_words;
+	std::vector<uint64_t> sign_words;
+	uint8_t phase;
+};
+
+// The basis states of a stabilizer state are the seed state combined with any subset of the generators' flip masks, and
+// all have the same magnitude. Applying a generator to a basis state's term gives the term of the state it flips to.
+struct Stabilizer_Support
+{
+	std::vector<uint64_t> seed_words;
+	std::vector<Stabilizer_Generator> generators;
+};
+
+// Aaronson-Gottesman tableau of a stabilizer state: N destabilizer rows followed by N stabilizer rows, each a Pauli
+// string with a sign, taking O(N^2) bits rather than the O(2^N) amplitudes of a state vector. Clifford gates update
+// every row in O(N). Each row's X and Z bits are packed 64 qbits to a word, so multiplying two rows together, as
+// readouts do, works a word at a time. A row with both bits set on a qbit holds Y there. The state is kept up to a
+// global phase.
+class Stabilizer_Tableau
+{
+	size_t num_qbits = 0;
+	size_t num_words = 0;
+	// the X and Z bits of row r are the num_words words from r * num_words, with qbit q at bit q % 64 of word q / 64
+	std::vector<uint64_t> x_words;
+	std::vector<uint64_t> z_words;
+	// one for a negated row
+	std::vector<uint8_t> signs;
+
+public:
+	// Sets the state to all qbits zero.
+	void reset(size_t new_num_qbits);
+
+	size_t get_num_qbits() const { return num_qbits; }
+
+	void apply_hadamard(size_t qbit);
+	void apply_phase(size_t qbit);
+	void apply_phase_dag(size_t qbit);
+	void apply_pauli_x(size_t qbit);
+	void apply_pauli_y(size_t qbit);
+	void apply_pauli_z(size_t qbit);
+	void apply_cnot(size_t control_qbit, size_t target_qbit);
+	void apply_swap(size_t first_qbit, size_t second_qbit);
+
+	// Returns the expectation value, -1, 0 or 1, of the Hermitian Pauli string with the given X and Z bits, laid out as
+	// in a row. Qbits with both bits set hold Y.
+	int get_expectation(uint64_t const *string_x_words, uint64_t const *string_z_words) const;
+	// Returns the expectation value of Z on the qbit, reading one bit of each row: 0 if a stabilizer has X or Y on it,
+	// when either value of the qbit is equally likely, and otherwise 1 or -1 for a qbit that is certainly 0 or 1.
+	int get_z_expectation(size_t qbit) const;
+
+	// Returns the support of the state, in O(N^3 / 64) time.
+	Stabilizer_Support get_support() const;
+
+private:
+	// Returns the sign, -1 or 1, of the product of the stabilizers whose destabilizers anticommute with a string that
+	// commutes with every stabilizer, which is the string's expectation. is_anticommuting(row) tests destabilizer row.
+	template <typename Is_Anticommuting>
+	int get_product_sign(Is_Anticommuting const &is_anticommuting) const;
+};
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <random>
+#include <vector>
+
+#include "qasm.h"
+#include "qsim.h"
+
+struct Sweep_Options
+{
+	int num_runs = 1;
+	size_t num_threads = 1;
+	uint64_t seed = std::mt19937::default_seed;
+	Precision precision = Precision::DOUBLE;
+	Representation representation = Representation::FULL;
+	// the full state is only copied out for each binding when asked for, as it can be far larger than the results
+	bool keep_amplitudes = false;
+};
+
+struct Sweep_Result
+{
+	std::vector<Amplitude> amplitudes;
+	std::vector<Result> results;
+};
+
+// Runs a parameterised program once for each binding of values to its parameters, given in the order of
+// Quantum_Program::get_parameter_names, and returns the results of each binding in the same order. Bindings are
+// shared between threads, each with its own simulator, and binding i is sampled with seed + i so results don't depend
+// on the number of threads.
+std::vector<Sweep_Result> run_sweep(Quantum_Program const &program, std::vector<std::vector<double>> const &bindings,
+                                    Sweep_Options const &options);
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class Thread_Pool
+{
+	struct Range_Function
+	{
+		void const *context;
+		void (*invoke)(void const *context, uint64_t begin, uint64_t end);
+	};
+
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable work_available;
+	std::condition_variable work_complete;
+
+	Range_Function task = {};
+	uint64_t task_size = 0;
+	uint64_t task_generation = 0;
+	size_t num_busy_workers = 0;
+	bool stopping = false;
+
+public:
+	Thread_Pool(size_t num_threads);
+	~Thread_Pool();
+
+	Thread_Pool(Thread_Pool const &) = delete;
+	Thread_Pool &operator=(Thread_Pool const &) = delete;
+
+	size_t get_num_threads() const { return workers.size() + 1; }
+
+	// Splits [0, count) into one contiguous range per thread and calls function(begin, end) for each, returning once
+	// all ranges are complete. The calling thread processes the first range itself.
+	template <typename Function>
+	void parallel_for(uint64_t count, Function const &function)
+	{
+		run({ &function, [](void const *context, uint64_t begin, uint64_t end) {
+			(*static_cast<Function const *>(context))(begin, end);
+		} }, count);
+	}
+
+private:
+	void run(Range_Function function, uint64_t count);
+	void worker_main(size_t worker_index);
+
+	std::pair<uint64_t, uint64_t> get_range(size_t thread_index) const;
+};
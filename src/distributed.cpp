@@ -0,0 +1,470 @@
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <type_traits>
+
+#include "distributed.h"
+#include "gates.h"
+#include "schedule.h"
+
+static size_t count_bits(uint64_t value)
+{
+	size_t num_bits = 0;
+	for (; value != 0; value &= value - 1) {
+		num_bits += 1;
+	}
+	return num_bits;
+}
+
+// the most amplitudes each rank of a pair sends the other at once while swapping qbits
+static constexpr uint64_t max_segment_states = (uint64_t)1 << 16;
+// the most shots rank 0 deals out to the other ranks at once while sampling
+static constexpr uint64_t max_batch_shots = (uint64_t)1 << 16;
+
+// a shot dealt out to the rank holding the sampling segment it picked, with the random number that picks its state
+struct Routed_Shot
+{
+	uint64_t segment;
+	double random_number;
+};
+
+Distributed_QSim::Distributed_QSim(Process_Group &group) :
+	group(group),
+	gate_kernels(&get_gate_kernels<double>(detect_instruction_set())),
+	single_gate_kernels(&get_gate_kernels<float>(gate_kernels->instruction_set))
+{
+	reset();
+}
+
+void Distributed_QSim::set_program(Quantum_Program const *new_program)
+{
+	program = new_program;
+	parameter_values.clear();
+	bind_operations();
+	reset();
+}
+
+void Distributed_QSim::set_seed(uint64_t new_seed)
+{
+	seed = new_seed;
+	num_samplings = 0;
+}
+
+void Distributed_QSim::set_precision(Precision new_precision)
+{
+	precision = new_precision;
+	reset();
+}
+
+void Distributed_QSim::set_parameters(std::vector<double> const &values)
+{
+	parameter_values = values;
+	bind_operations();
+	reset();
+}
+
+void Distributed_QSim::bind_operations()
+{
+	fused_operations.clear();
+	num_prefix_fused_operations = 0;
+	if (!program) {
+		return;
+	}
+
+	std::vector<Operation> operations = program->get_operations();
+	num_prefix_fused_operations = bind_and_fuse_operations(operations, parameter_values, fused_operations).num_prefix_fused_operations;
+}
+
+bool Distributed_QSim::reset()
+{
+	num_qbits = program ? program->get_num_qbits() : DEFAULT_NUM_QBITS;
+	size_t const num_ranks = group.get_num_ranks();
+	num_global_qbits = count_bits(num_ranks - 1);
+	chunk.clear();
+	single_chunk.clear();
+	results.clear();
+	if ((num_ranks & (num_ranks - 1)) != 0 || num_qbits < num_global_qbits + MIN_LOCAL_QBITS ||
+	    num_qbits > num_global_qbits + MAX_QBITS) {
+		num_local_qbits = 0;
+		return false;
+	}
+
+	// the state starts with every qbit zero, which is the first amplitude of rank 0
+	num_local_qbits = num_qbits - num_global_qbits;
+	if (precision == Precision::SINGLE) {
+		single_chunk.assign(get_num_chunk_states(), 0.0f);
+		single_chunk[0] = group.get_rank() == 0 ? 1.0f : 0.0f;
+	} else {
+		chunk.assign(get_num_chunk_states(), 0.0);
+		chunk[0] = group.get_rank() == 0 ? 1.0 : 0.0;
+	}
+	return true;
+}
+
+bool Distributed_QSim::run(int num_runs)
+{
+	if (!reset()) {
+		return false;
+	}
+	auto const prefix_end = fused_operations.cbegin() + num_prefix_fused_operations;
+	if (precision == Precision::SINGLE) {
+		if (!perform_fused_operations<float>(fused_operations.cbegin(), prefix_end) ||
+		    !perform_fused_operations<float>(prefix_end, fused_operations.cend())) {
+			return false;
+		}
+	} else if (!perform_fused_operations<double>(fused_operations.cbegin(), prefix_end) ||
+	           !perform_fused_operations<double>(prefix_end, fused_operations.cend())) {
+		return false;
+	}
+	return sample(num_runs);
+}
+
+template <typename Real>
+static void collect_amplitudes(std::vector<std::complex<Real>> const &chunk, uint64_t first_state, std::vector<Amplitude> &amplitudes)
+{
+	for (uint64_t index = 0; index < chunk.size(); ++index) {
+		if (std::abs(chunk[index]) != (Real)0.0) {
+			amplitudes.push_back({ first_state + index, std::complex<double>(chunk[index]) });
+		}
+	}
+}
+
+std::vector<Amplitude> Distributed_QSim::get_amplitudes() const
+{
+	std::vector<Amplitude> amplitudes;
+	if (precision == Precision::SINGLE) {
+		collect_amplitudes(get_chunk<float>(), get_first_state(), amplitudes);
+	} else {
+		collect_amplitudes(get_chunk<double>(), get_first_state(), amplitudes);
+	}
+	return amplitudes;
+}
+
+bool Distributed_QSim::gather_amplitudes(std::vector<Amplitude> &amplitudes) const
+{
+	std::vector<Amplitude> const rank_amplitudes = get_amplitudes();
+	uint64_t num_rank_amplitudes = rank_amplitudes.size();
+	if (group.get_rank() != 0) {
+		amplitudes.clear();
+		return group.send(0, &num_rank_amplitudes, sizeof(num_rank_amplitudes)) &&
+		       group.send(0, rank_amplitudes.data(), rank_amplitudes.size() * sizeof(Amplitude));
+	}
+
+	// the ranks hold consecutive ranges of states, so joining them in order of rank keeps the amplitudes in order
+	amplitudes = rank_amplitudes;
+	for (size_t rank = 1; rank < group.get_num_ranks(); ++rank) {
+		if (!group.receive(rank, &num_rank_amplitudes, sizeof(num_rank_amplitudes))) {
+			return false;
+		}
+		size_t const num_amplitudes = amplitudes.size();
+		amplitudes.resize(num_amplitudes + num_rank_amplitudes);
+		if (!group.receive(rank, amplitudes.data() + num_amplitudes, num_rank_amplitudes * sizeof(Amplitude))) {
+			return false;
+		}
+	}
+	return true;
+}
+
+template <typename Real>
+void Distributed_QSim::build_alias_table()
+{
+	std::vector<std::complex<Real>> const &state = get_chunk<Real>();
+	alias_table.build(state.data(), state.size());
+}
+
+// Returns the index in the chunk of the state a random number picks within a segment, as a QSim taking one shot does.
+template <typename Real>
+static uint64_t pick_segment_state(std::vector<std::complex<Real>> const &chunk, uint64_t segment, double random_number)
+{
+	uint64_t const segment_size = get_segment_size(chunk.size());
+	std::complex<Real> const *segment_state = chunk.data() + (segment * segment_size);
+	std::optional<uint64_t> const index = pick_by_cumulative_probability(segment_size, random_number, [&](uint64_t index) {
+		return std::norm(std::complex<double>(segment_state[index]));
+	});
+	return (segment * segment_size) + index.value_or(0);
+}
+
+bool Distributed_QSim::sample(int num_runs)
+{
+	// Rank 0 gathers the probability of every sampling segment and picks the segment of each shot with the numbers a
+	// QSim on one thread draws, and the rank holding the segment picks its state with the next number from tables of
+	// its own, which are those of QSim for the same states. The results are the same as that QSim's for the same seed.
+	if (precision == Precision::SINGLE) {
+		build_alias_table<float>();
+	} else {
+		build_alias_table<double>();
+	}
+	uint64_t const sampling_seed = split_mix(seed ^ split_mix(num_samplings));
+	num_samplings += 1;
+	size_t const rank = group.get_rank();
+	size_t const num_ranks = group.get_num_ranks();
+	uint64_t const num_chunk_segments = alias_table.get_num_segments();
+
+	Alias_Table segment_table;
+	if (rank == 0) {
+		std::vector<double> segment_probabilities(num_chunk_segments * num_ranks);
+		std::copy(alias_table.get_segment_probabilities(), alias_table.get_segment_probabilities() + num_chunk_segments,
+		          segment_probabilities.begin());
+		for (size_t other_rank = 1; other_rank < num_ranks; ++other_rank) {
+			if (!group.receive(other_rank, segment_probabilities.data() + (other_rank * num_chunk_segments),
+			                   num_chunk_segments * sizeof(double))) {
+				return false;
+			}
+		}
+		segment_table.build_segments(segment_probabilities.data(), segment_probabilities.size());
+	} else if (!group.send(0, alias_table.get_segment_probabilities(), num_chunk_segments * sizeof(double))) {
+		return false;
+	}
+
+	// the shots are dealt out in batches, so no rank holds the random numbers of them all
+	std::vector<uint32_t> counts(alias_table.size(), 0);
+	std::optional<uint64_t> single_state;
+	auto const count_shots = [&](std::vector<Routed_Shot> const &shots) {
+		for (auto const &shot : shots) {
+			if (num_runs == 1) {
+				single_state = precision == Precision::SINGLE ? pick_segment_state(get_chunk<float>(), shot.segment, shot.random_number) :
+				                                                pick_segment_state(get_chunk<double>(), shot.segment, shot.random_number);
+			} else {
+				counts[alias_table.sample_state(shot.segment, shot.random_number)] += 1;
+			}
+		}
+	};
+	std::vector<std::vector<Routed_Shot>> rank_shots(rank == 0 ? num_ranks : 1);
+	std::mt19937_64 rng(split_mix(sampling_seed));
+	std::uniform_real_distribution<double> random_distribution(0.0, 1.0);
+	for (uint64_t first_run = 0; first_run < (uint64_t)num_runs; first_run += max_batch_shots) {
+		uint64_t const num_batch_shots = std::min(max_batch_shots, (uint64_t)num_runs - first_run);
+		if (rank != 0) {
+			uint64_t num_rank_shots = 0;
+			if (!group.receive(0, &num_rank_shots, sizeof(num_rank_shots))) {
+				return false;
+			}
+			rank_shots[0].resize(num_rank_shots);
+			if (!group.receive(0, rank_shots[0].data(), num_rank_shots * sizeof(Routed_Shot))) {
+				return false;
+			}
+			count_shots(rank_shots[0]);
+			continue;
+		}
+
+		for (auto &shots : rank_shots) {
+			shots.clear();
+		}
+		for (uint64_t run = 0; run < num_batch_shots && !segment_table.is_empty(); ++run) {
+			// a single shot scans the segments with a number of its own as QSim does, and other shots use the precision the
+			// alias table leaves over to pick the state
+			double random_number = random_distribution(rng);
+			uint64_t segment = 0;
+			if (num_runs == 1) {
+				double const *probabilities = segment_table.get_segment_probabilities();
+				segment = pick_by_cumulative_probability(segment_table.get_num_segments(), random_number,
+				                                         [&](uint64_t segment) { return probabilities[segment]; }).value_or(0);
+				random_number = random_distribution(rng);
+			} else {
+				segment = segment_table.sample_segment(random_number);
+			}
+			rank_shots[segment / num_chunk_segments].push_back({ segment % num_chunk_segments, random_number });
+		}
+		for (size_t other_rank = 1; other_rank < num_ranks; ++other_rank) {
+			uint64_t const num_rank_shots = rank_shots[other_rank].size();
+			if (!group.send(other_rank, &num_rank_shots, sizeof(num_rank_shots)) ||
+			    !group.send(other_rank, rank_shots[other_rank].data(), num_rank_shots * sizeof(Routed_Shot))) {
+				return false;
+			}
+		}
+		count_shots(rank_shots[0]);
+	}
+
+	results.clear();
+	if (single_state) {
+		results.push_back({ get_first_state() + *single_state, 1 });
+	}
+	for (size_t entry = 0; entry < alias_table.size(); ++entry) {
+		if (counts[entry] > 0) {
+			results.push_back({ get_first_state() + alias_table.get_state(entry), counts[entry] });
+		}
+	}
+
+	// as with the amplitudes, the results of each rank follow those of the ranks before it
+	uint64_t num_rank_results = results.size();
+	if (rank != 0) {
+		bool const is_sent = group.send(0, &num_rank_results, sizeof(num_rank_results)) &&
+		                     group.send(0, results.data(), results.size() * sizeof(Result));
+		results.clear();
+		return is_sent;
+	}
+	for (size_t other_rank = 1; other_rank < num_ranks; ++other_rank) {
+		if (!group.receive(other_rank, &num_rank_results, sizeof(num_rank_results))) {
+			return false;
+		}
+		size_t const num_results = results.size();
+		results.resize(num_results + num_rank_results);
+		if (!group.receive(other_rank, results.data() + num_results, num_rank_results * sizeof(Result))) {
+			return false;
+		}
+	}
+	return true;
+}
+
+template <typename Real>
+std::vector<std::complex<Real>> &Distributed_QSim::get_chunk()
+{
+	if constexpr (std::is_same_v<Real, float>) {
+		return single_chunk;
+	} else {
+		return chunk;
+	}
+}
+
+template <typename Real>
+std::vector<std::complex<Real>> const &Distributed_QSim::get_chunk() const
+{
+	if constexpr (std::is_same_v<Real, float>) {
+		return single_chunk;
+	} else {
+		return chunk;
+	}
+}
+
+template <typename Real>
+Gate_Kernels<Real> const &Distributed_QSim::get_kernels() const
+{
+	if constexpr (std::is_same_v<Real, float>) {
+		return *single_gate_kernels;
+	} else {
+		return *gate_kernels;
+	}
+}
+
+template <typename Real>
+bool Distributed_QSim::perform_fused_operations(std::vector<Fused_Operation>::const_iterator begin,
+                                                std::vector<Fused_Operation>::const_iterator end)
+{
+	if (cache_block_qbits == 0 || num_qbits <= cache_block_qbits) {
+		for (auto fused_operation = begin; fused_operation != end; ++fused_operation) {
+			if (!perform_fused_operation<Real>(*fused_operation)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// the passes are those QSim runs, so the qbits are moved between places as they are there
+	for (auto const &pass : schedule_operations(std::vector<Fused_Operation>(begin, end), num_qbits, cache_block_qbits)) {
+		if (!pass.is_blocked || cache_block_qbits > num_local_qbits) {
+			for (auto const &operation : pass.operations) {
+				if (!perform_fused_operation<Real>(operation)) {
+					return false;
+				}
+			}
+			continue;
+		}
+
+		std::complex<Real> *state = get_chunk<Real>().data();
+		uint64_t const num_block_states = (uint64_t)1 << cache_block_qbits;
+		for (uint64_t first_index = 0; first_index < get_num_chunk_states(); first_index += num_block_states) {
+			for (auto const &operation : pass.operations) {
+				apply_block_operation(get_kernels<Real>(), operation, num_qbits, state + first_index,
+				                      get_first_state() + first_index, num_block_states);
+			}
+		}
+	}
+	return true;
+}
+
+template <typename Real>
+bool Distributed_QSim::perform_fused_operation(Fused_Operation const &fused_operation)
+{
+	// A table of phases only depends on each amplitude's index, so like an operation on local qbits it applies to each
+	// chunk on its own.
+	std::vector<std::complex<Real>> &state = get_chunk<Real>();
+	uint64_t local_mask = 0;
+	size_t num_global_operands = 0;
+	for (uint16_t qbit : fused_operation.qbits) {
+		uint64_t const bit = num_qbits - 1 - qbit;
+		local_mask |= bit < num_local_qbits ? (uint64_t)1 << bit : 0;
+		num_global_operands += bit < num_local_qbits ? 0 : 1;
+	}
+	if (fused_operation.kind == Fused_Kind::DIAGONAL || num_global_operands == 0) {
+		apply_block_operation(get_kernels<Real>(), fused_operation, num_qbits, state.data(), get_first_state(), state.size());
+		return true;
+	}
+
+	// Each global qbit takes the place of the highest local qbit the operation doesn't act on. Those are at or above
+	// MIN_VECTOR_QBIT_BIT, as the global qbits are in a single process, so the amplitudes go through the same kernels.
+	std::array<uint64_t, MAX_FUSED_QBITS> swapped_global_bits;
+	std::array<uint64_t, MAX_FUSED_QBITS> swapped_local_bits;
+	size_t num_swaps = 0;
+	Fused_Operation local_operation = fused_operation;
+	auto const to_local_qbit = [&](uint16_t qbit) {
+		uint64_t const bit = num_qbits - 1 - qbit;
+		for (size_t swap = 0; swap < num_swaps; ++swap) {
+			if (bit >= num_local_qbits && swapped_global_bits[swap] == bit - num_local_qbits) {
+				return (uint16_t)(num_qbits - 1 - swapped_local_bits[swap]);
+			}
+		}
+		return qbit;
+	};
+	uint64_t local_bit = num_local_qbits;
+	for (uint16_t qbit : fused_operation.qbits) {
+		uint64_t const bit = num_qbits - 1 - qbit;
+		if (bit < num_local_qbits) {
+			continue;
+		}
+		do {
+			local_bit -= 1;
+		} while ((local_mask >> local_bit) & 1);
+		swapped_global_bits[num_swaps] = bit - num_local_qbits;
+		swapped_local_bits[num_swaps] = local_bit;
+		num_swaps += 1;
+	}
+	for (auto &qbit : local_operation.qbits) {
+		qbit = to_local_qbit(qbit);
+	}
+	if (fused_operation.kind == Fused_Kind::GATE) {
+		for (uint8_t index = 0; index < get_num_operands(fused_operation.operation.gate); ++index) {
+			local_operation.operation.operands[index] = to_local_qbit(fused_operation.operation.operands[index]);
+		}
+	}
+
+	// the buffer holds a segment to send and one received, and is freed with the operation done
+	std::vector<std::complex<Real>> buffer(2 * std::min(max_segment_states, get_num_chunk_states() >> 1));
+	for (size_t swap = 0; swap < num_swaps; ++swap) {
+		if (!swap_global_qbit(swapped_global_bits[swap], swapped_local_bits[swap], buffer)) {
+			return false;
+		}
+	}
+	apply_block_operation(get_kernels<Real>(), local_operation, num_qbits, state.data(), get_first_state(), state.size());
+	for (size_t swap = num_swaps; swap-- > 0;) {
+		if (!swap_global_qbit(swapped_global_bits[swap], swapped_local_bits[swap], buffer)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+template <typename Real>
+bool Distributed_QSim::swap_global_qbit(size_t global_bit, uint64_t local_bit, std::vector<std::complex<Real>> &buffer)
+{
+	// The amplitudes whose local bit differs from this rank's global bit belong with the rank that differs from this one
+	// only in that bit, and take the places of those it sends back, so each rank of the pair exchanges half its chunk.
+	std::complex<Real> *state = get_chunk<Real>().data();
+	size_t const peer = group.get_rank() ^ ((size_t)1 << global_bit);
+	uint64_t const moved_mask = (uint64_t)(((group.get_rank() >> global_bit) & 1) ^ 1) << local_bit;
+	uint64_t const num_moved_states = get_num_chunk_states() >> 1;
+	uint64_t const num_segment_states = buffer.size() >> 1;
+	std::complex<Real> *sent = buffer.data();
+	std::complex<Real> *received = buffer.data() + num_segment_states;
+	for (uint64_t first = 0; first < num_moved_states; first += num_segment_states) {
+		for (uint64_t index = 0; index < num_segment_states; ++index) {
+			sent[index] = state[insert_zero_bit(first + index, local_bit) | moved_mask];
+		}
+		if (!group.exchange(peer, sent, received, num_segment_states * sizeof(std::complex<Real>))) {
+			return false;
+		}
+		for (uint64_t index = 0; index < num_segment_states; ++index) {
+			state[insert_zero_bit(first + index, local_bit) | moved_mask] = received[index];
+		}
+	}
+	return true;
+}
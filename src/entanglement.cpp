@@ -0,0 +1,54 @@
+#include <cstdint>
+#include <utility>
+
+#include "entanglement.h"
+
+void Entanglement_Tracker::reset(size_t num_qbits)
+{
+	parents.resize(num_qbits);
+	next_members.resize(num_qbits);
+	group_sizes.assign(num_qbits, 1);
+	for (size_t qbit = 0; qbit < num_qbits; ++qbit) {
+		parents[qbit] = (uint16_t)qbit;
+		next_members[qbit] = (uint16_t)qbit;
+	}
+	num_groups = num_qbits;
+}
+
+uint16_t Entanglement_Tracker::merge(uint16_t first_qbit, uint16_t second_qbit)
+{
+	uint16_t root = find_root(first_qbit);
+	uint16_t other_root = find_root(second_qbit);
+	if (root == other_root) {
+		return root;
+	}
+
+	// the smaller group joins the larger, and swapping the successors of two members splices their cycles into one
+	if (group_sizes[root] < group_sizes[other_root]) {
+		std::swap(root, other_root);
+	}
+	parents[other_root] = root;
+	group_sizes[root] += group_sizes[other_root];
+	std::swap(next_members[root], next_members[other_root]);
+	num_groups -= 1;
+	return root;
+}
+
+std::vector<std::vector<uint16_t>> Entanglement_Tracker::get_groups() const
+{
+	// walking the qbits in order visits each group first at its lowest qbit and fills it in ascending order
+	std::vector<std::vector<uint16_t>> groups;
+	groups.reserve(num_groups);
+	// there are never as many groups as qbits once one is found, so the qbit count marks a group not yet found
+	std::vector<size_t> group_indices(parents.size(), parents.size());
+	for (size_t qbit = 0; qbit < parents.size(); ++qbit) {
+		uint16_t const root = find_root((uint16_t)qbit);
+		if (group_indices[root] == parents.size()) {
+			group_indices[root] = groups.size();
+			groups.emplace_back();
+			groups.back().reserve(group_sizes[root]);
+		}
+		groups[group_indices[root]].push_back((uint16_t)qbit);
+	}
+	return groups;
+}
@@ -0,0 +1,35 @@
+#include "format.h"
+
+std::string to_binary_string(uint64_t state, size_t num_qbits)
+{
+	std::string binary_string(num_qbits, '0');
+	for (size_t shift = 0; shift < num_qbits; ++shift) {
+		binary_string[shift] = (state & ((uint64_t)1 << shift)) ? '1' : '0';
+	}
+	return binary_string;
+}
+
+std::string to_binary_string(std::vector<bool> const &qbits)
+{
+	std::string binary_string(qbits.size(), '0');
+	for (size_t qbit = 0; qbit < qbits.size(); ++qbit) {
+		binary_string[qbits.size() - 1 - qbit] = qbits[qbit] ? '1' : '0';
+	}
+	return binary_string;
+}
+
+void write_results_csv(std::ostream &stream, std::vector<Result> const &results, size_t num_qbits)
+{
+	stream << "state,occurrences\n";
+	for (auto const &result : results) {
+		stream << '|' << to_binary_string(result.state, num_qbits) << ">," << result.num_times << '\n';
+	}
+}
+
+void write_results_csv(std::ostream &stream, std::vector<Wide_Result> const &results)
+{
+	stream << "state,occurrences\n";
+	for (auto const &result : results) {
+		stream << '|' << to_binary_string(result.qbits) << ">," << result.num_times << '\n';
+	}
+}
@@ -0,0 +1,303 @@
+#include <algorithm>
+#include <iterator>
+
+#include "fusion.h"
+#include "gates.h"
+
+static bool shares_qbit(Operation const &lhs, Operation const &rhs)
+{
+	for (uint8_t lhs_index = 0; lhs_index < get_num_operands(lhs.gate); ++lhs_index) {
+		for (uint8_t rhs_index = 0; rhs_index < get_num_operands(rhs.gate); ++rhs_index) {
+			if (lhs.operands[lhs_index] == rhs.operands[rhs_index]) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+static std::vector<Operation> cancel_inverse_pairs(std::vector<Operation> const &operations)
+{
+	// an operation cancels the latest kept operation sharing a qbit with it if that operation is its inverse, as
+	// nothing between the two touches their qbits
+	std::vector<Operation> kept;
+	for (auto const &operation : operations) {
+		if (operation.gate == Gate::IDENTITY) {
+			continue;
+		}
+		auto const previous = std::find_if(kept.rbegin(), kept.rend(), [&](Operation const &candidate) {
+			return shares_qbit(candidate, operation);
+		});
+		if (previous != kept.rend() && is_inverse(*previous, operation)) {
+			kept.erase(std::next(previous).base());
+		} else {
+			kept.push_back(operation);
+		}
+	}
+	return kept;
+}
+
+static Fused_Operation make_gate_operation(Operation const &operation)
+{
+	Fused_Operation fused = { Fused_Kind::GATE, operation };
+	for (uint8_t index = 0; index < get_num_operands(operation.gate); ++index) {
+		fused.qbits.push_back(operation.operands[index]);
+	}
+	std::sort(fused.qbits.begin(), fused.qbits.end());
+	if (fused.qbits.size() > 1) {
+		fused.entangled_qbits.push_back(fused.qbits);
+	}
+	return fused;
+}
+
+static std::vector<Fused_Operation> merge_single_qbit_runs(std::vector<Operation> const &operations)
+{
+	// Single qbit gates on a qbit are held back and multiplied together until a multi qbit gate touches the qbit. This
+	// only reorders gates on different qbits, which commute.
+	struct Pending_Run
+	{
+		size_t num_gates = 0;
+		Operation first_operation;
+		Gate_Matrix<1> gate;
+	};
+
+	std::vector<Fused_Operation> fused_operations;
+	std::vector<Pending_Run> pending_runs;
+
+	auto flush = [&](uint16_t qbit) {
+		if (qbit >= pending_runs.size() || pending_runs[qbit].num_gates == 0) {
+			return;
+		}
+		Pending_Run &run = pending_runs[qbit];
+		if (run.num_gates == 1) {
+			fused_operations.push_back(make_gate_operation(run.first_operation));
+		} else {
+			Gate_Matrix<1> const identity = { 1.0, 0.0, 0.0, 1.0 };
+			bool is_identity = true;
+			for (size_t element = 0; element < 4; ++element) {
+				is_identity = is_identity && std::abs(run.gate[element] - identity[element]) < 1e-12;
+			}
+			if (!is_identity) {
+				fused_operations.push_back({ Fused_Kind::MATRIX, run.first_operation, { qbit },
+				                             std::vector<std::complex<double>>(run.gate.elements.begin(), run.gate.elements.end()) });
+			}
+		}
+		run.num_gates = 0;
+	};
+
+	for (auto const &operation : operations) {
+		uint8_t const num_operands = get_num_operands(operation.gate);
+		if (num_operands == 1) {
+			uint16_t const qbit = operation.operands[0];
+			if (qbit >= pending_runs.size()) {
+				pending_runs.resize(qbit + 1);
+			}
+			Pending_Run &run = pending_runs[qbit];
+			if (run.num_gates == 0) {
+				run.first_operation = operation;
+				run.gate = get_gate_matrix(operation);
+			} else {
+				run.gate = get_gate_matrix(operation) * run.gate;
+			}
+			run.num_gates += 1;
+		} else {
+			for (uint8_t index = 0; index < num_operands; ++index) {
+				flush(operation.operands[index]);
+			}
+			fused_operations.push_back(make_gate_operation(operation));
+		}
+	}
+
+	for (size_t qbit = 0; qbit < pending_runs.size(); ++qbit) {
+		flush((uint16_t)qbit);
+	}
+
+	return fused_operations;
+}
+
+static std::optional<std::array<std::complex<double>, 2>> get_fused_diagonal_phases(Fused_Operation const &fused)
+{
+	if (fused.kind == Fused_Kind::GATE) {
+		return get_diagonal_phases(fused.operation);
+	}
+	if (fused.kind == Fused_Kind::MATRIX && fused.qbits.size() == 1 && fused.elements[1] == 0.0 && fused.elements[2] == 0.0) {
+		return std::array<std::complex<double>, 2> { fused.elements[0], fused.elements[3] };
+	}
+	return std::optional<std::array<std::complex<double>, 2>>();
+}
+
+static std::vector<Fused_Operation> combine_diagonal_runs(std::vector<Fused_Operation> const &operations)
+{
+	std::vector<Fused_Operation> fused_operations;
+	for (size_t first = 0; first < operations.size();) {
+		std::vector<uint16_t> qbits;
+		size_t end = first;
+		for (; end < operations.size() && get_fused_diagonal_phases(operations[end]); ++end) {
+			uint16_t const qbit = operations[end].qbits[0];
+			if (std::find(qbits.begin(), qbits.end(), qbit) == qbits.end()) {
+				if (qbits.size() == MAX_FUSED_DIAGONAL_QBITS) {
+					break;
+				}
+				qbits.push_back(qbit);
+			}
+		}
+
+		if (end - first < 2) {
+			fused_operations.push_back(operations[first]);
+			first += 1;
+			continue;
+		}
+
+		std::sort(qbits.begin(), qbits.end());
+		Fused_Operation diagonal = { Fused_Kind::DIAGONAL, operations[first].operation, qbits };
+		diagonal.elements.assign((size_t)1 << qbits.size(), 1.0);
+		for (size_t index = first; index < end; ++index) {
+			std::array<std::complex<double>, 2> const phases = *get_fused_diagonal_phases(operations[index]);
+			size_t const position = std::find(qbits.begin(), qbits.end(), operations[index].qbits[0]) - qbits.begin();
+			size_t const table_bit = qbits.size() - 1 - position;
+			for (size_t table_index = 0; table_index < diagonal.elements.size(); ++table_index) {
+				diagonal.elements[table_index] *= phases[(table_index >> table_bit) & 1];
+			}
+		}
+		fused_operations.push_back(diagonal);
+		first = end;
+	}
+	return fused_operations;
+}
+
+static void apply_to_local_state(Fused_Operation const &operation, std::vector<uint16_t> const &qbits,
+                                 std::vector<std::complex<double>> &state)
+{
+	auto local_bit = [&](uint16_t qbit) {
+		return qbits.size() - 1 - (std::find(qbits.begin(), qbits.end(), qbit) - qbits.begin());
+	};
+
+	Gate const gate = operation.kind == Fused_Kind::GATE ? operation.operation.gate : Gate::IDENTITY;
+	if (gate == Gate::CNOT || gate == Gate::TOFFOLI) {
+		uint8_t const num_controls = get_num_operands(gate) - 1;
+		size_t control_mask = 0;
+		for (uint8_t index = 0; index < num_controls; ++index) {
+			control_mask |= (size_t)1 << local_bit(operation.operation.operands[index]);
+		}
+		size_t const target_mask = (size_t)1 << local_bit(operation.operation.operands[num_controls]);
+		for (size_t index = 0; index < state.size(); ++index) {
+			if ((index & control_mask) == control_mask && !(index & target_mask)) {
+				std::swap(state[index], state[index | target_mask]);
+			}
+		}
+	} else if (gate == Gate::SWAP) {
+		size_t const first_mask = (size_t)1 << local_bit(operation.operation.operands[0]);
+		size_t const second_mask = (size_t)1 << local_bit(operation.operation.operands[1]);
+		for (size_t index = 0; index < state.size(); ++index) {
+			if ((index & first_mask) && !(index & second_mask)) {
+				std::swap(state[index], state[(index ^ first_mask) | second_mask]);
+			}
+		}
+	} else {
+		Gate_Matrix<1> const matrix = operation.kind == Fused_Kind::GATE
+			? get_gate_matrix(operation.operation)
+			: Gate_Matrix<1>::from_elements(operation.elements.data());
+		size_t const mask = (size_t)1 << local_bit(operation.qbits[0]);
+		for (size_t index = 0; index < state.size(); ++index) {
+			if (!(index & mask)) {
+				std::complex<double> const zero_amplitude = state[index];
+				std::complex<double> const one_amplitude = state[index | mask];
+				state[index] = (matrix[0] * zero_amplitude) + (matrix[1] * one_amplitude);
+				state[index | mask] = (matrix[2] * zero_amplitude) + (matrix[3] * one_amplitude);
+			}
+		}
+	}
+}
+
+static Fused_Operation make_dense_block(std::vector<Fused_Operation> const &operations, std::vector<uint16_t> qbits)
+{
+	std::sort(qbits.begin(), qbits.end());
+	Fused_Operation block = { Fused_Kind::MATRIX, operations[0].operation, qbits };
+
+	// build the matrix a column at a time by applying the block to each basis state
+	size_t const size = (size_t)1 << qbits.size();
+	block.elements.resize(size * size);
+	std::vector<std::complex<double>> column(size);
+	for (size_t column_index = 0; column_index < size; ++column_index) {
+		std::fill(column.begin(), column.end(), 0.0);
+		column[column_index] = 1.0;
+		for (auto const &operation : operations) {
+			apply_to_local_state(operation, qbits, column);
+		}
+		for (size_t row_index = 0; row_index < size; ++row_index) {
+			block.elements[(row_index * size) + column_index] = column[row_index];
+		}
+	}
+
+	for (auto const &operation : operations) {
+		block.entangled_qbits.insert(block.entangled_qbits.end(), operation.entangled_qbits.begin(), operation.entangled_qbits.end());
+	}
+	return block;
+}
+
+static std::vector<Fused_Operation> form_dense_blocks(std::vector<Fused_Operation> const &operations)
+{
+	std::vector<Fused_Operation> fused_operations;
+	std::vector<Fused_Operation> block;
+	std::vector<uint16_t> block_qbits;
+
+	auto flush = [&]() {
+		// a dense block over n qbits costs 2^n multiplies per amplitude, so it only replaces at least n passes
+		if (block.size() > 1 && block.size() >= block_qbits.size()) {
+			fused_operations.push_back(make_dense_block(block, block_qbits));
+		} else {
+			fused_operations.insert(fused_operations.end(), block.begin(), block.end());
+		}
+		block.clear();
+		block_qbits.clear();
+	};
+
+	for (auto const &operation : operations) {
+		if (operation.kind == Fused_Kind::DIAGONAL) {
+			flush();
+			fused_operations.push_back(operation);
+			continue;
+		}
+
+		std::vector<uint16_t> qbits = block_qbits;
+		for (uint16_t qbit : operation.qbits) {
+			if (std::find(qbits.begin(), qbits.end(), qbit) == qbits.end()) {
+				qbits.push_back(qbit);
+			}
+		}
+		if (qbits.size() > MAX_FUSED_QBITS) {
+			flush();
+			qbits = operation.qbits;
+		}
+		block.push_back(operation);
+		block_qbits = qbits;
+	}
+	flush();
+
+	return fused_operations;
+}
+
+std::vector<Fused_Operation> fuse_operations(std::vector<Operation> const &operations)
+{
+	return form_dense_blocks(combine_diagonal_runs(merge_single_qbit_runs(cancel_inverse_pairs(operations))));
+}
+
+Fused_Split bind_and_fuse_operations(std::vector<Operation> &operations, std::vector<double> const &parameter_values,
+                                     std::vector<Fused_Operation> &fused_operations)
+{
+	for (auto &operation : operations) {
+		if (operation.parameter != NO_PARAMETER) {
+			operation.immediate = operation.parameter < parameter_values.size() ? parameter_values[operation.parameter] : 0.0;
+		}
+	}
+
+	auto const first_parameterised = std::find_if(operations.begin(), operations.end(),
+	                                              [](Operation const &operation) { return operation.parameter != NO_PARAMETER; });
+	fused_operations = fuse_operations(std::vector<Operation>(operations.begin(), first_parameterised));
+	Fused_Split const split = { (size_t)(first_parameterised - operations.begin()), fused_operations.size() };
+	if (first_parameterised != operations.end()) {
+		std::vector<Fused_Operation> suffix = fuse_operations(std::vector<Operation>(first_parameterised, operations.end()));
+		std::move(suffix.begin(), suffix.end(), std::back_inserter(fused_operations));
+	}
+	return split;
+}
@@ -0,0 +1,113 @@
+#include <algorithm>
+
+#include "constants.h"
+#include "gates.h"
+
+using namespace std::literals;
+
+static constexpr Gate_Matrix<1> identity = {
+	1.0, 0.0,
+	0.0, 1.0
+};
+
+static constexpr Gate_Matrix<1> hadamard = {
+	CONST_SQRT1_2, CONST_SQRT1_2,
+	CONST_SQRT1_2, -CONST_SQRT1_2
+};
+
+static constexpr Gate_Matrix<1> pauli_x = {
+	0.0, 1.0,
+	1.0, 0.0
+};
+
+static constexpr Gate_Matrix<1> pauli_y = {
+	0.0, { 0.0, -1.0 },
+	{ 0.0, 1.0 }, 0.0
+};
+
+static Gate_Matrix<1> build_rx(double theta)
+{
+	return {
+		std::cos(theta / 2.0), -1.0i * std::sin(theta / 2.0),
+		-1.0i * std::sin(theta / 2.0), std::cos(theta / 2.0)
+	};
+}
+
+static Gate_Matrix<1> build_ry(double theta)
+{
+	return {
+		std::cos(theta / 2.0), -std::sin(theta / 2.0),
+		-std::sin(theta / 2.0), std::cos(theta / 2.0)
+	};
+}
+
+Gate_Matrix<1> get_gate_matrix(Operation const &operation)
+{
+	switch (operation.gate) {
+		case Gate::HADAMARD: return hadamard;
+		case Gate::PAULI_X: return pauli_x;
+		case Gate::PAULI_Y: return pauli_y;
+		case Gate::R_X: return build_rx(operation.immediate);
+		case Gate::R_Y: return build_ry(operation.immediate);
+		default: break;
+	}
+
+	std::optional<std::array<std::complex<double>, 2>> const phases = get_diagonal_phases(operation);
+	if (phases) {
+		return {
+			(*phases)[0], 0.0,
+			0.0, (*phases)[1]
+		};
+	}
+	return identity;
+}
+
+std::optional<std::array<std::complex<double>, 2>> get_diagonal_phases(Operation const &operation)
+{
+	switch (operation.gate) {
+		case Gate::IDENTITY: return std::array<std::complex<double>, 2> { 1.0, 1.0 };
+		case Gate::PAULI_Z: return std::array<std::complex<double>, 2> { 1.0, -1.0 };
+		case Gate::S: return std::array<std::complex<double>, 2> { 1.0, 1.0i };
+		case Gate::S_DAG: return std::array<std::complex<double>, 2> { 1.0, -1.0i };
+		case Gate::T: return std::array<std::complex<double>, 2> { 1.0, { CONST_SQRT1_2, CONST_SQRT1_2 } };
+		case Gate::T_DAG: return std::array<std::complex<double>, 2> { 1.0, { CONST_SQRT1_2, -CONST_SQRT1_2 } };
+		case Gate::R_Z: return std::array<std::complex<double>, 2> {
+			std::exp(-1.0i * (operation.immediate / 2.0)),
+			std::exp(1.0i * (operation.immediate / 2.0))
+		};
+		default: return std::optional<std::array<std::complex<double>, 2>>();
+	}
+}
+
+bool is_inverse(Operation const &lhs, Operation const &rhs)
+{
+	switch (lhs.gate) {
+		case Gate::HADAMARD:
+		case Gate::PAULI_X:
+		case Gate::PAULI_Y:
+		case Gate::PAULI_Z:
+			return rhs.gate == lhs.gate && rhs.operands[0] == lhs.operands[0];
+		case Gate::CNOT:
+			return rhs.gate == Gate::CNOT && rhs.operands[0] == lhs.operands[0] && rhs.operands[1] == lhs.operands[1];
+		case Gate::SWAP:
+			return rhs.gate == Gate::SWAP &&
+			       std::minmax(lhs.operands[0], lhs.operands[1]) == std::minmax(rhs.operands[0], rhs.operands[1]);
+		case Gate::TOFFOLI:
+			return rhs.gate == Gate::TOFFOLI && rhs.operands[2] == lhs.operands[2] &&
+			       std::minmax(lhs.operands[0], lhs.operands[1]) == std::minmax(rhs.operands[0], rhs.operands[1]);
+		case Gate::S:
+			return rhs.gate == Gate::S_DAG && rhs.operands[0] == lhs.operands[0];
+		case Gate::S_DAG:
+			return rhs.gate == Gate::S && rhs.operands[0] == lhs.operands[0];
+		case Gate::T:
+			return rhs.gate == Gate::T_DAG && rhs.operands[0] == lhs.operands[0];
+		case Gate::T_DAG:
+			return rhs.gate == Gate::T && rhs.operands[0] == lhs.operands[0];
+		case Gate::R_X:
+		case Gate::R_Y:
+		case Gate::R_Z:
+			return rhs.gate == lhs.gate && rhs.operands[0] == lhs.operands[0] && rhs.immediate == -lhs.immediate;
+		default:
+			return false;
+	}
+}
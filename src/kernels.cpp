@@ -0,0 +1,526 @@
+#include <algorithm>
+
+#include "constants.h"
+#include "kernels.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define KERNELS_X86_64 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define TARGET_AVX512 __attribute__((target("avx512f,avx2,fma")))
+#else
+#define TARGET_AVX2
+#define TARGET_AVX512
+#endif
+
+template <typename Real>
+static void apply_matrix_scalar(std::complex<Real> *state, uint64_t bit, Gate_Matrix<1> const &gate,
+                                uint64_t begin, uint64_t end)
+{
+	std::complex<Real> const elements[4] = {
+		std::complex<Real>(gate[0]), std::complex<Real>(gate[1]), std::complex<Real>(gate[2]), std::complex<Real>(gate[3])
+	};
+	uint64_t const stride = (uint64_t)1 << bit;
+	for (uint64_t index = begin; index < end; ++index) {
+		uint64_t const zero_index = insert_zero_bit(index, bit);
+		std::complex<Real> const zero_amplitude = state[zero_index];
+		std::complex<Real> const one_amplitude = state[zero_index + stride];
+		state[zero_index] = (elements[0] * zero_amplitude) + (elements[1] * one_amplitude);
+		state[zero_index + stride] = (elements[2] * zero_amplitude) + (elements[3] * one_amplitude);
+	}
+}
+
+template <typename Real>
+static void apply_diagonal_scalar(std::complex<Real> *state, uint64_t bit, std::complex<double> zero_phase,
+                                  std::complex<double> one_phase, uint64_t begin, uint64_t end)
+{
+	std::complex<Real> const zero_element(zero_phase);
+	std::complex<Real> const one_element(one_phase);
+	uint64_t const stride = (uint64_t)1 << bit;
+	for (uint64_t index = begin; index < end; ++index) {
+		uint64_t const zero_index = insert_zero_bit(index, bit);
+		state[zero_index] *= zero_element;
+		state[zero_index + stride] *= one_element;
+	}
+}
+
+template <typename Real, Fixed_Gate fixed_gate>
+static void apply_fixed_scalar(std::complex<Real> *state, uint64_t bit, uint64_t begin, uint64_t end)
+{
+	Real const scale = (Real)CONST_SQRT1_2;
+	uint64_t const stride = (uint64_t)1 << bit;
+	for (uint64_t index = begin; index < end; ++index) {
+		uint64_t const zero_index = insert_zero_bit(index, bit);
+		std::complex<Real> const zero_amplitude = state[zero_index];
+		std::complex<Real> const one_amplitude = state[zero_index + stride];
+		if constexpr (fixed_gate == Fixed_Gate::PAULI_X) {
+			state[zero_index] = one_amplitude;
+			state[zero_index + stride] = zero_amplitude;
+		} else if constexpr (fixed_gate == Fixed_Gate::PAULI_Y) {
+			state[zero_index] = { one_amplitude.imag(), -one_amplitude.real() };
+			state[zero_index + stride] = { -zero_amplitude.imag(), zero_amplitude.real() };
+		} else if constexpr (fixed_gate == Fixed_Gate::PAULI_Z) {
+			state[zero_index + stride] = -one_amplitude;
+		} else if constexpr (fixed_gate == Fixed_Gate::HADAMARD) {
+			state[zero_index] = (zero_amplitude + one_amplitude) * scale;
+			state[zero_index + stride] = (zero_amplitude - one_amplitude) * scale;
+		}
+	}
+}
+
+#ifdef KERNELS_X86_64
+
+// Amplitudes are stored as interleaved (real, imaginary) pairs, so a complex multiply by a broadcast scalar g is
+// g.real * x -/+ g.imag * swap(x), where swap exchanges the real and imaginary lanes. The operations the kernels need
+// are wrapped per precision, so the same kernel serves double amplitudes and twice as many float amplitudes per
+// register.
+
+template <typename Real>
+struct Avx2;
+
+template <>
+struct Avx2<double>
+{
+	using Register = __m256d;
+	static constexpr uint64_t num_amplitudes = 2;
+
+	TARGET_AVX2 static Register load(double const *pointer) { return _mm256_loadu_pd(pointer); }
+	TARGET_AVX2 static void store(double *pointer, Register value) { _mm256_storeu_pd(pointer, value); }
+	TARGET_AVX2 static Register broadcast(double value) { return _mm256_set1_pd(value); }
+	TARGET_AVX2 static Register add(Register lhs, Register rhs) { return _mm256_add_pd(lhs, rhs); }
+	TARGET_AVX2 static Register sub(Register lhs, Register rhs) { return _mm256_sub_pd(lhs, rhs); }
+	TARGET_AVX2 static Register mul(Register lhs, Register rhs) { return _mm256_mul_pd(lhs, rhs); }
+	TARGET_AVX2 static Register fmadd(Register a, Register b, Register c) { return _mm256_fmadd_pd(a, b, c); }
+	TARGET_AVX2 static Register fmaddsub(Register a, Register b, Register c) { return _mm256_fmaddsub_pd(a, b, c); }
+	TARGET_AVX2 static Register swap_parts(Register value) { return _mm256_permute_pd(value, 0b0101); }
+	TARGET_AVX2 static Register negate(Register value) { return _mm256_xor_pd(value, _mm256_set1_pd(-0.0)); }
+	TARGET_AVX2 static Register negate_real(Register value) { return _mm256_xor_pd(value, _mm256_set_pd(0.0, -0.0, 0.0, -0.0)); }
+	TARGET_AVX2 static Register negate_imag(Register value) { return _mm256_xor_pd(value, _mm256_set_pd(-0.0, 0.0, -0.0, 0.0)); }
+};
+
+template <>
+struct Avx2<float>
+{
+	using Register = __m256;
+	static constexpr uint64_t num_amplitudes = 4;
+
+	TARGET_AVX2 static Register load(float const *pointer) { return _mm256_loadu_ps(pointer); }
+	TARGET_AVX2 static void store(float *pointer, Register value) { _mm256_storeu_ps(pointer, value); }
+	TARGET_AVX2 static Register broadcast(float value) { return _mm256_set1_ps(value); }
+	TARGET_AVX2 static Register add(Register lhs, Register rhs) { return _mm256_add_ps(lhs, rhs); }
+	TARGET_AVX2 static Register sub(Register lhs, Register rhs) { return _mm256_sub_ps(lhs, rhs); }
+	TARGET_AVX2 static Register mul(Register lhs, Register rhs) { return _mm256_mul_ps(lhs, rhs); }
+	TARGET_AVX2 static Register fmadd(Register a, Register b, Register c) { return _mm256_fmadd_ps(a, b, c); }
+	TARGET_AVX2 static Register fmaddsub(Register a, Register b, Register c) { return _mm256_fmaddsub_ps(a, b, c); }
+	TARGET_AVX2 static Register swap_parts(Register value) { return _mm256_permute_ps(value, 0b10110001); }
+	TARGET_AVX2 static Register negate(Register value) { return _mm256_xor_ps(value, _mm256_set1_ps(-0.0f)); }
+	TARGET_AVX2 static Register negate_real(Register value)
+	{
+		return _mm256_xor_ps(value, _mm256_set_ps(0.0f, -0.0f, 0.0f, -0.0f, 0.0f, -0.0f, 0.0f, -0.0f));
+	}
+	TARGET_AVX2 static Register negate_imag(Register value)
+	{
+		return _mm256_xor_ps(value, _mm256_set_ps(-0.0f, 0.0f, -0.0f, 0.0f, -0.0f, 0.0f, -0.0f, 0.0f));
+	}
+};
+
+template <typename Real>
+TARGET_AVX2
+static typename Avx2<Real>::Register complex_mul_avx2(typename Avx2<Real>::Register real, typename Avx2<Real>::Register imag,
+                                                      typename Avx2<Real>::Register x)
+{
+	using Vector = Avx2<Real>;
+	return Vector::fmaddsub(real, x, Vector::mul(imag, Vector::swap_parts(x)));
+}
+
+template <typename Real>
+TARGET_AVX2
+static typename Avx2<Real>::Register complex_mul_add_avx2(typename Avx2<Real>::Register real_a, typename Avx2<Real>::Register imag_a,
+                                                          typename Avx2<Real>::Register a, typename Avx2<Real>::Register real_b,
+                                                          typename Avx2<Real>::Register imag_b, typename Avx2<Real>::Register b)
+{
+	using Vector = Avx2<Real>;
+	typename Vector::Register const imag_terms = Vector::fmadd(imag_b, Vector::swap_parts(b), Vector::mul(imag_a, Vector::swap_parts(a)));
+	return Vector::fmadd(real_b, b, Vector::fmaddsub(real_a, a, imag_terms));
+}
+
+template <typename Real>
+TARGET_AVX2
+static void apply_matrix_avx2(std::complex<Real> *state, uint64_t bit, Gate_Matrix<1> const &gate,
+                              uint64_t begin, uint64_t end)
+{
+	using Vector = Avx2<Real>;
+	uint64_t const width = Vector::num_amplitudes;
+
+	// runs of adjacent pairs must fill a register, so narrower strides fall back to the scalar kernel
+	if (((uint64_t)1 << bit) < width) {
+		apply_matrix_scalar(state, bit, gate, begin, end);
+		return;
+	}
+
+	uint64_t const stride = (uint64_t)1 << bit;
+	uint64_t const vector_begin = std::min((begin + width - 1) & ~(width - 1), end);
+	uint64_t const vector_end = std::max(end & ~(width - 1), vector_begin);
+	apply_matrix_scalar(state, bit, gate, begin, vector_begin);
+
+	typename Vector::Register real[4], imag[4];
+	for (size_t element = 0; element < 4; ++element) {
+		real[element] = Vector::broadcast((Real)gate[element].real());
+		imag[element] = Vector::broadcast((Real)gate[element].imag());
+	}
+
+	Real *amplitudes = reinterpret_cast<Real *>(state);
+	for (uint64_t index = vector_begin; index < vector_end; index += width) {
+		uint64_t const zero_index = insert_zero_bit(index, bit);
+		Real *zero_pointer = amplitudes + (zero_index * 2);
+		Real *one_pointer = amplitudes + ((zero_index + stride) * 2);
+		typename Vector::Register const zero_amplitudes = Vector::load(zero_pointer);
+		typename Vector::Register const one_amplitudes = Vector::load(one_pointer);
+		Vector::store(zero_pointer, complex_mul_add_avx2<Real>(real[0], imag[0], zero_amplitudes, real[1], imag[1], one_amplitudes));
+		Vector::store(one_pointer, complex_mul_add_avx2<Real>(real[2], imag[2], zero_amplitudes, real[3], imag[3], one_amplitudes));
+	}
+
+	apply_matrix_scalar(state, bit, gate, vector_end, end);
+}
+
+template <typename Real>
+TARGET_AVX2
+static void apply_diagonal_avx2(std::complex<Real> *state, uint64_t bit, std::complex<double> zero_phase,
+                                std::complex<double> one_phase, uint64_t begin, uint64_t end)
+{
+	using Vector = Avx2<Real>;
+	uint64_t const width = Vector::num_amplitudes;
+
+	if (((uint64_t)1 << bit) < width) {
+		apply_diagonal_scalar(state, bit, zero_phase, one_phase, begin, end);
+		return;
+	}
+
+	uint64_t const stride = (uint64_t)1 << bit;
+	uint64_t const vector_begin = std::min((begin + width - 1) & ~(width - 1), end);
+	uint64_t const vector_end = std::max(end & ~(width - 1), vector_begin);
+	apply_diagonal_scalar(state, bit, zero_phase, one_phase, begin, vector_begin);
+
+	typename Vector::Register const zero_real = Vector::broadcast((Real)zero_phase.real());
+	typename Vector::Register const zero_imag = Vector::broadcast((Real)zero_phase.imag());
+	typename Vector::Register const one_real = Vector::broadcast((Real)one_phase.real());
+	typename Vector::Register const one_imag = Vector::broadcast((Real)one_phase.imag());
+
+	Real *amplitudes = reinterpret_cast<Real *>(state);
+	for (uint64_t index = vector_begin; index < vector_end; index += width) {
+		uint64_t const zero_index = insert_zero_bit(index, bit);
+		Real *zero_pointer = amplitudes + (zero_index * 2);
+		Real *one_pointer = amplitudes + ((zero_index + stride) * 2);
+		Vector::store(zero_pointer, complex_mul_avx2<Real>(zero_real, zero_imag, Vector::load(zero_pointer)));
+		Vector::store(one_pointer, complex_mul_avx2<Real>(one_real, one_imag, Vector::load(one_pointer)));
+	}
+
+	apply_diagonal_scalar(state, bit, zero_phase, one_phase, vector_end, end);
+}
+
+template <typename Real, Fixed_Gate fixed_gate>
+TARGET_AVX2
+static void apply_fixed_avx2(std::complex<Real> *state, uint64_t bit, uint64_t begin, uint64_t end)
+{
+	using Vector = Avx2<Real>;
+	uint64_t const width = Vector::num_amplitudes;
+
+	if (((uint64_t)1 << bit) < width) {
+		apply_fixed_scalar<Real, fixed_gate>(state, bit, begin, end);
+		return;
+	}
+
+	uint64_t const stride = (uint64_t)1 << bit;
+	uint64_t const vector_begin = std::min((begin + width - 1) & ~(width - 1), end);
+	uint64_t const vector_end = std::max(end & ~(width - 1), vector_begin);
+	apply_fixed_scalar<Real, fixed_gate>(state, bit, begin, vector_begin);
+
+	typename Vector::Register const scale = Vector::broadcast((Real)CONST_SQRT1_2);
+
+	Real *amplitudes = reinterpret_cast<Real *>(state);
+	for (uint64_t index = vector_begin; index < vector_end; index += width) {
+		uint64_t const zero_index = insert_zero_bit(index, bit);
+		Real *zero_pointer = amplitudes + (zero_index * 2);
+		Real *one_pointer = amplitudes + ((zero_index + stride) * 2);
+		typename Vector::Register const zero_amplitudes = Vector::load(zero_pointer);
+		typename Vector::Register const one_amplitudes = Vector::load(one_pointer);
+		if constexpr (fixed_gate == Fixed_Gate::PAULI_X) {
+			Vector::store(zero_pointer, one_amplitudes);
+			Vector::store(one_pointer, zero_amplitudes);
+		} else if constexpr (fixed_gate == Fixed_Gate::PAULI_Y) {
+			Vector::store(zero_pointer, Vector::negate_imag(Vector::swap_parts(one_amplitudes)));
+			Vector::store(one_pointer, Vector::negate_real(Vector::swap_parts(zero_amplitudes)));
+		} else if constexpr (fixed_gate == Fixed_Gate::PAULI_Z) {
+			Vector::store(one_pointer, Vector::negate(one_amplitudes));
+		} else if constexpr (fixed_gate == Fixed_Gate::HADAMARD) {
+			Vector::store(zero_pointer, Vector::mul(Vector::add(zero_amplitudes, one_amplitudes), scale));
+			Vector::store(one_pointer, Vector::mul(Vector::sub(zero_amplitudes, one_amplitudes), scale));
+		}
+	}
+
+	apply_fixed_scalar<Real, fixed_gate>(state, bit, vector_end, end);
+}
+
+// AVX-512F has no floating point xor, so lanes are negated with a masked subtract from zero.
+
+template <typename Real>
+struct Avx512;
+
+template <>
+struct Avx512<double>
+{
+	using Register = __m512d;
+	static constexpr uint64_t num_amplitudes = 4;
+
+	TARGET_AVX512 static Register load(double const *pointer) { return _mm512_loadu_pd(pointer); }
+	TARGET_AVX512 static void store(double *pointer, Register value) { _mm512_storeu_pd(pointer, value); }
+	TARGET_AVX512 static Register broadcast(double value) { return _mm512_set1_pd(value); }
+	TARGET_AVX512 static Register add(Register lhs, Register rhs) { return _mm512_add_pd(lhs, rhs); }
+	TARGET_AVX512 static Register sub(Register lhs, Register rhs) { return _mm512_sub_pd(lhs, rhs); }
+	TARGET_AVX512 static Register mul(Register lhs, Register rhs) { return _mm512_mul_pd(lhs, rhs); }
+	TARGET_AVX512 static Register fmadd(Register a, Register b, Register c) { return _mm512_fmadd_pd(a, b, c); }
+	TARGET_AVX512 static Register fmaddsub(Register a, Register b, Register c) { return _mm512_fmaddsub_pd(a, b, c); }
+	TARGET_AVX512 static Register swap_parts(Register value) { return _mm512_permute_pd(value, 0b01010101); }
+	TARGET_AVX512 static Register negate(Register value) { return _mm512_sub_pd(_mm512_setzero_pd(), value); }
+	TARGET_AVX512 static Register negate_real(Register value) { return _mm512_mask_sub_pd(value, 0x55, _mm512_setzero_pd(), value); }
+	TARGET_AVX512 static Register negate_imag(Register value) { return _mm512_mask_sub_pd(value, 0xaa, _mm512_setzero_pd(), value); }
+};
+
+template <>
+struct Avx512<float>
+{
+	using Register = __m512;
+	static constexpr uint64_t num_amplitudes = 8;
+
+	TARGET_AVX512 static Register load(float const *pointer) { return _mm512_loadu_ps(pointer); }
+	TARGET_AVX512 static void store(float *pointer, Register value) { _mm512_storeu_ps(pointer, value); }
+	TARGET_AVX512 static Register broadcast(float value) { return _mm512_set1_ps(value); }
+	TARGET_AVX512 static Register add(Register lhs, Register rhs) { return _mm512_add_ps(lhs, rhs); }
+	TARGET_AVX512 static Register sub(Register lhs, Register rhs) { return _mm512_sub_ps(lhs, rhs); }
+	TARGET_AVX512 static Register mul(Register lhs, Register rhs) { return _mm512_mul_ps(lhs, rhs); }
+	TARGET_AVX512 static Register fmadd(Register a, Register b, Register c) { return _mm512_fmadd_ps(a, b, c); }
+	TARGET_AVX512 static Register fmaddsub(Register a, Register b, Register c) { return _mm512_fmaddsub_ps(a, b, c); }
+	TARGET_AVX512 static Register swap_parts(Register value) { return _mm512_permute_ps(value, 0b10110001); }
+	TARGET_AVX512 static Register negate(Register value) { return _mm512_sub_ps(_mm512_setzero_ps(), value); }
+	TARGET_AVX512 static Register negate_real(Register value) { return _mm512_mask_sub_ps(value, 0x5555, _mm512_setzero_ps(), value); }
+	TARGET_AVX512 static Register negate_imag(Register value) { return _mm512_mask_sub_ps(value, 0xaaaa, _mm512_setzero_ps(), value); }
+};
+
+template <typename Real>
+TARGET_AVX512
+static typename Avx512<Real>::Register complex_mul_avx512(typename Avx512<Real>::Register real, typename Avx512<Real>::Register imag,
+                                                          typename Avx512<Real>::Register x)
+{
+	using Vector = Avx512<Real>;
+	return Vector::fmaddsub(real, x, Vector::mul(imag, Vector::swap_parts(x)));
+}
+
+template <typename Real>
+TARGET_AVX512
+static typename Avx512<Real>::Register complex_mul_add_avx512(typename Avx512<Real>::Register real_a, typename Avx512<Real>::Register imag_a,
+                                                              typename Avx512<Real>::Register a, typename Avx512<Real>::Register real_b,
+                                                              typename Avx512<Real>::Register imag_b, typename Avx512<Real>::Register b)
+{
+	using Vector = Avx512<Real>;
+	typename Vector::Register const imag_terms = Vector::fmadd(imag_b, Vector::swap_parts(b), Vector::mul(imag_a, Vector::swap_parts(a)));
+	return Vector::fmadd(real_b, b, Vector::fmaddsub(real_a, a, imag_terms));
+}
+
+template <typename Real>
+TARGET_AVX512
+static void apply_matrix_avx512(std::complex<Real> *state, uint64_t bit, Gate_Matrix<1> const &gate,
+                                uint64_t begin, uint64_t end)
+{
+	using Vector = Avx512<Real>;
+	uint64_t const width = Vector::num_amplitudes;
+
+	// narrower strides fall back to the AVX2 kernel, which handles half as many amplitudes per register
+	if (((uint64_t)1 << bit) < width) {
+		apply_matrix_avx2(state, bit, gate, begin, end);
+		return;
+	}
+
+	uint64_t const stride = (uint64_t)1 << bit;
+	uint64_t const vector_begin = std::min((begin + width - 1) & ~(width - 1), end);
+	uint64_t const vector_end = std::max(end & ~(width - 1), vector_begin);
+	apply_matrix_scalar(state, bit, gate, begin, vector_begin);
+
+	typename Vector::Register real[4], imag[4];
+	for (size_t element = 0; element < 4; ++element) {
+		real[element] = Vector::broadcast((Real)gate[element].real());
+		imag[element] = Vector::broadcast((Real)gate[element].imag());
+	}
+
+	Real *amplitudes = reinterpret_cast<Real *>(state);
+	for (uint64_t index = vector_begin; index < vector_end; index += width) {
+		uint64_t const zero_index = insert_zero_bit(index, bit);
+		Real *zero_pointer = amplitudes + (zero_index * 2);
+		Real *one_pointer = amplitudes + ((zero_index + stride) * 2);
+		typename Vector::Register const zero_amplitudes = Vector::load(zero_pointer);
+		typename Vector::Register const one_amplitudes = Vector::load(one_pointer);
+		Vector::store(zero_pointer, complex_mul_add_avx512<Real>(real[0], imag[0], zero_amplitudes, real[1], imag[1], one_amplitudes));
+		Vector::store(one_pointer, complex_mul_add_avx512<Real>(real[2], imag[2], zero_amplitudes, real[3], imag[3], one_amplitudes));
+	}
+
+	apply_matrix_scalar(state, bit, gate, vector_end, end);
+}
+
+template <typename Real>
+TARGET_AVX512
+static void apply_diagonal_avx512(std::complex<Real> *state, uint64_t bit, std::complex<double> zero_phase,
+                                  std::complex<double> one_phase, uint64_t begin, uint64_t end)
+{
+	using Vector = Avx512<Real>;
+	uint64_t const width = Vector::num_amplitudes;
+
+	if (((uint64_t)1 << bit) < width) {
+		apply_diagonal_avx2(state, bit, zero_phase, one_phase, begin, end);
+		return;
+	}
+
+	uint64_t const stride = (uint64_t)1 << bit;
+	uint64_t const vector_begin = std::min((begin + width - 1) & ~(width - 1), end);
+	uint64_t const vector_end = std::max(end & ~(width - 1), vector_begin);
+	apply_diagonal_scalar(state, bit, zero_phase, one_phase, begin, vector_begin);
+
+	typename Vector::Register const zero_real = Vector::broadcast((Real)zero_phase.real());
+	typename Vector::Register const zero_imag = Vector::broadcast((Real)zero_phase.imag());
+	typename Vector::Register const one_real = Vector::broadcast((Real)one_phase.real());
+	typename Vector::Register const one_imag = Vector::broadcast((Real)one_phase.imag());
+
+	Real *amplitudes = reinterpret_cast<Real *>(state);
+	for (uint64_t index = vector_begin; index < vector_end; index += width) {
+		uint64_t const zero_index = insert_zero_bit(index, bit);
+		Real *zero_pointer = amplitudes + (zero_index * 2);
+		Real *one_pointer = amplitudes + ((zero_index + stride) * 2);
+		Vector::store(zero_pointer, complex_mul_avx512<Real>(zero_real, zero_imag, Vector::load(zero_pointer)));
+		Vector::store(one_pointer, complex_mul_avx512<Real>(one_real, one_imag, Vector::load(one_pointer)));
+	}
+
+	apply_diagonal_scalar(state, bit, zero_phase, one_phase, vector_end, end);
+}
+
+template <typename Real, Fixed_Gate fixed_gate>
+TARGET_AVX512
+static void apply_fixed_avx512(std::complex<Real> *state, uint64_t bit, uint64_t begin, uint64_t end)
+{
+	using Vector = Avx512<Real>;
+	uint64_t const width = Vector::num_amplitudes;
+
+	if (((uint64_t)1 << bit) < width) {
+		apply_fixed_avx2<Real, fixed_gate>(state, bit, begin, end);
+		return;
+	}
+
+	uint64_t const stride = (uint64_t)1 << bit;
+	uint64_t const vector_begin = std::min((begin + width - 1) & ~(width - 1), end);
+	uint64_t const vector_end = std::max(end & ~(width - 1), vector_begin);
+	apply_fixed_scalar<Real, fixed_gate>(state, bit, begin, vector_begin);
+
+	typename Vector::Register const scale = Vector::broadcast((Real)CONST_SQRT1_2);
+
+	Real *amplitudes = reinterpret_cast<Real *>(state);
+	for (uint64_t index = vector_begin; index < vector_end; index += width) {
+		uint64_t const zero_index = insert_zero_bit(index, bit);
+		Real *zero_pointer = amplitudes + (zero_index * 2);
+		Real *one_pointer = amplitudes + ((zero_index + stride) * 2);
+		typename Vector::Register const zero_amplitudes = Vector::load(zero_pointer);
+		typename Vector::Register const one_amplitudes = Vector::load(one_pointer);
+		if constexpr (fixed_gate == Fixed_Gate::PAULI_X) {
+			Vector::store(zero_pointer, one_amplitudes);
+			Vector::store(one_pointer, zero_amplitudes);
+		} else if constexpr (fixed_gate == Fixed_Gate::PAULI_Y) {
+			Vector::store(zero_pointer, Vector::negate_imag(Vector::swap_parts(one_amplitudes)));
+			Vector::store(one_pointer, Vector::negate_real(Vector::swap_parts(zero_amplitudes)));
+		} else if constexpr (fixed_gate == Fixed_Gate::PAULI_Z) {
+			Vector::store(one_pointer, Vector::negate(one_amplitudes));
+		} else if constexpr (fixed_gate == Fixed_Gate::HADAMARD) {
+			Vector::store(zero_pointer, Vector::mul(Vector::add(zero_amplitudes, one_amplitudes), scale));
+			Vector::store(one_pointer, Vector::mul(Vector::sub(zero_amplitudes, one_amplitudes), scale));
+		}
+	}
+
+	apply_fixed_scalar<Real, fixed_gate>(state, bit, vector_end, end);
+}
+
+#endif
+
+template <typename Real>
+static Gate_Kernels<Real> const scalar_kernels = {
+	Instruction_Set::SCALAR, apply_matrix_scalar<Real>, apply_diagonal_scalar<Real>,
+	{
+		apply_fixed_scalar<Real, Fixed_Gate::PAULI_X>, apply_fixed_scalar<Real, Fixed_Gate::PAULI_Y>,
+		apply_fixed_scalar<Real, Fixed_Gate::PAULI_Z>, apply_fixed_scalar<Real, Fixed_Gate::HADAMARD>
+	}
+};
+#ifdef KERNELS_X86_64
+template <typename Real>
+static Gate_Kernels<Real> const avx2_kernels = {
+	Instruction_Set::AVX2, apply_matrix_avx2<Real>, apply_diagonal_avx2<Real>,
+	{
+		apply_fixed_avx2<Real, Fixed_Gate::PAULI_X>, apply_fixed_avx2<Real, Fixed_Gate::PAULI_Y>,
+		apply_fixed_avx2<Real, Fixed_Gate::PAULI_Z>, apply_fixed_avx2<Real, Fixed_Gate::HADAMARD>
+	}
+};
+template <typename Real>
+static Gate_Kernels<Real> const avx512_kernels = {
+	Instruction_Set::AVX512, apply_matrix_avx512<Real>, apply_diagonal_avx512<Real>,
+	{
+		apply_fixed_avx512<Real, Fixed_Gate::PAULI_X>, apply_fixed_avx512<Real, Fixed_Gate::PAULI_Y>,
+		apply_fixed_avx512<Real, Fixed_Gate::PAULI_Z>, apply_fixed_avx512<Real, Fixed_Gate::HADAMARD>
+	}
+};
+#endif
+static_assert(NUM_FIXED_GATES == 4, "every kernel table needs an entry for each fixed gate");
+
+Instruction_Set detect_instruction_set()
+{
+#if defined(KERNELS_X86_64) && (defined(__GNUC__) || defined(__clang__))
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+		return Instruction_Set::AVX512;
+	}
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+		return Instruction_Set::AVX2;
+	}
+#elif defined(KERNELS_X86_64) && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+	bool const has_fma = (info[2] & (1 << 12)) != 0;
+	bool const has_os_xsave = (info[2] & (1 << 27)) != 0;
+	if (has_os_xsave) {
+		unsigned long long const enabled_state = _xgetbv(0);
+		bool const has_ymm_state = (enabled_state & 0x06) == 0x06;
+		bool const has_zmm_state = (enabled_state & 0xe6) == 0xe6;
+		__cpuidex(info, 7, 0);
+		if (has_zmm_state && has_fma && (info[1] & (1 << 5)) && (info[1] & (1 << 16))) {
+			return Instruction_Set::AVX512;
+		}
+		if (has_ymm_state && has_fma && (info[1] & (1 << 5))) {
+			return Instruction_Set::AVX2;
+		}
+	}
+#endif
+	return Instruction_Set::SCALAR;
+}
+
+template <typename Real>
+Gate_Kernels<Real> const &get_gate_kernels(Instruction_Set instruction_set)
+{
+	switch (instruction_set) {
+#ifdef KERNELS_X86_64
+		case Instruction_Set::AVX2: return avx2_kernels<Real>;
+		case Instruction_Set::AVX512: return avx512_kernels<Real>;
+#endif
+		default: return scalar_kernels<Real>;
+	}
+}
+
+template Gate_Kernels<double> const &get_gate_kernels<double>(Instruction_Set instruction_set);
+template Gate_Kernels<float> const &get_gate_kernels<float>(Instruction_Set instruction_set);
@@ -1,18 +1,57 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <optional>
+#include <thread>
+
+#include "format.h"
 #include "platform.h"
 #include "qsim.h"
 #include "qsim_gui.h"
 
 int main(int argc, char const **argv)
 {
+	size_t num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+	std::optional<uint64_t> seed;
+	Precision precision = Precision::DOUBLE;
+	Representation representation = Representation::FULL;
+	std::optional<std::filesystem::path> source_file;
+	for (int arg_index = 1; arg_index < argc; ++arg_index) {
+		bool const has_value = (arg_index + 1) < argc;
+		if (std::strcmp(argv[arg_index], "--threads") == 0 && has_value && parse_number(argv[arg_index + 1], (size_t)1, MAX_THREADS)) {
+			num_threads = *parse_number(argv[++arg_index], (size_t)1, MAX_THREADS);
+		} else if (std::strcmp(argv[arg_index], "--seed") == 0 && has_value && parse_number(argv[arg_index + 1], (uint64_t)0, UINT64_MAX)) {
+			seed = *parse_number(argv[++arg_index], (uint64_t)0, UINT64_MAX);
+		} else if (std::strcmp(argv[arg_index], "--precision") == 0 && has_value &&
+		           (std::strcmp(argv[arg_index + 1], "double") == 0 || std::strcmp(argv[arg_index + 1], "single") == 0)) {
+			precision = std::strcmp(argv[++arg_index], "single") == 0 ? Precision::SINGLE : Precision::DOUBLE;
+		} else if (std::strcmp(argv[arg_index], "--representation") == 0 && has_value && find_representation(argv[arg_index + 1])) {
+			representation = *find_representation(argv[++arg_index]);
+		} else if (argv[arg_index][0] != '-' && !source_file) {
+			source_file = std::filesystem::path(argv[arg_index]);
+		} else {
+			std::cerr << "usage: fqcsim [source.qasm] [--threads N] [--seed N] [--precision double|single] [--representation full|factored|stabilizer]\n";
+			return 1;
+		}
+	}
+
 	if (!platform_create_window()) {
 		return 1;
 	}
 
-	QSim sim;
+	QSim sim(num_threads);
+	if (seed) {
+		sim.set_seed(*seed);
+	}
+	sim.set_precision(precision);
+	sim.set_representation(representation);
+	// checkpoints make stepping back and rerunning an edited program cheap
+	sim.set_max_checkpoints(8);
 	QSim_GUI gui(&sim);
 
-	if (argc > 1) {
-		gui.handle_file_drop(std::filesystem::path(argv[1]));
+	if (source_file) {
+		gui.handle_file_drop(*source_file);
 	}
 
 	while (!platform_update()) {
@@ -0,0 +1,168 @@
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <thread>
+
+#include "distributed.h"
+#include "format.h"
+#include "qasm.h"
+#include "qsim.h"
+
+// beyond this the processes couldn't each get a share of the work
+static constexpr size_t max_processes = (size_t)1 << (MAX_QBITS - MIN_LOCAL_QBITS);
+
+static void print_usage()
+{
+	std::cerr << "usage: fqcsim-cli <source.qasm> [--shots N] [--seed N] [--threads N] [--precision double|single] [--representation full|factored|stabilizer] [--state-file state.bin] [--processes N] [--output results.csv]\n";
+}
+
+// Calls write_csv(stream) on the results file, or on stdout without one.
+template <typename Write_Csv>
+static int write_results(std::optional<std::filesystem::path> const &results_file, Write_Csv const &write_csv)
+{
+	if (results_file) {
+		std::ofstream results_stream { *results_file };
+		if (!results_stream.is_open()) {
+			std::cerr << "Failed to save file " << results_file->string() << '\n';
+			return 1;
+		}
+		write_csv(results_stream);
+	} else {
+		write_csv(std::cout);
+	}
+	return 0;
+}
+
+// Splits the state across processes on this machine, with rank 0 reporting as a single process would.
+static int run_distributed(Quantum_Program const &program, size_t num_processes, int num_runs, std::optional<uint64_t> seed,
+                           Precision precision, std::optional<std::filesystem::path> const &results_file)
+{
+	if ((num_processes & (num_processes - 1)) != 0) {
+		std::cerr << "The number of processes must be a power of two\n";
+		return 1;
+	}
+	Process_Group group;
+	if (!group.spawn(num_processes)) {
+		std::cerr << "Failed to start " << num_processes << " processes\n";
+		return 1;
+	}
+
+	Distributed_QSim sim(group);
+	if (seed) {
+		sim.set_seed(*seed);
+	}
+	sim.set_precision(precision);
+	sim.set_program(&program);
+	auto const start = std::chrono::steady_clock::now();
+	bool const is_run = sim.run(num_runs);
+	auto const finish = std::chrono::steady_clock::now();
+	if (!group.finish(is_run)) {
+		std::cerr << "Failed to run " << program.get_num_qbits() << " qbits across " << num_processes << " processes\n";
+		return 1;
+	}
+	auto const elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(finish - start).count();
+	std::cerr << "Run complete after " << elapsed << "ms\n";
+	return write_results(results_file, [&](std::ostream &stream) { write_results_csv(stream, sim.get_results(), sim.get_num_qbits()); });
+}
+
+int main(int argc, char const **argv)
+{
+	std::optional<size_t> num_threads;
+	int num_runs = 100;
+	std::optional<uint64_t> seed;
+	Precision precision = Precision::DOUBLE;
+	Representation representation = Representation::FULL;
+	std::optional<std::filesystem::path> source_file;
+	std::optional<std::filesystem::path> results_file;
+	std::optional<std::filesystem::path> state_file;
+	size_t num_processes = 1;
+	for (int arg_index = 1; arg_index < argc; ++arg_index) {
+		bool const has_value = (arg_index + 1) < argc;
+		if (std::strcmp(argv[arg_index], "--shots") == 0 && has_value && parse_number(argv[arg_index + 1], 1, INT_MAX)) {
+			num_runs = *parse_number(argv[++arg_index], 1, INT_MAX);
+		} else if (std::strcmp(argv[arg_index], "--seed") == 0 && has_value && parse_number(argv[arg_index + 1], (uint64_t)0, UINT64_MAX)) {
+			seed = *parse_number(argv[++arg_index], (uint64_t)0, UINT64_MAX);
+		} else if (std::strcmp(argv[arg_index], "--threads") == 0 && has_value && parse_number(argv[arg_index + 1], (size_t)1, MAX_THREADS)) {
+			num_threads = *parse_number(argv[++arg_index], (size_t)1, MAX_THREADS);
+		} else if (std::strcmp(argv[arg_index], "--precision") == 0 && has_value &&
+		           (std::strcmp(argv[arg_index + 1], "double") == 0 || std::strcmp(argv[arg_index + 1], "single") == 0)) {
+			precision = std::strcmp(argv[++arg_index], "single") == 0 ? Precision::SINGLE : Precision::DOUBLE;
+		} else if (std::strcmp(argv[arg_index], "--representation") == 0 && has_value && find_representation(argv[arg_index + 1])) {
+			representation = *find_representation(argv[++arg_index]);
+		} else if (std::strcmp(argv[arg_index], "--state-file") == 0 && has_value) {
+			state_file = std::filesystem::path(argv[++arg_index]);
+		} else if (std::strcmp(argv[arg_index], "--processes") == 0 && has_value && parse_number(argv[arg_index + 1], (size_t)1, max_processes)) {
+			num_processes = *parse_number(argv[++arg_index], (size_t)1, max_processes);
+		} else if (std::strcmp(argv[arg_index], "--output") == 0 && has_value) {
+			results_file = std::filesystem::path(argv[++arg_index]);
+		} else if (argv[arg_index][0] != '-' && !source_file) {
+			source_file = std::filesystem::path(argv[arg_index]);
+		} else {
+			print_usage();
+			return 1;
+		}
+	}
+
+	if (!source_file) {
+		print_usage();
+		return 1;
+	}
+
+	std::ifstream source_stream { *source_file };
+	if (!source_stream.is_open()) {
+		std::cerr << "Failed to load file " << source_file->string() << '\n';
+		return 1;
+	}
+	std::string source_code { std::istreambuf_iterator<char>(source_stream),
+	                          std::istreambuf_iterator<char>() };
+
+	Quantum_Program program(source_code);
+	if (!program.is_valid()) {
+		std::cerr << "Failed to compile " << source_file->string() << ".\nError: " << program.get_build_error() << '\n';
+		return 1;
+	}
+
+	if (num_processes > 1) {
+		// the processes each keep their share of a full state vector in memory and apply it on one thread
+		if (representation != Representation::FULL || state_file || num_threads) {
+			std::cerr << "--processes can't be combined with --representation, --state-file or --threads\n";
+			return 1;
+		}
+		return run_distributed(program, num_processes, num_runs, seed, precision, results_file);
+	}
+
+	QSim sim(num_threads.value_or(std::max(std::thread::hardware_concurrency(), 1u)));
+	if (seed) {
+		sim.set_seed(*seed);
+	}
+	sim.set_precision(precision);
+	sim.set_representation(representation);
+	sim.set_program(&program);
+	if (state_file) {
+		if (!sim.set_state_file(*state_file)) {
+			std::cerr << "Can't use " << state_file->string() << " as a state file, keeping the state in memory\n";
+		} else if (sim.get_next_gate_index() > 0) {
+			std::cerr << "Resuming from the state after " << sim.get_next_gate_index() << " operations in " << state_file->string() << '\n';
+		}
+	}
+
+	auto const start = std::chrono::steady_clock::now();
+	sim.run(num_runs);
+	auto const finish = std::chrono::steady_clock::now();
+	auto const elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(finish - start).count();
+	std::cerr << "Run complete after " << elapsed << "ms\n";
+
+	// results on a tableau can be too wide for a state index
+	return write_results(results_file, [&](std::ostream &stream) {
+		if (sim.get_active_representation() == Representation::STABILIZER) {
+			write_results_csv(stream, sim.get_wide_results());
+		} else {
+			write_results_csv(stream, sim.get_results(), sim.get_num_qbits());
+		}
+	});
+}
@@ -0,0 +1,99 @@
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "mapped_file.h"
+
+Mapped_File::~Mapped_File()
+{
+	close();
+}
+
+bool Mapped_File::open(std::filesystem::path const &path)
+{
+	close();
+	int const file_descriptor = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+	if (file_descriptor == -1) {
+		return false;
+	}
+	struct stat file_status;
+	if (fstat(file_descriptor, &file_status) != 0) {
+		::close(file_descriptor);
+		return false;
+	}
+	file_handle = file_descriptor;
+	size = (uint64_t)file_status.st_size;
+	if (!map()) {
+		close();
+		return false;
+	}
+	return true;
+}
+
+bool Mapped_File::resize(uint64_t new_size)
+{
+	if (!is_open()) {
+		return false;
+	}
+	unmap();
+	// the blocks are reserved up front where the file system allows it, so running out of disk fails here rather than
+	// as a fault on a later write through the mapping
+	int const file_descriptor = (int)file_handle;
+	int const allocate_result = new_size > size ? posix_fallocate(file_descriptor, 0, (off_t)new_size) : 0;
+	if ((allocate_result != 0 && allocate_result != EINVAL && allocate_result != EOPNOTSUPP) ||
+	    ftruncate(file_descriptor, (off_t)new_size) != 0) {
+		close();
+		return false;
+	}
+	size = new_size;
+	if (!map()) {
+		close();
+		return false;
+	}
+	return true;
+}
+
+void Mapped_File::flush(uint64_t offset, uint64_t length)
+{
+	if (data && offset < size) {
+		msync(data + offset, std::min(length, size - offset), MS_SYNC);
+	}
+}
+
+void Mapped_File::close()
+{
+	unmap();
+	if (is_open()) {
+		::close((int)file_handle);
+		file_handle = -1;
+	}
+	size = 0;
+}
+
+bool Mapped_File::map()
+{
+	if (size == 0) {
+		return true;
+	}
+	void *const mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, (int)file_handle, 0);
+	if (mapping == MAP_FAILED) {
+		return false;
+	}
+	data = static_cast<uint8_t *>(mapping);
+#ifdef MADV_HUGEPAGE
+	// huge pages cut the TLB misses of sweeps over large states, where the file system supports them for files
+	madvise(data, size, MADV_HUGEPAGE);
+#endif
+	return true;
+}
+
+void Mapped_File::unmap()
+{
+	if (data) {
+		munmap(data, size);
+		data = nullptr;
+	}
+}
@@ -0,0 +1,101 @@
+#include <algorithm>
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+
+#include "mapped_file.h"
+
+Mapped_File::~Mapped_File()
+{
+	close();
+}
+
+bool Mapped_File::open(std::filesystem::path const &path)
+{
+	close();
+	HANDLE const file = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size)) {
+		CloseHandle(file);
+		return false;
+	}
+	file_handle = (intptr_t)file;
+	size = (uint64_t)file_size.QuadPart;
+	if (!map()) {
+		close();
+		return false;
+	}
+	return true;
+}
+
+bool Mapped_File::resize(uint64_t new_size)
+{
+	if (!is_open()) {
+		return false;
+	}
+	unmap();
+	LARGE_INTEGER end_of_file;
+	end_of_file.QuadPart = (LONGLONG)new_size;
+	if (!SetFilePointerEx((HANDLE)file_handle, end_of_file, nullptr, FILE_BEGIN) || !SetEndOfFile((HANDLE)file_handle)) {
+		close();
+		return false;
+	}
+	size = new_size;
+	if (!map()) {
+		close();
+		return false;
+	}
+	return true;
+}
+
+void Mapped_File::flush(uint64_t offset, uint64_t length)
+{
+	if (data && offset < size) {
+		FlushViewOfFile(data + offset, (SIZE_T)std::min(length, size - offset));
+		FlushFileBuffers((HANDLE)file_handle);
+	}
+}
+
+void Mapped_File::close()
+{
+	unmap();
+	if (is_open()) {
+		CloseHandle((HANDLE)file_handle);
+		file_handle = -1;
+	}
+	size = 0;
+}
+
+bool Mapped_File::map()
+{
+	// large pages are only available for mappings backed by the page file, so file views use normal pages
+	if (size == 0) {
+		return true;
+	}
+	HANDLE const mapping = CreateFileMappingW((HANDLE)file_handle, nullptr, PAGE_READWRITE, (DWORD)(size >> 32), (DWORD)size, nullptr);
+	if (!mapping) {
+		return false;
+	}
+	void *const view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, (SIZE_T)size);
+	if (!view) {
+		CloseHandle(mapping);
+		return false;
+	}
+	mapping_handle = (intptr_t)mapping;
+	data = static_cast<uint8_t *>(view);
+	return true;
+}
+
+void Mapped_File::unmap()
+{
+	if (data) {
+		UnmapViewOfFile(data);
+		CloseHandle((HANDLE)mapping_handle);
+		data = nullptr;
+		mapping_handle = 0;
+	}
+}
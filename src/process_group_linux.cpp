@@ -0,0 +1,151 @@
+#include <cerrno>
+#include <cstdio>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "process_group.h"
+
+Process_Group::~Process_Group()
+{
+	if (num_ranks > 1) {
+		finish(false);
+	}
+}
+
+bool Process_Group::spawn(size_t new_num_ranks)
+{
+	if (num_ranks > 1 || new_num_ranks == 0) {
+		return false;
+	}
+
+	// every pair of ranks gets its own socket pair, created before forking so each process inherits its ends
+	std::vector<std::vector<int>> pair_sockets(new_num_ranks, std::vector<int>(new_num_ranks, -1));
+	auto const close_sockets = [&](size_t kept_rank) {
+		for (size_t first = 0; first < new_num_ranks; ++first) {
+			for (size_t second = 0; second < new_num_ranks; ++second) {
+				if (pair_sockets[first][second] != -1 && first != kept_rank) {
+					close(pair_sockets[first][second]);
+				}
+			}
+		}
+	};
+	for (size_t first = 0; first < new_num_ranks; ++first) {
+		for (size_t second = first + 1; second < new_num_ranks; ++second) {
+			int pair[2];
+			if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair) != 0) {
+				close_sockets(new_num_ranks);
+				return false;
+			}
+			pair_sockets[first][second] = pair[0];
+			pair_sockets[second][first] = pair[1];
+		}
+	}
+
+	// buffered output would otherwise be written once by each process
+	std::fflush(nullptr);
+	size_t new_rank = 0;
+	std::vector<intptr_t> new_processes;
+	for (size_t child_rank = 1; child_rank < new_num_ranks; ++child_rank) {
+		pid_t const process = fork();
+		if (process == 0) {
+			new_rank = child_rank;
+			break;
+		}
+		if (process < 0) {
+			break;
+		}
+		new_processes.push_back(process);
+	}
+	close_sockets(new_rank);
+
+	rank = new_rank;
+	num_ranks = new_num_ranks;
+	sockets.assign(pair_sockets[rank].begin(), pair_sockets[rank].end());
+	if (rank == 0) {
+		processes = std::move(new_processes);
+	}
+
+	// The other ranks wait for rank 0 to confirm every process started, and exit if it closes their socket instead, so
+	// they never run on in a group that failed to form.
+	uint8_t is_started = 0;
+	if (rank == 0) {
+		is_started = processes.size() + 1 == num_ranks ? 1 : 0;
+		for (size_t child_rank = 1; child_rank <= processes.size(); ++child_rank) {
+			is_started = is_started && send(child_rank, &is_started, sizeof(is_started)) ? 1 : 0;
+		}
+		if (!is_started) {
+			finish(false);
+			return false;
+		}
+	} else if (!receive(0, &is_started, sizeof(is_started)) || !is_started) {
+		finish(false);
+	}
+	return true;
+}
+
+bool Process_Group::finish(bool is_success)
+{
+	for (intptr_t socket : sockets) {
+		if (socket != -1) {
+			close((int)socket);
+		}
+	}
+	sockets.clear();
+	if (rank != 0) {
+		// skips the exit handlers and stream flushes, which belong to the process that was forked
+		_exit(is_success ? 0 : 1);
+	}
+
+	bool is_group_success = is_success;
+	for (intptr_t process : processes) {
+		int status = 0;
+		while (waitpid((pid_t)process, &status, 0) < 0 && errno == EINTR) {
+		}
+		is_group_success = is_group_success && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+	}
+	processes.clear();
+	num_ranks = 1;
+	return is_group_success;
+}
+
+bool Process_Group::exchange(size_t peer, void const *send_data, void *receive_data, size_t size)
+{
+	if (peer >= sockets.size() || sockets[peer] == -1) {
+		return false;
+	}
+	int const socket = (int)sockets[peer];
+	uint8_t const *send_bytes = static_cast<uint8_t const *>(send_data);
+	uint8_t *receive_bytes = static_cast<uint8_t *>(receive_data);
+	size_t num_sent = send_bytes ? 0 : size;
+	size_t num_received = receive_bytes ? 0 : size;
+	while (num_sent < size || num_received < size) {
+		pollfd poll_socket = { socket, (short)((num_sent < size ? POLLOUT : 0) | (num_received < size ? POLLIN : 0)), 0 };
+		if (poll(&poll_socket, 1, -1) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		if ((poll_socket.revents & (POLLERR | POLLNVAL)) || ((poll_socket.revents & POLLHUP) && num_received == size)) {
+			return false;
+		}
+
+		if (num_received < size && (poll_socket.revents & (POLLIN | POLLHUP))) {
+			ssize_t const count = recv(socket, receive_bytes + num_received, size - num_received, MSG_DONTWAIT);
+			if (count == 0 || (count < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+				return false;
+			}
+			num_received += count > 0 ? (size_t)count : 0;
+		}
+		if (num_sent < size && (poll_socket.revents & POLLOUT)) {
+			ssize_t const count = ::send(socket, send_bytes + num_sent, size - num_sent, MSG_DONTWAIT | MSG_NOSIGNAL);
+			if (count < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+				return false;
+			}
+			num_sent += count > 0 ? (size_t)count : 0;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,27 @@
+#include "process_group.h"
+
+// Windows has no fork, so a group only ever holds the calling process, and work split across ranks runs as one rank.
+
+Process_Group::~Process_Group()
+{
+}
+
+bool Process_Group::spawn(size_t new_num_ranks)
+{
+	if (num_ranks > 1 || new_num_ranks != 1) {
+		return false;
+	}
+	sockets.assign(1, -1);
+	return true;
+}
+
+bool Process_Group::finish(bool is_success)
+{
+	sockets.clear();
+	return is_success;
+}
+
+bool Process_Group::exchange(size_t, void const *, void *, size_t)
+{
+	return false;
+}
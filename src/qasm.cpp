@@ -5,6 +5,7 @@
 #include <string_view>
 
 #include "constants.h"
+#include "gates.h"
 #include "qasm.h"
 
 struct Expression
@@ -37,22 +38,26 @@ static std::vector<std::string_view> split(std::string_view string, char const *
 	return parts;
 }
 
-static std::optional<uint8_t> decode_operand(std::string_view operand)
+// operands hold the index of any qbit of the widest register
+static_assert(MAX_STABILIZER_QBITS - 1 <= UINT16_MAX);
+
+static std::optional<uint16_t> decode_operand(std::string_view operand, size_t num_qbits)
 {
 	if (operand.size() < 2 || operand[0] != 'q') {
-		return std::optional<uint8_t>();
+		return std::optional<uint16_t>();
 	}
 	size_t qbit_index = 0;
 	for (size_t i = 1; i < operand.size(); ++i) {
 		if (!std::isdigit(operand[i])) {
-			return std::optional<uint8_t>();
+			return std::optional<uint16_t>();
 		}
+		// checked as each digit is added, so a long operand can't wrap around to a valid index
 		qbit_index = (qbit_index * 10) + (operand[i] - '0');
+		if (qbit_index >= num_qbits) {
+			return std::optional<uint16_t>();
+		}
 	}
-	if (qbit_index >= NUM_QBITS) {
-		return std::optional<uint8_t>();
-	}
-	return std::optional<uint8_t>((uint8_t)qbit_index);
+	return std::optional<uint16_t>((uint16_t)qbit_index);
 }
 
 static std::optional<double> decode_immediate(std::string_view immediate)
@@ -65,7 +70,30 @@ static std::optional<double> decode_immediate(std::string_view immediate)
 	return std::optional<double>(result);
 }
 
-Quantum_Program::Quantum_Program(std::string source_code)
+static bool is_parameter_name(std::string_view name)
+{
+	if (name.empty() || !(std::isalpha((unsigned char)name[0]) || name[0] == '_')) {
+		return false;
+	}
+	// names shaped like qbit operands are reserved so that a misplaced operand is still reported
+	if (name.size() > 1 && name[0] == 'q' && std::all_of(name.begin() + 1, name.end(), [](char c) { return std::isdigit((unsigned char)c); })) {
+		return false;
+	}
+	return std::all_of(name.begin(), name.end(), [](char c) { return std::isalnum((unsigned char)c) || c == '_'; });
+}
+
+static std::optional<size_t> decode_count(std::string_view count)
+{
+	size_t result;
+	auto [ptr, ec] = std::from_chars(count.data(), count.data() + count.size(), result);
+	if (ec != std::errc() || ptr != (count.data() + count.size())) {
+		return std::optional<size_t>();
+	}
+	return std::optional<size_t>(result);
+}
+
+Quantum_Program::Quantum_Program(std::string source_code) :
+	num_qbits(DEFAULT_NUM_QBITS)
 {
 	std::vector<Expression> expressions;
 
@@ -89,7 +117,9 @@ Quantum_Program::Quantum_Program(std::string source_code)
 	}
 
 	for (auto const &expression : expressions) {
-		if (expression.parts[0] == "cnot") {
+		if (expression.parts[0] == "qbits") {
+			set_num_qbits(expression);
+		} else if (expression.parts[0] == "cnot") {
 			add_operation(Gate::CNOT, expression, 2);
 		} else if (expression.parts[0] == "i") {
 			add_operation(Gate::IDENTITY, expression, 1);
@@ -146,11 +176,48 @@ std::vector<Operation> const &Quantum_Program::get_operations() const
 	return operations;
 }
 
-std::vector<uint8_t> const &Quantum_Program::get_active_qbits() const
+std::vector<uint16_t> const &Quantum_Program::get_active_qbits() const
 {
 	return active_qbits;
 }
 
+size_t Quantum_Program::get_num_qbits() const
+{
+	return num_qbits;
+}
+
+std::vector<std::string> const &Quantum_Program::get_parameter_names() const
+{
+	return parameter_names;
+}
+
+bool Quantum_Program::is_clifford() const
+{
+	return clifford;
+}
+
+void Quantum_Program::set_num_qbits(Expression const &expression)
+{
+	if (!operations.empty()) {
+		set_error(expression.line_number, "Register width must be set before the first gate");
+		return;
+	}
+	if (expression.parts.size() != 2) {
+		set_error(expression.line_number,
+				  "Directive qbits expects 1 operand, " + std::to_string(expression.parts.size() - 1) + " operands found");
+		return;
+	}
+
+	std::optional<size_t> width = decode_count(expression.parts[1]);
+	if (!width || *width < 1 || *width > MAX_STABILIZER_QBITS) {
+		set_error(expression.line_number,
+				  "Invalid register width " + std::string(expression.parts[1]) + "; must be between 1 and " +
+				  std::to_string(MAX_STABILIZER_QBITS) + ", or " + std::to_string(MAX_QBITS) + " for programs with non Clifford gates");
+		return;
+	}
+	num_qbits = *width;
+}
+
 void Quantum_Program::add_operation(Gate gate, Expression const &expression, uint8_t num_operands, bool has_immediate)
 {
 	if (expression.parts.size() != (num_operands + has_immediate + 1)) {
@@ -160,12 +227,22 @@ void Quantum_Program::add_operation(Gate gate, Expression const &expression, uin
 		return;
 	}
 
+	// registers too wide for a state vector can only be simulated on a stabilizer tableau
+	if (!is_clifford_gate(gate) && num_qbits > MAX_QBITS) {
+		set_error(expression.line_number, "Gate " + std::string(expression.parts[0]) + " is not a Clifford gate; registers wider than " +
+		          std::to_string(MAX_QBITS) + " qbits support only Clifford gates");
+		return;
+	}
+	clifford = clifford && is_clifford_gate(gate);
+
 	Operation operation = { gate };
+	is_active_qbit.resize(num_qbits);
 	for (uint8_t index = 0; index < num_operands; ++index) {
-		std::optional<uint8_t> operand = decode_operand(expression.parts[index + 1]);
+		std::optional<uint16_t> operand = decode_operand(expression.parts[index + 1], num_qbits);
 		if (operand) {
 			operation.operands[index] = *operand;
-			if (std::find(active_qbits.begin(), active_qbits.end(), *operand) == active_qbits.end()) {
+			if (!is_active_qbit[*operand]) {
+				is_active_qbit[*operand] = true;
 				active_qbits.push_back(*operand);
 			}
 		} else {
@@ -184,11 +261,19 @@ void Quantum_Program::add_operation(Gate gate, Expression const &expression, uin
 	}
 
 	if (has_immediate) {
-		std::optional<double> immediate = decode_immediate(expression.parts[num_operands + 1]);
+		std::string_view const immediate_part = expression.parts[num_operands + 1];
+		std::optional<double> immediate = decode_immediate(immediate_part);
 		if (immediate) {
 			operation.immediate = *immediate;
+		} else if (is_parameter_name(immediate_part)) {
+			operation.immediate = 0.0;
+			operation.parameter = get_parameter_index(immediate_part);
+			if (operation.parameter == NO_PARAMETER) {
+				set_error(expression.line_number, "Too many parameters; at most " + std::to_string(NO_PARAMETER) + " are supported");
+				return;
+			}
 		} else {
-			set_error(expression.line_number, "Invalid immediate " + std::string(expression.parts[num_operands + 1]));
+			set_error(expression.line_number, "Invalid immediate " + std::string(immediate_part));
 			return;
 		}
 	}
@@ -196,6 +281,20 @@ void Quantum_Program::add_operation(Gate gate, Expression const &expression, uin
 	operations.push_back(operation);
 }
 
+uint16_t Quantum_Program::get_parameter_index(std::string_view name)
+{
+	// parameters are numbered in order of first use
+	auto const existing = std::find(parameter_names.begin(), parameter_names.end(), name);
+	if (existing != parameter_names.end()) {
+		return (uint16_t)(existing - parameter_names.begin());
+	}
+	if (parameter_names.size() >= NO_PARAMETER) {
+		return NO_PARAMETER;
+	}
+	parameter_names.emplace_back(name);
+	return (uint16_t)(parameter_names.size() - 1);
+}
+
 void Quantum_Program::set_error(uint32_t line_number, std::string const &error)
 {
 	valid = false;
@@ -1,440 +1,1513 @@
 #include <algorithm>
 #include <array>
+#include <bitset>
+#include <cstring>
+#include <iterator>
+#include <optional>
 #include <random>
+#include <type_traits>
+#include <utility>
 
 #include "constants.h"
+#include "gates.h"
 #include "qasm.h"
 #include "qsim.h"
 
 using namespace std::literals;
 
-static matrix<std::complex<double>> const identity = {
-	{ 1.0, 0.0 },
-	{ 0.0, 1.0 }
-};
+// state vectors smaller than this are updated on the calling thread, as waking the workers costs more than the sweep
+static constexpr uint64_t min_parallel_states = (uint64_t)1 << 14;
 
-static matrix<std::complex<double>> const hadamard = {
-	{ 1.0 / std::sqrt(2.0), 1.0 / std::sqrt(2.0) },
-	{ 1.0 / std::sqrt(2.0), -1.0 / std::sqrt(2.0) }
-};
+// fewer shots than this are sampled as a single stream on the calling thread
+static constexpr int min_parallel_runs = 1 << 16;
 
-static matrix<std::complex<double>> const pauli_x = {
-	{ 0.0, 1.0 },
-	{ 1.0, 0.0 }
-};
+// number of operations between the checkpoints kept while seeking
+static constexpr size_t checkpoint_interval = 16;
 
-static matrix<std::complex<double>> const pauli_y = {
-	{ 0.0, -1.0i },
-	{ 1.0i, 0.0 }
-};
+// upper bound on the total size of the per stream histograms, which limits the number of streams for wide states
+static constexpr size_t max_histogram_entries = (size_t)1 << 26;
 
-static matrix<std::complex<double>> const pauli_z = {
-	{ 1.0, 0.0 },
-	{ 0.0, -1.0 }
-};
+// the amplitudes of a tableau are only listed if it has at most 2^max_listed_stabilizer_generators of them, as each takes
+// an entry of its own
+static constexpr size_t max_listed_stabilizer_generators = 20;
 
-static matrix<std::complex<double>> const s_gate = {
-	{ 1.0, 0.0 },
-	{ 0.0, 1.0i }
-};
+// states mapped from a file are swept in blocks of this many indices, which the threads take in turn
+static constexpr uint64_t mapped_block_size = (uint64_t)1 << 16;
 
-static matrix<std::complex<double>> const s_dag_gate = {
-	{ 1.0, 0.0 },
-	{ 0.0, -1.0i }
-};
+// the amplitudes in a state file start after the header, on a huge page boundary
+static constexpr uint64_t state_file_header_size = (uint64_t)1 << 21;
+static constexpr char state_file_magic[8] = "fqcsim1";
 
-static matrix<std::complex<double>> const t_gate = {
-	{ 1.0, 0.0 },
-	{ 0.0, std::exp((1.0i * CONST_PI) / 4.0) }
+struct State_File_Header
+{
+	char magic[8];
+	uint64_t num_qbits;
+	uint64_t precision;
+	// the state is after the first gate_index operations of the program with this prefix hash, if it is current
+	uint64_t gate_index;
+	uint64_t prefix_hash;
+	uint64_t is_current;
 };
 
-static matrix<std::complex<double>> const t_dag_gate = {
-	{ 1.0, 0.0 },
-	{ 0.0, std::exp((-1.0i * CONST_PI) / 4.0) }
-};
+// powers of i, indexed by the phase of a Pauli string
+static constexpr std::complex<double> pauli_phases[] = { 1.0, { 0.0, 1.0 }, -1.0, { 0.0, -1.0 } };
 
-static matrix<std::complex<double>> const zero_projector = {
-	{ 1.0, 0.0 },
-	{ 0.0, 0.0 }
-};
+QSim::QSim(size_t num_threads) :
+	thread_pool(num_threads),
+	gate_kernels(&get_gate_kernels<double>(detect_instruction_set())),
+	single_gate_kernels(&get_gate_kernels<float>(gate_kernels->instruction_set))
+{
+	// the single shot taken at the end of stepping through a program fits without allocating
+	results.reserve(1);
+	reset();
+}
 
-static matrix<std::complex<double>> const one_projector = {
-	{ 0.0, 0.0 },
-	{ 0.0, 1.0 }
-};
+QSim::~QSim()
+{
+	flush_state_file();
+}
 
-static matrix<std::complex<double>> build_rx(double theta)
+void QSim::set_program(Quantum_Program const *new_program)
 {
-	return {
-		{ std::cos(theta / 2.0), -1.0i * std::sin(theta / 2.0) },
-		{ -1.0i * std::sin(theta / 2.0), std::cos(theta / 2.0) }
-	};
+	program = new_program;
+	parameter_values.clear();
+	bind_operations();
+	reset();
 }
 
-static matrix<std::complex<double>> build_ry(double theta)
+void QSim::set_parameters(std::vector<double> const &values)
 {
-	return {
-		{ std::cos(theta / 2.0), -std::sin(theta / 2.0) },
-		{ -std::sin(theta / 2.0), std::cos(theta / 2.0) }
-	};
+	parameter_values = values;
+	bind_operations();
+	reset();
 }
 
-static matrix<std::complex<double>> build_rz(double theta)
+void QSim::set_max_checkpoints(size_t new_max_checkpoints)
 {
-	double const e = std::exp(1.0);
-	return {
-		{ std::pow(e, -1.0i * (theta / 2.0)), 0.0 },
-		{ 0.0, std::pow(e, 1.0i * (theta / 2.0)) }
-	};
+	max_checkpoints = new_max_checkpoints;
+	if (checkpoints.size() > max_checkpoints) {
+		checkpoints.resize(max_checkpoints);
+		checkpoint_uses.resize(max_checkpoints);
+	}
+	if (max_checkpoints == 0) {
+		std::vector<QSim_Snapshot>().swap(checkpoints);
+		std::vector<uint64_t>().swap(checkpoint_uses);
+	}
 }
 
-template <typename Type>
-static matrix<Type> tensor_product(matrix<Type> const &lhs, matrix<Type> const &rhs)
+bool QSim::set_state_file(std::filesystem::path const &path)
 {
-	size_t const lhs_width = lhs[0].size();
-	size_t const lhs_height = lhs.size();
-	size_t const rhs_width = rhs[0].size();
-	size_t const rhs_height = rhs.size();
-	size_t const result_width = lhs_width * rhs_width;
-	size_t const result_height = lhs_height * rhs_height;
+	flush_state_file();
+	if (!state_file.open(path)) {
+		reset();
+		return false;
+	}
 
-	matrix<Type> result;
-	result.resize(result_height);
-	for (auto &row : result) {
-		row.resize(result_width);
+	// only an empty file or one written here is ever overwritten, so naming the wrong file can't destroy its contents
+	bool const is_state_file = state_file.get_size() == 0 || (state_file.get_size() >= sizeof(state_file_magic) &&
+	                           std::memcmp(state_file.get_data(), state_file_magic, sizeof(state_file_magic)) == 0);
+	if (!is_state_file) {
+		state_file.close();
+		reset();
+		return false;
 	}
 
-	for (size_t y = 0; y < result_height; ++y) {
-		for (size_t x = 0; x < result_width; ++x) {
-			size_t const lhs_x = x / rhs_width;
-			size_t const lhs_y = y / rhs_height;
-			size_t const rhs_x = x % rhs_width;
-			size_t const rhs_y = y % rhs_height;
-			result[y][x] = lhs[lhs_y][lhs_x] * rhs[rhs_y][rhs_x];
-		}
+	State_File_Header header = {};
+	if (state_file.get_size() >= sizeof(header)) {
+		std::memcpy(&header, state_file.get_data(), sizeof(header));
+	}
+	uint64_t const amplitude_size = precision == Precision::SINGLE ? sizeof(std::complex<float>) : sizeof(std::complex<double>);
+	bool const can_resume = active_representation == Representation::FULL && header.is_current &&
+	                        std::memcmp(header.magic, state_file_magic, sizeof(header.magic)) == 0 &&
+	                        header.num_qbits == num_qbits && header.precision == (uint64_t)precision &&
+	                        header.gate_index < prefix_hashes.size() && header.prefix_hash == prefix_hashes[header.gate_index] &&
+	                        state_file.get_size() == state_file_header_size + (num_states() * amplitude_size);
+	if (!can_resume) {
+		reset();
+		return state_file.is_open();
 	}
 
-	return result;
+	// the entanglements aren't kept in the file, but only depend on which multi qbit gates have been applied
+	release_unused_states();
+	next_gate_index = header.gate_index;
+	entanglements.reset(num_qbits);
+	for (size_t gate_index = 0; gate_index < next_gate_index; ++gate_index) {
+		update_entanglements(operations[gate_index].operands.data(), get_num_operands(operations[gate_index].gate));
+	}
+	is_state_file_current = true;
+	return true;
 }
 
-template <typename Type>
-static std::vector<Type> vec_mat_mul(std::vector<Type> const &vec, matrix<Type> const &mat)
+void QSim::clear_state_file()
 {
-	size_t const size = vec.size();
+	flush_state_file();
+	state_file.close();
+	reset();
+}
 
-	std::vector<Type> result;
-	result.resize(size);
+void QSim::flush_state_file()
+{
+	if (!is_state_mapped() || is_state_file_current) {
+		return;
+	}
+	// the amplitudes reach the disk before the header says they are current
+	State_File_Header *header = reinterpret_cast<State_File_Header *>(state_file.get_data());
+	header->gate_index = next_gate_index;
+	header->prefix_hash = prefix_hashes[next_gate_index];
+	state_file.flush();
+	header->is_current = 1;
+	state_file.flush(0, sizeof(State_File_Header));
+	is_state_file_current = true;
+}
 
-	for (size_t y = 0; y < size; ++y) {
-		result[y] = 0.0;
-		for (size_t x = 0; x < size; ++x) {
-			result[y] += vec[x] * mat[y][x];
-		}
+void QSim::invalidate_state_file()
+{
+	// called before the state in the file changes, so an interrupted update isn't taken for a current state
+	if (is_state_mapped() && is_state_file_current) {
+		reinterpret_cast<State_File_Header *>(state_file.get_data())->is_current = 0;
+		state_file.flush(0, sizeof(State_File_Header));
+		is_state_file_current = false;
 	}
-	return result;
 }
 
-template <typename Type>
-static matrix<Type> mat_mat_add(matrix<Type> const &lhs, matrix<Type> const &rhs)
+static uint64_t hash_operation(uint64_t hash, Operation const &operation)
 {
-	size_t const width = lhs[0].size();
-	size_t const height = lhs.size();
+	uint64_t immediate_bits;
+	std::memcpy(&immediate_bits, &operation.immediate, sizeof(immediate_bits));
+	uint64_t const key = (uint64_t)operation.gate | ((uint64_t)operation.operands[0] << 8) |
+	                     ((uint64_t)operation.operands[1] << 16) | ((uint64_t)operation.operands[2] << 24);
+	return split_mix(split_mix(hash ^ key) ^ immediate_bits);
+}
 
-	matrix<Type> result;
-	result.resize(height);
-	for (auto &row : result) {
-		row.resize(width);
+void QSim::bind_operations()
+{
+	operations.clear();
+	fused_operations.clear();
+	prefix_hashes.assign(1, split_mix(program ? program->get_num_qbits() : DEFAULT_NUM_QBITS));
+	checkpoint_gate_index = 0;
+	num_prefix_fused_operations = 0;
+	if (!program) {
+		return;
 	}
 
-	for (size_t y = 0; y < height; ++y) {
-		for (size_t x = 0; x < width; ++x) {
-			result[y][x] = lhs[y][x] + rhs[y][x];
-		}
+	// the bound angles change the fused matrices, so the program is fused again for each set of values
+	operations = program->get_operations();
+	Fused_Split const split = bind_and_fuse_operations(operations, parameter_values, fused_operations);
+	checkpoint_gate_index = split.num_prefix_operations;
+	num_prefix_fused_operations = split.num_prefix_fused_operations;
+	for (auto const &operation : operations) {
+		prefix_hashes.push_back(hash_operation(prefix_hashes.back(), operation));
 	}
+}
 
-	return result;
+void QSim::set_seed(uint64_t new_seed)
+{
+	seed = new_seed;
+	num_samplings = 0;
 }
 
-template <typename Type>
-static Type dot_product(std::vector<Type> const &lhs, std::vector<Type> const &rhs)
+void QSim::set_precision(Precision new_precision)
 {
-	Type result = 0.0;
-	for (size_t index = 0; index < lhs.size(); ++index) {
-		result += lhs[index] * rhs[index];
-	}
-	return result;
+	precision = new_precision;
+	reset();
 }
 
-QSim::QSim() :
-	random_distribution(0.0, 1.0)
+void QSim::set_representation(Representation new_representation)
 {
+	representation = new_representation;
 	reset();
 }
 
-QSim::~QSim()
+void QSim::release_unused_states()
 {
+	// only the state for the current precision and representation is kept
+	bool const is_full = active_representation == Representation::FULL && !state_file.is_open();
+	bool const is_factored = active_representation == Representation::FACTORED;
+	if (precision == Precision::SINGLE || !is_full) {
+		std::vector<std::complex<double>>().swap(state_vector);
+	}
+	if (precision == Precision::DOUBLE || !is_full) {
+		std::vector<std::complex<float>>().swap(single_state_vector);
+	}
+	if (precision == Precision::SINGLE || !is_factored) {
+		std::vector<std::vector<std::complex<double>>>().swap(group_state_vectors);
+		std::vector<std::complex<double>>().swap(merged_group_state);
+	}
+	if (precision == Precision::DOUBLE || !is_factored) {
+		std::vector<std::vector<std::complex<float>>>().swap(single_group_state_vectors);
+		std::vector<std::complex<float>>().swap(single_merged_group_state);
+	}
+	if (active_representation != Representation::STABILIZER) {
+		tableau = Stabilizer_Tableau();
+	}
 }
 
-void QSim::set_program(Quantum_Program const *new_program)
+template <typename Real>
+static void reset_state(std::vector<std::complex<Real>> &state_vector, uint64_t num_states)
 {
-	program = new_program;
-	reset();
+	state_vector.resize(num_states);
+	std::fill(state_vector.begin(), state_vector.end(), (Real)0.0);
+	state_vector[0] = (Real)1.0;
+}
+
+bool QSim::reset_state_file()
+{
+	// Truncating the file first lets the file system supply the zero amplitudes, rather than writing them all. If the
+	// file can't be grown it is closed, and the state is kept in memory instead.
+	uint64_t const amplitude_size = precision == Precision::SINGLE ? sizeof(std::complex<float>) : sizeof(std::complex<double>);
+	is_state_file_current = false;
+	if (!state_file.resize(0) || !state_file.resize(state_file_header_size + (num_states() * amplitude_size))) {
+		return false;
+	}
+
+	State_File_Header header = {};
+	std::memcpy(header.magic, state_file_magic, sizeof(header.magic));
+	header.num_qbits = num_qbits;
+	header.precision = (uint64_t)precision;
+	std::memcpy(state_file.get_data(), &header, sizeof(header));
+	if (precision == Precision::SINGLE) {
+		get_state<float>()[0] = 1.0f;
+	} else {
+		get_state<double>()[0] = 1.0;
+	}
+	return true;
+}
+
+template <typename Real>
+static void reset_group_states(std::vector<std::vector<std::complex<Real>>> &group_state_vectors, size_t num_qbits)
+{
+	// every qbit starts in its own group, in the zero state
+	group_state_vectors.resize(num_qbits);
+	for (auto &group_state : group_state_vectors) {
+		reset_state(group_state, 2);
+	}
 }
 
 void QSim::reset()
 {
 	next_gate_index = 0;
-	state_vector.resize(STATE_VEC_SIZE);
-	std::fill(state_vector.begin(), state_vector.end(), 0.0);
-	state_vector[0] = 1.0;
+	num_qbits = program ? program->get_num_qbits() : DEFAULT_NUM_QBITS;
+	// Clifford programs run on a tableau when asked, and always when the register is too wide for a state vector
+	bool const is_clifford = !program || program->is_clifford();
+	if (is_clifford && (representation == Representation::STABILIZER || num_qbits > MAX_QBITS)) {
+		active_representation = Representation::STABILIZER;
+	} else if (representation == Representation::STABILIZER) {
+		active_representation = Representation::FULL;
+	} else {
+		active_representation = representation;
+	}
+	release_unused_states();
 
-	qbit_groups.clear();
-	for (uint8_t qbit_index = 0; qbit_index < NUM_QBITS; ++qbit_index) {
-		qbit_groups.push_back({qbit_index});
+	if (active_representation == Representation::STABILIZER) {
+		tableau.reset(num_qbits);
+	} else if (active_representation == Representation::FACTORED) {
+		if (precision == Precision::SINGLE) {
+			reset_group_states(single_group_state_vectors, num_qbits);
+		} else {
+			reset_group_states(group_state_vectors, num_qbits);
+		}
+		group_qbits.resize(num_qbits);
+		for (uint16_t qbit = 0; qbit < num_qbits; ++qbit) {
+			group_qbits[qbit].assign(1, qbit);
+		}
+		group_bits.assign(num_qbits, 0);
+	} else if (!state_file.is_open() || !reset_state_file()) {
+		if (precision == Precision::SINGLE) {
+			reset_state(single_state_vector, num_states());
+		} else {
+			reset_state(state_vector, num_states());
+		}
 	}
+
+	entanglements.reset(num_qbits);
 }
 
 void QSim::run(int num_runs)
 {
-	reset();
-	if (program) {
-		while (next_gate_index < program->get_operations().size()) {
+	size_t const resume_gate_index = restore_checkpoint(operations.size());
+	if (resume_gate_index < operations.size()) {
+		invalidate_state_file();
+	}
+	if (active_representation != Representation::FULL) {
+		// Fused blocks would link the groups of all the qbits they cover, and a tableau can only apply Clifford gates, so
+		// the operations are applied one at a time.
+		while (next_gate_index < checkpoint_gate_index) {
 			step(false);
 		}
+		if (max_checkpoints > 0 && checkpoint_gate_index > resume_gate_index && checkpoint_gate_index > 0) {
+			save_checkpoint();
+		}
+		while (next_gate_index < operations.size()) {
+			step(false);
+		}
+	} else if (program) {
+		auto const perform_fused_operations = [this](auto begin, auto end) {
+			if (cache_block_qbits > 0 && num_qbits > cache_block_qbits) {
+				for (auto const &pass : schedule_operations(std::vector<Fused_Operation>(begin, end), num_qbits, cache_block_qbits)) {
+					if (precision == Precision::SINGLE) {
+						perform_gate_pass<float>(pass);
+					} else {
+						perform_gate_pass<double>(pass);
+					}
+				}
+				return;
+			}
+			for (auto fused_operation = begin; fused_operation != end; ++fused_operation) {
+				if (precision == Precision::SINGLE) {
+					perform_fused_operation<float>(*fused_operation);
+				} else {
+					perform_fused_operation<double>(*fused_operation);
+				}
+			}
+		};
+
+		if (resume_gate_index == 0) {
+			perform_fused_operations(fused_operations.begin(), fused_operations.begin() + num_prefix_fused_operations);
+			next_gate_index = checkpoint_gate_index;
+			if (max_checkpoints > 0 && checkpoint_gate_index > 0) {
+				save_checkpoint();
+			}
+			perform_fused_operations(fused_operations.begin() + num_prefix_fused_operations, fused_operations.end());
+		} else if (resume_gate_index == checkpoint_gate_index) {
+			perform_fused_operations(fused_operations.begin() + num_prefix_fused_operations, fused_operations.end());
+		} else {
+			// a checkpoint from elsewhere in the program, such as one kept while seeking
+			std::vector<Fused_Operation> const remaining_operations =
+				fuse_operations(std::vector<Operation>(operations.begin() + resume_gate_index, operations.end()));
+			perform_fused_operations(remaining_operations.begin(), remaining_operations.end());
+		}
+		next_gate_index = operations.size();
 	}
 
+	flush_state_file();
 	generate_results(num_runs);
 }
 
 void QSim::step(bool is_single_step)
 {
-	if (program && next_gate_index < program->get_operations().size()) {
-		Operation const &operation = program->get_operations()[next_gate_index];
-		switch (operation.gate) {
-			case Gate::CNOT: {
-				perform_cnot_gate(operation.operands[0], operation.operands[1]);
-			} break;
-			case Gate::IDENTITY: {
-				perform_quantum_gate(identity, operation.operands[0]);
-			} break;
-			case Gate::HADAMARD: {
-				perform_quantum_gate(hadamard, operation.operands[0]);
-			} break;
-			case Gate::PAULI_X: {
-				perform_quantum_gate(pauli_x, operation.operands[0]);
-			} break;
-			case Gate::PAULI_Y: {
-				perform_quantum_gate(pauli_y, operation.operands[0]);
-			} break;
-			case Gate::PAULI_Z: {
-				perform_quantum_gate(pauli_z, operation.operands[0]);
-			} break;
-			case Gate::R_X: {
-				matrix<std::complex<double>> const r_x = build_rx(operation.immediate);
-				perform_quantum_gate(r_x, operation.operands[0]);
-			} break;
-			case Gate::R_Y: {
-				matrix<std::complex<double>> const r_y = build_ry(operation.immediate);
-				perform_quantum_gate(r_y, operation.operands[0]);
-			} break;
-			case Gate::R_Z: {
-				matrix<std::complex<double>> const r_z = build_rz(operation.immediate);
-				perform_quantum_gate(r_z, operation.operands[0]);
-			} break;
-			case Gate::S: {
-				perform_quantum_gate(s_gate, operation.operands[0]);
-			} break;
-			case Gate::S_DAG: {
-				perform_quantum_gate(s_dag_gate, operation.operands[0]);
-			} break;
-			case Gate::SWAP: {
-				perform_cnot_gate(operation.operands[0], operation.operands[1]);
-				perform_cnot_gate(operation.operands[1], operation.operands[0]);
-				perform_cnot_gate(operation.operands[0], operation.operands[1]);
-			} break;
-			case Gate::T: {
-				perform_quantum_gate(t_gate, operation.operands[0]);
-			} break;
-			case Gate::T_DAG: {
-				perform_quantum_gate(t_dag_gate, operation.operands[0]);
-			} break;
-			case Gate::TOFFOLI: {
-				perform_quantum_gate(hadamard, operation.operands[2]);
-				perform_cnot_gate(operation.operands[1], operation.operands[2]);
-				perform_quantum_gate(t_dag_gate, operation.operands[2]);
-				perform_cnot_gate(operation.operands[0], operation.operands[2]);
-				perform_quantum_gate(t_gate, operation.operands[2]);
-				perform_cnot_gate(operation.operands[1], operation.operands[2]);
-				perform_quantum_gate(t_dag_gate, operation.operands[2]);
-				perform_cnot_gate(operation.operands[0], operation.operands[2]);
-				perform_quantum_gate(t_gate, operation.operands[1]);
-				perform_quantum_gate(t_gate, operation.operands[2]);
-				perform_cnot_gate(operation.operands[0], operation.operands[1]);
-				perform_quantum_gate(hadamard, operation.operands[2]);
-				perform_quantum_gate(t_gate, operation.operands[0]);
-				perform_quantum_gate(t_dag_gate, operation.operands[1]);
-				perform_cnot_gate(operation.operands[0], operation.operands[1]);
-			} break;
+	if (next_gate_index < operations.size()) {
+		Operation const &operation = operations[next_gate_index];
+		invalidate_state_file();
+		if (active_representation == Representation::STABILIZER) {
+			perform_tableau_operation(operation);
+		} else if (precision == Precision::SINGLE) {
+			perform_operation<float>(operation);
+		} else {
+			perform_operation<double>(operation);
 		}
 		next_gate_index += 1;
 
-		if (is_single_step && next_gate_index == program->get_operations().size()) {
+		if (is_single_step && next_gate_index == operations.size()) {
 			generate_results(1);
 		}
 	}
 }
 
+void QSim::seek(size_t gate_index)
+{
+	gate_index = std::min(gate_index, operations.size());
+	QSim_Snapshot const *checkpoint = find_checkpoint(gate_index);
+	if (gate_index < next_gate_index || (checkpoint && checkpoint->gate_index > next_gate_index)) {
+		restore_checkpoint(gate_index);
+	}
+
+	while (next_gate_index < gate_index) {
+		step();
+		if (max_checkpoints > 0 && next_gate_index % checkpoint_interval == 0) {
+			save_checkpoint();
+		}
+	}
+}
+
+void QSim::save_snapshot(QSim_Snapshot &snapshot) const
+{
+	snapshot.gate_index = next_gate_index;
+	snapshot.prefix_hash = prefix_hashes[next_gate_index];
+	snapshot.precision = precision;
+	snapshot.representation = active_representation;
+	// only the state for the current precision and representation is held, so the others copy as empty
+	snapshot.state_vector = state_vector;
+	snapshot.single_state_vector = single_state_vector;
+	if (is_state_mapped() && precision == Precision::SINGLE) {
+		snapshot.single_state_vector.assign(get_state<float>(), get_state<float>() + num_states());
+	} else if (is_state_mapped()) {
+		snapshot.state_vector.assign(get_state<double>(), get_state<double>() + num_states());
+	}
+	snapshot.group_state_vectors = group_state_vectors;
+	snapshot.single_group_state_vectors = single_group_state_vectors;
+	snapshot.entanglements = entanglements;
+	snapshot.tableau = tableau;
+}
+
+bool QSim::restore_snapshot(QSim_Snapshot const &snapshot)
+{
+	if (!matches_snapshot(snapshot)) {
+		return false;
+	}
+
+	// the hash covers the register width, so the full state vectors are the same size
+	invalidate_state_file();
+	next_gate_index = snapshot.gate_index;
+	entanglements = snapshot.entanglements;
+	if (active_representation == Representation::STABILIZER) {
+		tableau = snapshot.tableau;
+	} else if (active_representation == Representation::FACTORED) {
+		group_state_vectors = snapshot.group_state_vectors;
+		single_group_state_vectors = snapshot.single_group_state_vectors;
+		rebuild_group_qbits();
+	} else if (precision == Precision::SINGLE) {
+		std::copy(snapshot.single_state_vector.begin(), snapshot.single_state_vector.end(), get_state<float>());
+	} else {
+		std::copy(snapshot.state_vector.begin(), snapshot.state_vector.end(), get_state<double>());
+	}
+	return true;
+}
+
+bool QSim::matches_snapshot(QSim_Snapshot const &snapshot) const
+{
+	return snapshot.precision == precision && snapshot.representation == active_representation &&
+	       snapshot.gate_index < prefix_hashes.size() && snapshot.prefix_hash == prefix_hashes[snapshot.gate_index];
+}
+
+void QSim::save_checkpoint()
+{
+	// a checkpoint of the same state is only marked as used, otherwise the least recently used one is replaced
+	size_t slot = checkpoints.size();
+	for (size_t index = 0; index < checkpoints.size(); ++index) {
+		QSim_Snapshot const &checkpoint = checkpoints[index];
+		if (checkpoint.gate_index == next_gate_index && matches_snapshot(checkpoint)) {
+			checkpoint_uses[index] = ++checkpoint_clock;
+			return;
+		}
+	}
+	if (checkpoints.size() < max_checkpoints) {
+		checkpoints.emplace_back();
+		checkpoint_uses.push_back(0);
+	} else {
+		slot = std::min_element(checkpoint_uses.begin(), checkpoint_uses.end()) - checkpoint_uses.begin();
+	}
+	save_snapshot(checkpoints[slot]);
+	checkpoint_uses[slot] = ++checkpoint_clock;
+}
+
+QSim_Snapshot const *QSim::find_checkpoint(size_t max_gate_index) const
+{
+	// the checkpoint furthest into the program, as it leaves the fewest operations to run
+	QSim_Snapshot const *best_checkpoint = nullptr;
+	for (auto const &checkpoint : checkpoints) {
+		if (checkpoint.gate_index <= max_gate_index && matches_snapshot(checkpoint) &&
+		    (!best_checkpoint || checkpoint.gate_index > best_checkpoint->gate_index)) {
+			best_checkpoint = &checkpoint;
+		}
+	}
+	return best_checkpoint;
+}
+
+size_t QSim::restore_checkpoint(size_t max_gate_index)
+{
+	// A state file carries on from its current state, which may have been left by another process, unless a checkpoint
+	// is further on. Otherwise this starts from the initial state when there is no usable checkpoint.
+	QSim_Snapshot const *checkpoint = find_checkpoint(max_gate_index);
+	if (is_state_mapped() && next_gate_index <= max_gate_index && (!checkpoint || checkpoint->gate_index <= next_gate_index)) {
+		return next_gate_index;
+	}
+	if (!checkpoint) {
+		reset();
+		return 0;
+	}
+	restore_snapshot(*checkpoint);
+	checkpoint_uses[checkpoint - checkpoints.data()] = ++checkpoint_clock;
+	return next_gate_index;
+}
+
+template <typename Real>
+static void collect_amplitudes(std::complex<Real> const *state, uint64_t num_states, std::vector<Amplitude> &amplitudes)
+{
+	for (uint64_t index = 0; index < num_states; ++index) {
+		if (std::abs(state[index]) != (Real)0.0) {
+			amplitudes.push_back({index, std::complex<double>(state[index])});
+		}
+	}
+}
+
+// Returns the bits of the register's state index that a group's state index maps to.
+static uint64_t scatter_group_index(uint64_t group_index, std::vector<uint16_t> const &group, size_t num_qbits)
+{
+	uint64_t index = 0;
+	for (size_t position = 0; position < group.size(); ++position) {
+		uint64_t const group_bit = group.size() - 1 - position;
+		index |= ((group_index >> group_bit) & 1) << (num_qbits - 1 - group[position]);
+	}
+	return index;
+}
+
+template <typename Real>
+static void collect_factored_amplitudes(std::vector<std::vector<std::complex<Real>>> const &group_state_vectors,
+                                        std::vector<std::vector<uint16_t>> const &group_qbits, size_t num_qbits,
+                                        std::vector<Amplitude> &amplitudes)
+{
+	// the non-zero amplitudes of the register are the products of those of each group
+	amplitudes.push_back({ 0, 1.0 });
+	std::vector<Amplitude> group_amplitudes;
+	for (size_t group = 0; group < group_qbits.size(); ++group) {
+		if (group_qbits[group].empty()) {
+			continue;
+		}
+		group_amplitudes.clear();
+		collect_amplitudes(group_state_vectors[group].data(), group_state_vectors[group].size(), group_amplitudes);
+		std::vector<Amplitude> products;
+		products.reserve(amplitudes.size() * group_amplitudes.size());
+		for (auto const &amplitude : amplitudes) {
+			for (auto const &group_amplitude : group_amplitudes) {
+				products.push_back({ amplitude.state | scatter_group_index(group_amplitude.state, group_qbits[group], num_qbits),
+				                     amplitude.amplitude * group_amplitude.amplitude });
+			}
+		}
+		amplitudes = std::move(products);
+	}
+	std::sort(amplitudes.begin(), amplitudes.end(), [](Amplitude const &lhs, Amplitude const &rhs) { return lhs.state < rhs.state; });
+}
+
+// Returns the state index of a basis state of at most 64 qbits, held as the value of each qbit as in a tableau row.
+static uint64_t get_state_index(std::vector<uint64_t> const &qbit_words, size_t num_qbits)
+{
+	uint64_t state = 0;
+	for (size_t qbit = 0; qbit < num_qbits; ++qbit) {
+		state |= ((qbit_words[qbit / 64] >> (qbit % 64)) & 1) << (num_qbits - 1 - qbit);
+	}
+	return state;
+}
+
+static void collect_stabilizer_amplitudes(Stabilizer_Support const &support, size_t num_qbits, std::vector<Amplitude> &amplitudes)
+{
+	// Applying one generator at a time, in Gray code order, visits every combination of them once. The generators
+	// commute and square to the identity, so each step reaches the state of its combination.
+	size_t const num_generators = support.generators.size();
+	if (num_generators > max_listed_stabilizer_generators) {
+		return;
+	}
+	std::vector<uint64_t> flip_masks;
+	std::vector<uint64_t> sign_masks;
+	for (auto const &generator : support.generators) {
+		flip_masks.push_back(get_state_index(generator.flip_words, num_qbits));
+		sign_masks.push_back(get_state_index(generator.sign_words, num_qbits));
+	}
+	uint64_t state = get_state_index(support.seed_words, num_qbits);
+	std::complex<double> amplitude = std::pow(2.0, -0.5 * (double)num_generators);
+	amplitudes.reserve((uint64_t)1 << num_generators);
+	amplitudes.push_back({ state, amplitude });
+	for (uint64_t step = 1; step < ((uint64_t)1 << num_generators); ++step) {
+		size_t const generator = std::bitset<64>((step & (~step + 1)) - 1).count();
+		bool const is_negated = std::bitset<64>(state & sign_masks[generator]).count() & 1;
+		amplitude *= pauli_phases[(support.generators[generator].phase + (is_negated ? 2 : 0)) & 3];
+		state ^= flip_masks[generator];
+		amplitudes.push_back({ state, amplitude });
+	}
+	std::sort(amplitudes.begin(), amplitudes.end(), [](Amplitude const &lhs, Amplitude const &rhs) { return lhs.state < rhs.state; });
+}
+
 std::vector<Amplitude> QSim::get_amplitudes() const
 {
 	std::vector<Amplitude> amplitudes;
-	for (size_t index = 0; index < state_vector.size(); ++index) {
-		if (std::abs(state_vector[index]) != 0.0) {
-			amplitudes.push_back({(uint8_t)index, state_vector[index]});
+	if (active_representation == Representation::STABILIZER) {
+		// a state index holds at most 64 qbits
+		if (num_qbits <= 64) {
+			collect_stabilizer_amplitudes(tableau.get_support(), num_qbits, amplitudes);
 		}
+	} else if (active_representation == Representation::FACTORED) {
+		if (precision == Precision::SINGLE) {
+			collect_factored_amplitudes(single_group_state_vectors, group_qbits, num_qbits, amplitudes);
+		} else {
+			collect_factored_amplitudes(group_state_vectors, group_qbits, num_qbits, amplitudes);
+		}
+	} else if (precision == Precision::SINGLE) {
+		collect_amplitudes(get_state<float>(), num_states(), amplitudes);
+	} else {
+		collect_amplitudes(get_state<double>(), num_states(), amplitudes);
 	}
 	return amplitudes;
 }
 
-std::array<std::complex<double>, 2> QSim::get_qbit_state(uint8_t qbit) const
+template <typename Real>
+static std::array<std::complex<double>, 2> get_bit_sums(std::complex<Real> const *state, uint64_t num_states, uint64_t bit)
 {
 	std::complex<double> zero_probability = 0.0f;
 	std::complex<double> one_probability = 0.0f;
-	for (size_t state = 0; state < state_vector.size(); ++state) {
-		if ((state >> (7 - qbit)) & 1) {
-			one_probability += std::pow(state_vector[state], 2);
+	for (uint64_t index = 0; index < num_states; ++index) {
+		if ((index >> bit) & 1) {
+			one_probability += std::pow(std::complex<double>(state[index]), 2);
 		} else {
-			zero_probability += std::pow(state_vector[state], 2);
+			zero_probability += std::pow(std::complex<double>(state[index]), 2);
 		}
 	}
+	return { zero_probability, one_probability };
+}
 
-	return { std::sqrt(zero_probability), std::sqrt(one_probability) };
+template <typename Real>
+static std::array<std::complex<double>, 2> get_bit_state(std::complex<Real> const *state, uint64_t num_states, uint64_t bit)
+{
+	std::array<std::complex<double>, 2> const sums = get_bit_sums(state, num_states, bit);
+	return { std::sqrt(sums[0]), std::sqrt(sums[1]) };
 }
 
-void QSim::perform_quantum_gate(matrix<std::complex<double>> const &gate, uint8_t qbit)
+template <typename Real>
+static std::array<std::complex<double>, 2> get_factored_bit_state(std::vector<std::vector<std::complex<Real>>> const &group_state_vectors,
+                                                                  size_t group, uint64_t bit)
 {
-	std::vector<matrix<std::complex<double>>> matrices;
-	for (uint8_t index = 0; index < NUM_QBITS; ++index) {
-		matrices.push_back(index == qbit ? gate : identity);
+	// the sums over the register's states factor into the sums over each group's states
+	std::array<std::complex<double>, 2> sums = get_bit_sums(group_state_vectors[group].data(), group_state_vectors[group].size(), bit);
+	for (size_t other_group = 0; other_group < group_state_vectors.size(); ++other_group) {
+		if (other_group != group && !group_state_vectors[other_group].empty()) {
+			std::array<std::complex<double>, 2> const other_sums =
+				get_bit_sums(group_state_vectors[other_group].data(), group_state_vectors[other_group].size(), 0);
+			sums[0] *= other_sums[0] + other_sums[1];
+			sums[1] *= other_sums[0] + other_sums[1];
+		}
 	}
+	return { std::sqrt(sums[0]), std::sqrt(sums[1]) };
+}
 
-	matrix<std::complex<double>> mat = matrices[NUM_QBITS - 1];
-	for (int index = (NUM_QBITS - 2); index >= 0; --index) {
-		mat = tensor_product(matrices[index], mat);
+std::array<std::complex<double>, 2> QSim::get_qbit_state(uint16_t qbit) const
+{
+	if (active_representation == Representation::STABILIZER) {
+		// the qbit's value is certain unless a stabilizer anticommutes with Z on it, when both values are equally likely
+		double const z_expectation = tableau.get_z_expectation(qbit);
+		return { std::sqrt((1.0 + z_expectation) / 2.0), std::sqrt((1.0 - z_expectation) / 2.0) };
+	}
+	if (active_representation == Representation::FACTORED) {
+		if (precision == Precision::SINGLE) {
+			return get_factored_bit_state(single_group_state_vectors, entanglements.find_root(qbit), qbit_bit(qbit));
+		}
+		return get_factored_bit_state(group_state_vectors, entanglements.find_root(qbit), qbit_bit(qbit));
+	}
+	if (precision == Precision::SINGLE) {
+		return get_bit_state(get_state<float>(), num_states(), qbit_bit(qbit));
 	}
+	return get_bit_state(get_state<double>(), num_states(), qbit_bit(qbit));
+}
+
+// a Pauli string as coefficient * i^phase * X^x_mask * Z^z_mask, with the masks over state index bits
+struct Pauli_String
+{
+	uint64_t x_mask;
+	uint64_t z_mask;
+	uint8_t phase;
+	double coefficient;
+};
 
-	state_vector = vec_mat_mul(state_vector, mat);
+// Multiplies a string with the given X and Z bits and phase on the right by a Pauli operator on the bit of the mask.
+static void multiply_pauli(uint64_t &x_word, uint64_t &z_word, uint8_t &phase, Pauli pauli, uint64_t mask)
+{
+	// Y = iXZ, and moving the new X left past the Z already on its bit negates the string
+	uint64_t const x_mask = pauli == Pauli::Z ? 0 : mask;
+	uint64_t const z_mask = pauli == Pauli::X ? 0 : mask;
+	phase += (pauli == Pauli::Y ? 1 : 0) + ((z_word & x_mask) ? 2 : 0);
+	x_word ^= x_mask;
+	z_word ^= z_mask;
 }
 
-void QSim::perform_cnot_gate(uint8_t control_qbit, uint8_t target_qbit)
+static void multiply_pauli_string(Pauli_String &string, Pauli pauli, uint64_t mask)
 {
-	// Sources
-	// https://quantumcomputing.stackexchange.com/questions/4252/how-to-derive-the-cnot-matrix-for-a-3-qubit-system-where-the-control-target-qu
-	// https://quantumcomputing.stackexchange.com/questions/9614/how-to-interpret-a-4-qubit-quantum-circuit-as-a-matrix
+	multiply_pauli(string.x_mask, string.z_mask, string.phase, pauli, mask);
+}
 
-	uint8_t const high_qbit = std::max(control_qbit, target_qbit);
-	uint8_t const low_qbit = std::min(control_qbit, target_qbit);
-	uint8_t const num_uninvolved = high_qbit - low_qbit - 1;
+// Adds the sum over states s in [begin, end) of conj(state[s ^ x_mask]) * state[s] * (-1)^|s & z_mask| to sums[i] for
+// each of the strings, which all share x_mask.
+template <typename Real>
+static void accumulate_pauli_strings(std::complex<Real> const *state, uint64_t x_mask, Pauli_String const *strings,
+                                     size_t num_strings, uint64_t begin, uint64_t end, std::complex<double> *sums)
+{
+	for (uint64_t index = begin; index < end; ++index) {
+		std::complex<double> const product = std::conj(std::complex<double>(state[index ^ x_mask])) * std::complex<double>(state[index]);
+		for (size_t string = 0; string < num_strings; ++string) {
+			bool const is_negated = std::bitset<64>(index & strings[string].z_mask).count() & 1;
+			sums[string] += is_negated ? -product : product;
+		}
+	}
+}
 
-	matrix<std::complex<double>> lhs, rhs;
-	if (control_qbit < target_qbit) {
-		lhs = identity;
-		rhs = pauli_x;
-		for (uint8_t i = 0; i < num_uninvolved; ++i) {
-			lhs = tensor_product(identity, lhs);
-			rhs = tensor_product(identity, rhs);
+double QSim::compute_expectation(Observable const &observable)
+{
+	if (active_representation == Representation::STABILIZER) {
+		return compute_stabilizer_expectation(observable);
+	}
+	if (active_representation == Representation::FACTORED) {
+		if (precision == Precision::SINGLE) {
+			return compute_factored_expectation<float>(observable);
+		}
+		return compute_factored_expectation<double>(observable);
+	}
+
+	std::vector<Pauli_String> strings;
+	strings.reserve(observable.size());
+	for (auto const &term : observable) {
+		Pauli_String string = { 0, 0, 0, term.coefficient };
+		bool const is_in_register = std::all_of(term.factors.begin(), term.factors.end(),
+		                                        [this](Pauli_Factor const &factor) { return factor.qbit < num_qbits; });
+		if (!is_in_register) {
+			continue;
+		}
+		for (auto const &factor : term.factors) {
+			multiply_pauli_string(string, factor.pauli, (uint64_t)1 << qbit_bit(factor.qbit));
 		}
-		lhs = tensor_product(zero_projector, lhs);
-		rhs = tensor_product(one_projector, rhs);
+		strings.push_back(string);
+	}
+	std::sort(strings.begin(), strings.end(), [](Pauli_String const &lhs, Pauli_String const &rhs) { return lhs.x_mask < rhs.x_mask; });
+
+	// each pass is split into one chunk per thread with its own partial sums, so the total doesn't race
+	size_t const num_chunks = num_states() < min_parallel_states ? 1 : thread_pool.get_num_threads();
+	std::vector<std::complex<double>> sums;
+	double expectation = 0.0;
+	for (auto group_begin = strings.begin(); group_begin != strings.end();) {
+		uint64_t const x_mask = group_begin->x_mask;
+		auto const group_end = std::find_if(group_begin, strings.end(), [x_mask](Pauli_String const &string) { return string.x_mask != x_mask; });
+		Pauli_String const *group_strings = &*group_begin;
+		size_t const num_group_strings = group_end - group_begin;
+
+		sums.assign(num_chunks * num_group_strings, 0.0);
+		for_each_range(num_states(), num_chunks, [&](uint64_t begin, uint64_t end) {
+			for (uint64_t chunk = begin; chunk < end; ++chunk) {
+				uint64_t const chunk_begin = (num_states() * chunk) / num_chunks;
+				uint64_t const chunk_end = (num_states() * (chunk + 1)) / num_chunks;
+				std::complex<double> *chunk_sums = &sums[chunk * num_group_strings];
+				if (precision == Precision::SINGLE) {
+					accumulate_pauli_strings(get_state<float>(), x_mask, group_strings, num_group_strings, chunk_begin, chunk_end, chunk_sums);
+				} else {
+					accumulate_pauli_strings(get_state<double>(), x_mask, group_strings, num_group_strings, chunk_begin, chunk_end, chunk_sums);
+				}
+			}
+		});
+
+		for (size_t string = 0; string < num_group_strings; ++string) {
+			std::complex<double> sum = 0.0;
+			for (size_t chunk = 0; chunk < num_chunks; ++chunk) {
+				sum += sums[(chunk * num_group_strings) + string];
+			}
+			// multiply by i^phase and keep the real part
+			expectation += group_strings[string].coefficient * (pauli_phases[group_strings[string].phase & 3] * sum).real();
+		}
+		group_begin = group_end;
+	}
+	return expectation;
+}
+
+template <typename Real>
+double QSim::compute_factored_expectation(Observable const &observable)
+{
+	// The state is the product of the groups' states, so a term's expectation is the product over the groups it acts on
+	// of the expectation of its factors on that group. Factors on different groups commute, so the phases just add.
+	std::vector<std::vector<std::complex<Real>>> const &group_states = get_group_state_vectors<Real>();
+	std::vector<Pauli_String> group_strings(group_states.size());
+	double expectation = 0.0;
+	for (auto const &term : observable) {
+		bool const is_in_register = std::all_of(term.factors.begin(), term.factors.end(),
+		                                        [this](Pauli_Factor const &factor) { return factor.qbit < num_qbits; });
+		if (!is_in_register) {
+			continue;
+		}
+		std::fill(group_strings.begin(), group_strings.end(), Pauli_String { 0, 0, 0, 1.0 });
+		for (auto const &factor : term.factors) {
+			multiply_pauli_string(group_strings[entanglements.find_root(factor.qbit)], factor.pauli, (uint64_t)1 << qbit_bit(factor.qbit));
+		}
+
+		std::complex<double> product = 1.0;
+		for (size_t group = 0; group < group_strings.size(); ++group) {
+			Pauli_String const &string = group_strings[group];
+			product *= pauli_phases[string.phase & 3];
+			if (string.x_mask != 0 || string.z_mask != 0) {
+				std::complex<double> sum = 0.0;
+				accumulate_pauli_strings(group_states[group].data(), string.x_mask, &string, 1, 0, group_states[group].size(), &sum);
+				product *= sum;
+			}
+		}
+		expectation += term.coefficient * product.real();
+	}
+	return expectation;
+}
+
+double QSim::compute_stabilizer_expectation(Observable const &observable) const
+{
+	// The strings are built over qbits, as tableau rows are, rather than over state index bits. X^x * Z^z is -i * Y on
+	// each qbit in both, so each term is a power of i times a Hermitian string with an expectation of -1, 0 or 1.
+	size_t const num_words = (num_qbits + 63) / 64;
+	std::vector<uint64_t> x_words(num_words);
+	std::vector<uint64_t> z_words(num_words);
+	double expectation = 0.0;
+	for (auto const &term : observable) {
+		bool const is_in_register = std::all_of(term.factors.begin(), term.factors.end(),
+		                                        [this](Pauli_Factor const &factor) { return factor.qbit < num_qbits; });
+		if (!is_in_register) {
+			continue;
+		}
+		std::fill(x_words.begin(), x_words.end(), 0);
+		std::fill(z_words.begin(), z_words.end(), 0);
+		uint8_t phase = 0;
+		for (auto const &factor : term.factors) {
+			size_t const word = factor.qbit / 64;
+			multiply_pauli(x_words[word], z_words[word], phase, factor.pauli, (uint64_t)1 << (factor.qbit % 64));
+		}
+		for (size_t word = 0; word < num_words; ++word) {
+			phase -= (uint8_t)std::bitset<64>(x_words[word] & z_words[word]).count();
+		}
+		int const sign = tableau.get_expectation(x_words.data(), z_words.data());
+		expectation += term.coefficient * (pauli_phases[phase & 3] * (double)sign).real();
+	}
+	return expectation;
+}
+
+uint64_t QSim::num_states() const
+{
+	return (uint64_t)1 << num_qbits;
+}
+
+uint64_t QSim::qbit_bit(uint16_t qbit) const
+{
+	// qbit 0 is the most significant bit of the state index, and the first qbit of a group the most significant bit of
+	// the group's index
+	if (active_representation == Representation::FACTORED) {
+		return group_bits[qbit];
+	}
+	return num_qbits - 1 - qbit;
+}
+
+void QSim::rebuild_group_qbits()
+{
+	group_qbits.resize(num_qbits);
+	for (auto &qbits : group_qbits) {
+		qbits.clear();
+	}
+	for (uint16_t qbit = 0; qbit < num_qbits; ++qbit) {
+		group_qbits[entanglements.find_root(qbit)].push_back(qbit);
+	}
+	group_bits.resize(num_qbits);
+	for (auto const &qbits : group_qbits) {
+		for (size_t position = 0; position < qbits.size(); ++position) {
+			group_bits[qbits[position]] = (uint16_t)(qbits.size() - 1 - position);
+		}
+	}
+}
+
+template <typename Real>
+std::complex<Real> *QSim::get_state()
+{
+	return const_cast<std::complex<Real> *>(std::as_const(*this).get_state<Real>());
+}
+
+template <typename Real>
+std::complex<Real> const *QSim::get_state() const
+{
+	if (state_file.is_open()) {
+		return reinterpret_cast<std::complex<Real> const *>(state_file.get_data() + state_file_header_size);
+	}
+	if constexpr (std::is_same_v<Real, float>) {
+		return single_state_vector.data();
+	} else {
+		return state_vector.data();
+	}
+}
+
+template <typename Real>
+std::vector<std::vector<std::complex<Real>>> &QSim::get_group_state_vectors()
+{
+	if constexpr (std::is_same_v<Real, float>) {
+		return single_group_state_vectors;
 	} else {
-		lhs = zero_projector;
-		rhs = one_projector;
-		for (uint8_t i = 0; i < num_uninvolved; ++i) {
-			lhs = tensor_product(identity, lhs);
-			rhs = tensor_product(identity, rhs);
+		return group_state_vectors;
+	}
+}
+
+template <typename Real>
+std::vector<std::complex<Real>> &QSim::get_merged_group_state()
+{
+	if constexpr (std::is_same_v<Real, float>) {
+		return single_merged_group_state;
+	} else {
+		return merged_group_state;
+	}
+}
+
+template <typename Real>
+QSim::State_Span<Real> QSim::get_state_span(uint16_t const *qbits, size_t num_span_qbits)
+{
+	if (active_representation == Representation::FULL) {
+		return { get_state<Real>(), num_states() };
+	}
+	std::vector<std::complex<Real>> &group_state = get_group_state_vectors<Real>()[merge_qbit_groups<Real>(qbits, num_span_qbits)];
+	return { group_state.data(), group_state.size() };
+}
+
+template <typename Real>
+size_t QSim::merge_qbit_groups(uint16_t const *qbits, size_t num_merged_qbits)
+{
+	// each other group holding one of the qbits is merged into the first by the tensor product of their states
+	std::vector<std::vector<std::complex<Real>>> &group_states = get_group_state_vectors<Real>();
+	uint16_t root = entanglements.find_root(qbits[0]);
+	for (size_t qbit_index = 1; qbit_index < num_merged_qbits; ++qbit_index) {
+		uint16_t const other_root = entanglements.find_root(qbits[qbit_index]);
+		if (other_root == root) {
+			continue;
+		}
+
+		// the merged group is built in buffers kept from earlier merges, and copied into the vectors of its root, so a
+		// program run again after a reset merges without allocating
+		std::vector<uint16_t> &merged_qbits = merged_group_qbits;
+		merged_qbits.clear();
+		std::merge(group_qbits[root].begin(), group_qbits[root].end(), group_qbits[other_root].begin(),
+		           group_qbits[other_root].end(), std::back_inserter(merged_qbits));
+		for (size_t position = 0; position < merged_qbits.size(); ++position) {
+			group_bits[merged_qbits[position]] = (uint16_t)(merged_qbits.size() - 1 - position);
+		}
+
+		// the bits of each group's index are gathered from the merged index, most significant first
+		auto const gather_index = [this](uint64_t index, std::vector<uint16_t> const &source_qbits) {
+			uint64_t group_index = 0;
+			for (uint16_t qbit : source_qbits) {
+				group_index = (group_index << 1) | ((index >> group_bits[qbit]) & 1);
+			}
+			return group_index;
+		};
+		std::vector<std::complex<Real>> &merged_state = get_merged_group_state<Real>();
+		merged_state.resize((uint64_t)1 << merged_qbits.size());
+		for (uint64_t index = 0; index < merged_state.size(); ++index) {
+			merged_state[index] = group_states[root][gather_index(index, group_qbits[root])] *
+			                      group_states[other_root][gather_index(index, group_qbits[other_root])];
 		}
-		lhs = tensor_product(identity, lhs);
-		rhs = tensor_product(pauli_x, rhs);
+
+		uint16_t const merged_root = entanglements.merge(root, other_root);
+		uint16_t const emptied_root = merged_root == root ? other_root : root;
+		group_states[merged_root].assign(merged_state.begin(), merged_state.end());
+		group_qbits[merged_root].assign(merged_qbits.begin(), merged_qbits.end());
+		group_states[emptied_root].clear();
+		group_qbits[emptied_root].clear();
+		root = merged_root;
 	}
-	matrix<std::complex<double>> const cnot = mat_mat_add(lhs, rhs);
+	return root;
+}
 
-	matrix<std::complex<double>> mat;
-	if (high_qbit == (NUM_QBITS - 1)) {
-		mat = cnot;
+template <typename Real>
+Gate_Kernels<Real> const &QSim::get_kernels() const
+{
+	if constexpr (std::is_same_v<Real, float>) {
+		return *single_gate_kernels;
 	} else {
-		mat = identity;
-		for (uint8_t i = (NUM_QBITS - 2); i > high_qbit; --i) {
-			mat = tensor_product(mat, identity);
+		return *gate_kernels;
+	}
+}
+
+template <typename Function>
+void QSim::for_each_range(uint64_t num_span_states, uint64_t count, Function const &function)
+{
+	if (num_span_states < min_parallel_states) {
+		function(0, count);
+	} else if (is_state_mapped() && count > mapped_block_size) {
+		// Rather than each thread sweeping its own part of the file, the threads take blocks in turn, so together they
+		// move through the file as one front and the pages in use stay few and close together. A block covers a
+		// contiguous run of amplitudes for a gate on low bits, and one run in each half of the state for a gate on
+		// a high bit, which are both read in order.
+		uint64_t const num_blocks = (count + mapped_block_size - 1) / mapped_block_size;
+		uint64_t const num_threads = thread_pool.get_num_threads();
+		thread_pool.parallel_for(num_threads, [&](uint64_t begin, uint64_t end) {
+			for (uint64_t thread = begin; thread < end; ++thread) {
+				for (uint64_t block = thread; block < num_blocks; block += num_threads) {
+					function(block * mapped_block_size, std::min((block + 1) * mapped_block_size, count));
+				}
+			}
+		});
+	} else {
+		thread_pool.parallel_for(count, function);
+	}
+}
+
+template <typename Real>
+void QSim::perform_operation(Operation const &operation)
+{
+	apply_operation<Real>(operation);
+	update_entanglements(operation.operands.data(), get_num_operands(operation.gate));
+}
+
+template <typename Real>
+void QSim::apply_operation(Operation const &operation)
+{
+	Fixed_Gate const fixed_gate = get_fixed_gate(operation.gate);
+	if (fixed_gate != Fixed_Gate::NONE) {
+		perform_fixed_gate<Real>(fixed_gate, operation.operands[0]);
+		return;
+	}
+
+	std::optional<std::array<std::complex<double>, 2>> const diagonal_phases = get_diagonal_phases(operation);
+	if (diagonal_phases) {
+		perform_diagonal_gate<Real>(*diagonal_phases, operation.operands[0]);
+		return;
+	}
+
+	switch (operation.gate) {
+		case Gate::CNOT: {
+			perform_cnot_gate<Real>(operation.operands[0], operation.operands[1]);
+		} break;
+		case Gate::SWAP: {
+			perform_swap_gate<Real>(operation.operands[0], operation.operands[1]);
+		} break;
+		case Gate::TOFFOLI: {
+			perform_toffoli_gate<Real>(operation.operands[0], operation.operands[1], operation.operands[2]);
+		} break;
+		default: {
+			perform_quantum_gate<Real>(get_gate_matrix(operation), operation.operands[0]);
+		} break;
+	}
+}
+
+template <typename Real>
+void QSim::perform_fused_operation(Fused_Operation const &fused_operation)
+{
+	switch (fused_operation.kind) {
+		case Fused_Kind::GATE: {
+			apply_operation<Real>(fused_operation.operation);
+		} break;
+		case Fused_Kind::MATRIX: {
+			// the matrix is loaded into a fixed size type so the kernel is specialised for the number of qbits
+			static_assert(MAX_FUSED_QBITS <= 4, "dense blocks wider than 4 qbits need a kernel specialisation");
+			std::complex<double> const *elements = fused_operation.elements.data();
+			switch (fused_operation.qbits.size()) {
+				case 1: perform_quantum_gate<Real>(Gate_Matrix<1>::from_elements(elements), fused_operation.qbits[0]); break;
+				case 2: perform_dense_gate<Real>(Gate_Matrix<2>::from_elements(elements), fused_operation.qbits); break;
+				case 3: perform_dense_gate<Real>(Gate_Matrix<3>::from_elements(elements), fused_operation.qbits); break;
+				case 4: perform_dense_gate<Real>(Gate_Matrix<4>::from_elements(elements), fused_operation.qbits); break;
+			}
+		} break;
+		case Fused_Kind::DIAGONAL: {
+			perform_diagonal_table<Real>(fused_operation.elements, fused_operation.qbits);
+		} break;
+	}
+	for (auto const &entangled_qbits : fused_operation.entangled_qbits) {
+		update_entanglements(entangled_qbits.data(), entangled_qbits.size());
+	}
+}
+
+template <typename Real>
+void QSim::perform_gate_pass(Gate_Pass const &pass)
+{
+	if (!pass.is_blocked) {
+		perform_fused_operation<Real>(pass.operations[0]);
+		return;
+	}
+
+	// each block is small enough to stay in cache while every operation of the pass is applied to it
+	std::complex<Real> *state = get_state<Real>();
+	Gate_Kernels<Real> const &kernels = get_kernels<Real>();
+	uint64_t const num_block_states = (uint64_t)1 << cache_block_qbits;
+	for_each_range(num_states(), num_states() >> cache_block_qbits, [&](uint64_t begin, uint64_t end) {
+		for (uint64_t block = begin; block < end; ++block) {
+			uint64_t const first_index = block << cache_block_qbits;
+			for (auto const &operation : pass.operations) {
+				apply_block_operation(kernels, operation, num_qbits, state + first_index, first_index, num_block_states);
+			}
+		}
+	});
+	for (auto const &operation : pass.operations) {
+		for (auto const &entangled_qbits : operation.entangled_qbits) {
+			update_entanglements(entangled_qbits.data(), entangled_qbits.size());
 		}
-		mat = tensor_product(cnot, mat);
 	}
+}
+
+template <typename Real>
+void QSim::perform_quantum_gate(Gate_Matrix<1> const &gate, uint16_t qbit)
+{
+	// apply the gate directly to each pair of states that differ only in the target qbit
+	State_Span<Real> const span = get_state_span<Real>(&qbit, 1);
+	uint64_t const bit = qbit_bit(qbit);
+	std::complex<Real> *state = span.state;
+	for_each_range(span.num_states, span.num_states >> 1, [&](uint64_t begin, uint64_t end) {
+		get_kernels<Real>().apply_matrix(state, bit, gate, begin, end);
+	});
+}
+
+template <typename Real>
+void QSim::perform_fixed_gate(Fixed_Gate fixed_gate, uint16_t qbit)
+{
+	State_Span<Real> const span = get_state_span<Real>(&qbit, 1);
+	uint64_t const bit = qbit_bit(qbit);
+	std::complex<Real> *state = span.state;
+	auto const apply_fixed = get_kernels<Real>().apply_fixed[(size_t)fixed_gate];
+	for_each_range(span.num_states, span.num_states >> 1, [&](uint64_t begin, uint64_t end) {
+		apply_fixed(state, bit, begin, end);
+	});
+}
 
-	for (int i = low_qbit - 1; i >= 0; --i) {
-		mat = tensor_product(identity, mat);
+template <typename Real, size_t Num_Qbits>
+void QSim::perform_dense_gate(Gate_Matrix<Num_Qbits> const &gate, std::vector<uint16_t> const &qbits)
+{
+	// Each group of states that differ only in the given qbits is gathered, multiplied by the matrix and scattered back.
+	// The first qbit is the most significant bit of the matrix row and column indices.
+	State_Span<Real> const span = get_state_span<Real>(qbits.data(), qbits.size());
+	std::array<uint64_t, Num_Qbits> bits;
+	for (size_t index = 0; index < Num_Qbits; ++index) {
+		bits[index] = qbit_bit(qbits[index]);
 	}
+	std::complex<Real> *state = span.state;
+	for_each_range(span.num_states, span.num_states >> Num_Qbits, [&](uint64_t begin, uint64_t end) {
+		apply_dense_range(state, gate, bits, begin, end);
+	});
+}
 
-	state_vector = vec_mat_mul(state_vector, mat);
+template <typename Real>
+void QSim::perform_diagonal_gate(std::array<std::complex<double>, 2> const &phases, uint16_t qbit)
+{
+	if (phases[0] == 1.0 && phases[1] == 1.0) {
+		return;
+	}
 
-	update_entanglements({control_qbit, target_qbit});
+	State_Span<Real> const span = get_state_span<Real>(&qbit, 1);
+	uint64_t const bit = qbit_bit(qbit);
+	std::complex<Real> *state = span.state;
+	for_each_range(span.num_states, span.num_states >> 1, [&](uint64_t begin, uint64_t end) {
+		get_kernels<Real>().apply_diagonal(state, bit, phases[0], phases[1], begin, end);
+	});
 }
 
-void QSim::generate_results(int num_runs)
+template <typename Real>
+void QSim::perform_diagonal_table(std::vector<std::complex<double>> const &phases, std::vector<uint16_t> const &qbits)
 {
-	struct Result_Range {
-		double start, end;
-		uint8_t state;
-		uint32_t count;
-	};
+	// the first qbit is the most significant bit of the phase table index
+	size_t const num_table_bits = qbits.size();
+	State_Span<Real> const span = get_state_span<Real>(qbits.data(), qbits.size());
+	std::array<uint64_t, MAX_FUSED_DIAGONAL_QBITS> bits;
+	for (size_t index = 0; index < num_table_bits; ++index) {
+		bits[index] = qbit_bit(qbits[num_table_bits - 1 - index]);
+	}
 
-	std::vector<Result_Range> ranges;
-	double last_end = 0.0;
-	for (size_t index = 0; index < state_vector.size(); ++index) {
-		ranges.push_back({ last_end, last_end + std::abs(std::pow(state_vector[index], 2)), (uint8_t)index, 0 });
-		last_end = ranges.back().end;
+	std::complex<Real> *state = span.state;
+	for_each_range(span.num_states, span.num_states, [&](uint64_t begin, uint64_t end) {
+		apply_diagonal_table_range(state, 0, bits.data(), num_table_bits, phases.data(), begin, end);
+	});
+}
+
+template <typename Real>
+void QSim::perform_cnot_gate(uint16_t control_qbit, uint16_t target_qbit)
+{
+	// flip the target bit of every state with the control bit set, which is a pure permutation of amplitudes
+	uint16_t const entangled_qbits[] = { control_qbit, target_qbit };
+	State_Span<Real> const span = get_state_span<Real>(entangled_qbits, 2);
+	uint64_t const control_bit = qbit_bit(control_qbit);
+	uint64_t const target_bit = qbit_bit(target_qbit);
+	std::complex<Real> *state = span.state;
+	for_each_range(span.num_states, span.num_states >> 2, [&](uint64_t begin, uint64_t end) {
+		apply_cnot_range(state, control_bit, target_bit, begin, end);
+	});
+}
+
+template <typename Real>
+void QSim::perform_swap_gate(uint16_t first_qbit, uint16_t second_qbit)
+{
+	// exchange the amplitudes of every pair of states where the two qbits differ
+	uint16_t const entangled_qbits[] = { first_qbit, second_qbit };
+	State_Span<Real> const span = get_state_span<Real>(entangled_qbits, 2);
+	uint64_t const first_bit = qbit_bit(first_qbit);
+	uint64_t const second_bit = qbit_bit(second_qbit);
+	std::complex<Real> *state = span.state;
+	for_each_range(span.num_states, span.num_states >> 2, [&](uint64_t begin, uint64_t end) {
+		apply_swap_range(state, first_bit, second_bit, begin, end);
+	});
+}
+
+template <typename Real>
+void QSim::perform_toffoli_gate(uint16_t first_control_qbit, uint16_t second_control_qbit, uint16_t target_qbit)
+{
+	// flip the target bit of every state with both control bits set
+	uint16_t const entangled_qbits[] = { first_control_qbit, second_control_qbit, target_qbit };
+	State_Span<Real> const span = get_state_span<Real>(entangled_qbits, 3);
+	std::array<uint64_t, 3> const bits = { qbit_bit(first_control_qbit), qbit_bit(second_control_qbit), qbit_bit(target_qbit) };
+	std::complex<Real> *state = span.state;
+	for_each_range(span.num_states, span.num_states >> 3, [&](uint64_t begin, uint64_t end) {
+		apply_toffoli_range(state, bits, begin, end);
+	});
+}
+
+void QSim::perform_tableau_operation(Operation const &operation)
+{
+	switch (operation.gate) {
+		case Gate::CNOT: {
+			tableau.apply_cnot(operation.operands[0], operation.operands[1]);
+			update_entanglements(operation.operands.data(), 2);
+		} break;
+		case Gate::HADAMARD: {
+			tableau.apply_hadamard(operation.operands[0]);
+		} break;
+		case Gate::PAULI_X: {
+			tableau.apply_pauli_x(operation.operands[0]);
+		} break;
+		case Gate::PAULI_Y: {
+			tableau.apply_pauli_y(operation.operands[0]);
+		} break;
+		case Gate::PAULI_Z: {
+			tableau.apply_pauli_z(operation.operands[0]);
+		} break;
+		case Gate::S: {
+			tableau.apply_phase(operation.operands[0]);
+		} break;
+		case Gate::S_DAG: {
+			tableau.apply_phase_dag(operation.operands[0]);
+		} break;
+		case Gate::SWAP: {
+			tableau.apply_swap(operation.operands[0], operation.operands[1]);
+			update_entanglements(operation.operands.data(), 2);
+		} break;
+		default: {
+			// the identity, as only programs of Clifford gates run on a tableau
+		} break;
 	}
+}
 
-	for (int i = 0; i < num_runs; ++i) {
-		double const random_number = random_distribution(rng);
-		auto selected_range = std::find_if(ranges.begin(), ranges.end(), [&](Result_Range const &range) {
-			return range.start <= random_number && random_number <= range.end;
-		});
-		selected_range->count += 1;
+uint64_t QSim::next_sampling_seed()
+{
+	// Shots are split into streams, each with its own generator seeded from the user's seed and the number of times
+	// results have been generated since, so results are reproducible for a given seed and number of threads.
+	uint64_t const sampling_seed = split_mix(seed ^ split_mix(num_samplings));
+	num_samplings += 1;
+	return sampling_seed;
+}
+
+// Takes one shot without building an alias table, as the first state whose cumulative probability passes a random
+// fraction of the total, so stepping to the end of a program needs no allocation. Returns nothing for a zero state.
+template <typename Real>
+static std::optional<uint64_t> sample_one_state(std::complex<Real> const *state, uint64_t num_states, uint64_t sampling_seed)
+{
+	// a segment is picked by its probability and then a state within it, as the alias tables do, with one scan of each
+	std::mt19937_64 rng(split_mix(sampling_seed));
+	std::uniform_real_distribution<double> random_distribution(0.0, 1.0);
+	double const segment_random_number = random_distribution(rng);
+	double const state_random_number = random_distribution(rng);
+	uint64_t const segment_size = get_segment_size(num_states);
+	std::optional<uint64_t> const segment = pick_by_cumulative_probability(num_states / segment_size, segment_random_number, [&](uint64_t segment) {
+		return get_total_probability(state + (segment * segment_size), segment_size);
+	});
+	if (!segment) {
+		return std::nullopt;
 	}
+	std::complex<Real> const *segment_state = state + (*segment * segment_size);
+	std::optional<uint64_t> const index = pick_by_cumulative_probability(segment_size, state_random_number, [&](uint64_t index) {
+		return std::norm(std::complex<double>(segment_state[index]));
+	});
+	return (*segment * segment_size) + index.value_or(0);
+}
 
+void QSim::generate_results(int num_runs)
+{
 	results.clear();
-	for (auto const &range : ranges) {
-		if (range.count > 0) {
-			results.push_back({ range.state, range.count });
+	wide_results.clear();
+	if (active_representation == Representation::STABILIZER) {
+		generate_stabilizer_results(num_runs);
+		return;
+	}
+	if (active_representation == Representation::FACTORED) {
+		if (precision == Precision::SINGLE) {
+			generate_factored_results<float>(num_runs);
+		} else {
+			generate_factored_results<double>(num_runs);
+		}
+		return;
+	}
+
+	if (num_runs == 1) {
+		std::optional<uint64_t> const state = precision == Precision::SINGLE ?
+		                                      sample_one_state(get_state<float>(), num_states(), next_sampling_seed()) :
+		                                      sample_one_state(get_state<double>(), num_states(), next_sampling_seed());
+		if (state) {
+			results.push_back({ *state, 1 });
+		}
+		return;
+	}
+
+	if (precision == Precision::SINGLE) {
+		alias_table.build(get_state<float>(), num_states());
+	} else {
+		alias_table.build(get_state<double>(), num_states());
+	}
+	if (alias_table.size() == 0) {
+		return;
+	}
+
+	size_t const max_streams = std::max(max_histogram_entries / alias_table.size(), (size_t)1);
+	size_t const num_streams = num_runs < min_parallel_runs ? 1 : std::min(thread_pool.get_num_threads(), max_streams);
+	uint64_t const sampling_seed = next_sampling_seed();
+
+	stream_counts.resize(num_streams);
+	thread_pool.parallel_for(num_streams, [&](uint64_t begin, uint64_t end) {
+		for (uint64_t stream = begin; stream < end; ++stream) {
+			std::mt19937_64 stream_rng(split_mix(sampling_seed + stream));
+			std::uniform_real_distribution<double> random_distribution(0.0, 1.0);
+			std::vector<uint32_t> &counts = stream_counts[stream];
+			counts.assign(alias_table.size(), 0);
+
+			uint64_t const num_stream_runs = (((uint64_t)num_runs * (stream + 1)) / num_streams) - (((uint64_t)num_runs * stream) / num_streams);
+			for (uint64_t run = 0; run < num_stream_runs; ++run) {
+				counts[alias_table.sample(random_distribution(stream_rng))] += 1;
+			}
+		}
+	});
+
+	for (size_t stream = 1; stream < num_streams; ++stream) {
+		for (size_t entry = 0; entry < alias_table.size(); ++entry) {
+			stream_counts[0][entry] += stream_counts[stream][entry];
+		}
+	}
+
+	for (size_t entry = 0; entry < alias_table.size(); ++entry) {
+		if (stream_counts[0][entry] > 0) {
+			results.push_back({ alias_table.get_state(entry), stream_counts[0][entry] });
 		}
 	}
 }
 
-void QSim::update_entanglements(std::vector<uint8_t> const &newly_entangled)
+template <typename Real>
+void QSim::generate_factored_results(int num_runs)
 {
-	auto has_overlap = [&](std::vector<uint8_t> const &group) {
-                        	for (uint8_t qbit : newly_entangled) {
-                        		if (std::find(group.begin(), group.end(), qbit) != group.end()) {
-                        			return true;
-                        		}
-                        	}
-                        	return false;
-                        };
+	// each shot samples every group from its own alias table, as the groups are independent, and combines the bits
+	std::vector<std::vector<std::complex<Real>>> const &group_states = get_group_state_vectors<Real>();
+	if (num_runs == 1) {
+		// a single shot, as taken after the last step, draws each group with a scan rather than building its table
+		uint64_t const sampling_seed = next_sampling_seed();
+		uint64_t state = 0;
+		for (uint16_t root = 0; root < num_qbits; ++root) {
+			if (!entanglements.is_root(root)) {
+				continue;
+			}
+			std::optional<uint64_t> const group_state = sample_one_state(group_states[root].data(), group_states[root].size(), sampling_seed + root);
+			if (!group_state) {
+				return;
+			}
+			state |= scatter_group_index(*group_state, group_qbits[root], num_qbits);
+		}
+		results.push_back({ state, 1 });
+		return;
+	}
 
-	// find first overlapping qbit group
-	auto first_overlapping_group = std::find_if(qbit_groups.begin(), qbit_groups.end(), has_overlap);
+	group_alias_tables.resize(entanglements.get_num_groups());
+	group_entry_states.resize(entanglements.get_num_groups());
+	size_t group = 0;
+	for (uint16_t root = 0; root < num_qbits; ++root) {
+		if (!entanglements.is_root(root)) {
+			continue;
+		}
+		group_alias_tables[group].build(group_states[root].data(), group_states[root].size());
+		if (group_alias_tables[group].size() == 0) {
+			return;
+		}
+		group_entry_states[group].resize(group_alias_tables[group].size());
+		for (size_t entry = 0; entry < group_alias_tables[group].size(); ++entry) {
+			group_entry_states[group][entry] = scatter_group_index(group_alias_tables[group].get_state(entry), group_qbits[root], num_qbits);
+		}
+		group += 1;
+	}
 
-	// merge all other groups with overlap into the group
-	for (auto group_iterator = std::find_if(first_overlapping_group + 1, qbit_groups.end(), has_overlap);
-		group_iterator != qbit_groups.end();
-		group_iterator = std::find_if(group_iterator + 1, qbit_groups.end(), has_overlap)) {
-		for (uint8_t qbit : *group_iterator) {
-			first_overlapping_group->push_back(qbit);
+	size_t const num_streams = num_runs < min_parallel_runs ? 1 : thread_pool.get_num_threads();
+	uint64_t const sampling_seed = next_sampling_seed();
+
+	stream_state_counts.resize(num_streams);
+	thread_pool.parallel_for(num_streams, [&](uint64_t begin, uint64_t end) {
+		for (uint64_t stream = begin; stream < end; ++stream) {
+			std::mt19937_64 stream_rng(split_mix(sampling_seed + stream));
+			std::uniform_real_distribution<double> random_distribution(0.0, 1.0);
+			std::unordered_map<uint64_t, uint32_t> &counts = stream_state_counts[stream];
+			counts.clear();
+			uint64_t const num_stream_runs = (((uint64_t)num_runs * (stream + 1)) / num_streams) - (((uint64_t)num_runs * stream) / num_streams);
+			for (uint64_t run = 0; run < num_stream_runs; ++run) {
+				uint64_t state = 0;
+				for (size_t group = 0; group < group_alias_tables.size(); ++group) {
+					state |= group_entry_states[group][group_alias_tables[group].sample(random_distribution(stream_rng))];
+				}
+				counts[state] += 1;
+			}
 		}
-		group_iterator->clear();
+	});
+
+	merge_stream_state_counts(num_streams);
+}
+
+void QSim::generate_stabilizer_results(int num_runs)
+{
+	// Every state of the support is equally likely, so each shot applies a random subset of the generators' flips to
+	// the seed state, with one random word picking from each 64 of the generators.
+	Stabilizer_Support const support = tableau.get_support();
+	size_t const num_streams = num_runs < min_parallel_runs ? 1 : thread_pool.get_num_threads();
+	uint64_t const sampling_seed = next_sampling_seed();
+
+	stream_qbit_counts.resize(num_streams);
+	thread_pool.parallel_for(num_streams, [&](uint64_t begin, uint64_t end) {
+		for (uint64_t stream = begin; stream < end; ++stream) {
+			std::mt19937_64 stream_rng(split_mix(sampling_seed + stream));
+			std::unordered_map<std::vector<bool>, uint32_t> &counts = stream_qbit_counts[stream];
+			counts.clear();
+			std::vector<uint64_t> state_words;
+			std::vector<bool> qbits(num_qbits);
+			uint64_t const num_stream_runs = (((uint64_t)num_runs * (stream + 1)) / num_streams) - (((uint64_t)num_runs * stream) / num_streams);
+			for (uint64_t run = 0; run < num_stream_runs; ++run) {
+				state_words = support.seed_words;
+				uint64_t choices = 0;
+				for (size_t generator = 0; generator < support.generators.size(); ++generator) {
+					if (generator % 64 == 0) {
+						choices = stream_rng();
+					}
+					if ((choices >> (generator % 64)) & 1) {
+						for (size_t word = 0; word < state_words.size(); ++word) {
+							state_words[word] ^= support.generators[generator].flip_words[word];
+						}
+					}
+				}
+				for (size_t qbit = 0; qbit < num_qbits; ++qbit) {
+					qbits[qbit] = (state_words[qbit / 64] >> (qbit % 64)) & 1;
+				}
+				counts[qbits] += 1;
+			}
+		}
+	});
+
+	// the states are compared qbit 0 first, which puts them in order of state index
+	std::unordered_map<std::vector<bool>, uint32_t> &counts = stream_qbit_counts[0];
+	for (size_t stream = 1; stream < num_streams; ++stream) {
+		for (auto const &[qbits, num_times] : stream_qbit_counts[stream]) {
+			counts[qbits] += num_times;
+		}
+		stream_qbit_counts[stream].clear();
 	}
+	for (auto const &[qbits, num_times] : counts) {
+		wide_results.push_back({ qbits, num_times });
+	}
+	counts.clear();
+	std::sort(wide_results.begin(), wide_results.end(), [](Wide_Result const &lhs, Wide_Result const &rhs) { return lhs.qbits < rhs.qbits; });
 
-	// sort the qbit group to ensure elements are kept in ascending order
-	std::sort(first_overlapping_group->begin(), first_overlapping_group->end());
+	if (num_qbits <= 64) {
+		for (auto const &wide_result : wide_results) {
+			uint64_t state = 0;
+			for (size_t qbit = 0; qbit < num_qbits; ++qbit) {
+				state |= (uint64_t)wide_result.qbits[qbit] << (num_qbits - 1 - qbit);
+			}
+			results.push_back({ state, wide_result.num_times });
+		}
+	}
+}
+
+void QSim::merge_stream_state_counts(size_t num_streams)
+{
+	// the register can have far more states than there are shots, so each stream counts the states it drew by value,
+	// and the merged counts are put in order of state
+	std::unordered_map<uint64_t, uint32_t> &counts = stream_state_counts[0];
+	for (size_t stream = 1; stream < num_streams; ++stream) {
+		for (auto const &[state, num_times] : stream_state_counts[stream]) {
+			counts[state] += num_times;
+		}
+		stream_state_counts[stream].clear();
+	}
+	for (auto const &[state, num_times] : counts) {
+		results.push_back({ state, num_times });
+	}
+	counts.clear();
+	std::sort(results.begin(), results.end(), [](Result const &lhs, Result const &rhs) { return lhs.state < rhs.state; });
+}
 
-	// clear out empty groups
-	qbit_groups.erase(std::remove_if(qbit_groups.begin(), qbit_groups.end(), [](std::vector<uint8_t> const &group) { return group.empty(); }), qbit_groups.end());
+void QSim::update_entanglements(uint16_t const *newly_entangled, size_t num_newly_entangled)
+{
+	for (size_t qbit_index = 1; qbit_index < num_newly_entangled; ++qbit_index) {
+		entanglements.merge(newly_entangled[0], newly_entangled[qbit_index]);
+	}
 }
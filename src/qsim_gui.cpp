@@ -5,6 +5,7 @@
 
 #include "constants.h"
 #include "font.gen.h"
+#include "format.h"
 #include "imgui_internal.h"
 #include "implot.h"
 #include "platform.h"
@@ -12,16 +13,6 @@
 #include "qsim_gui.h"
 #include "version.h"
 
-static std::string to_binary_string(uint32_t state)
-{
-	char binary_string[NUM_QBITS + 1];
-	for (uint8_t shift = 0; shift < NUM_QBITS; ++shift) {
-		binary_string[shift] = (state & (1 << shift)) ? '1' : '0';
-	}
-	binary_string[NUM_QBITS] = '\0';
-	return std::string(binary_string);
-}
-
 static std::string to_complex_string(std::complex<double> number)
 {
 	return std::to_string(number.real()) + "+" + std::to_string(number.imag()) + "i";
@@ -144,7 +135,7 @@ void QSim_GUI::update_program_window()
 		static float const cnot_target_radius = cnot_control_radius * 2.0f;
 		static float const swap_x_size = box_size * 0.4f;
 
-		std::vector<uint8_t> const &active_qbits = program->get_active_qbits();
+		std::vector<uint16_t> const &active_qbits = program->get_active_qbits();
 		std::vector<Operation> const &operations = program->get_operations();
 		float const total_width = active_qbits.size() * column_width;
 		float const total_height = (operations.size() + 1) * row_height;
@@ -168,7 +159,7 @@ void QSim_GUI::update_program_window()
 			draw_list->AddLine(line_start, line_end, IM_COL32(140, 140, 140, 255), 3.0f);
 		}
 
-		auto draw_box_gate = [&](char const *gate, uint8_t qbit, size_t row_index) {
+		auto draw_box_gate = [&](char const *gate, uint16_t qbit, size_t row_index) {
 			size_t const column_index = std::find(active_qbits.begin(), active_qbits.end(), qbit) - active_qbits.begin();
 			ImVec2 const box_top_left {
 				origin.x + (column_index * column_width) + ((column_width - box_size) * 0.5f),
@@ -186,7 +177,7 @@ void QSim_GUI::update_program_window()
 			draw_list->AddText(label_pos, IM_COL32_BLACK, gate);
 		};
 
-		auto draw_cnot_gate = [&](uint8_t control_qbit, uint8_t target_qbit, size_t row_index) {
+		auto draw_cnot_gate = [&](uint16_t control_qbit, uint16_t target_qbit, size_t row_index) {
 			size_t const control_column_index = std::find(active_qbits.begin(), active_qbits.end(), control_qbit) - active_qbits.begin();
 			size_t const target_column_index = std::find(active_qbits.begin(), active_qbits.end(), target_qbit) - active_qbits.begin();
 			ImVec2 const line_start {
@@ -207,7 +198,7 @@ void QSim_GUI::update_program_window()
 			draw_list->AddText(label_pos, IM_COL32_BLACK, "+");
 		};
 
-		auto draw_swap_gate = [&](uint8_t first_qbit, uint8_t second_qbit, size_t row_index) {
+		auto draw_swap_gate = [&](uint16_t first_qbit, uint16_t second_qbit, size_t row_index) {
 			size_t const control_column_index = std::find(active_qbits.begin(), active_qbits.end(), first_qbit) - active_qbits.begin();
 			size_t const target_column_index = std::find(active_qbits.begin(), active_qbits.end(), second_qbit) - active_qbits.begin();
 			ImVec2 const line_start {
@@ -240,7 +231,7 @@ void QSim_GUI::update_program_window()
 				IM_COL32_WHITE, 2.0f);
 		};
 
-		auto draw_toffoli_gate = [&](uint8_t first_control_qbit, uint8_t second_control_qbit, uint8_t target_qbit, size_t row_index) {
+		auto draw_toffoli_gate = [&](uint16_t first_control_qbit, uint16_t second_control_qbit, uint16_t target_qbit, size_t row_index) {
 			size_t const first_control_column_index = std::find(active_qbits.begin(), active_qbits.end(), first_control_qbit) - active_qbits.begin();
 			size_t const second_control_column_index = std::find(active_qbits.begin(), active_qbits.end(), second_control_qbit) - active_qbits.begin();
 			size_t const target_column_index = std::find(active_qbits.begin(), active_qbits.end(), target_qbit) - active_qbits.begin();
@@ -354,14 +345,16 @@ void QSim_GUI::update_control_window()
 		handle_run();
 	}
 	ImGui::SameLine();
+	if (ImGui::Button("Step Back")) {
+		handle_step_back();
+	}
+	ImGui::SameLine();
 	if (ImGui::Button("Step")) {
 		handle_step();
 	}
 	ImGui::InputInt("Number of iterations", &num_runs);
 	if (num_runs < 1) {
 		num_runs = 1;
-	} else if (num_runs > 10000) {
-		num_runs = 10000;
 	}
 	ImGui::End();
 }
@@ -370,7 +363,7 @@ void QSim_GUI::update_state_window(std::vector<Amplitude> const &amplitudes)
 {
 	ImGui::Begin("State");
 	for (auto const &amplitude : amplitudes) {
-		std::string const state_name = "|" + to_binary_string(amplitude.state) + ">";
+		std::string const state_name = "|" + to_binary_string(amplitude.state, qsim->get_num_qbits()) + ">";
 		if (ImGui::TreeNode(state_name.c_str())) {
 			std::string const amplitude_string = "Amplitude: " + to_complex_string(amplitude.amplitude);
 			ImGui::TextUnformatted(amplitude_string.c_str());
@@ -400,7 +393,7 @@ void QSim_GUI::update_results_window()
 		for (size_t i = 0; i < num_results; ++i) {
 			data[i] = results[i].num_times;
 			positions[i] = (double)i;
-			column_label_strings.push_back("|" + to_binary_string(results[i].state) + ">");
+			column_label_strings.push_back("|" + to_binary_string(results[i].state, qsim->get_num_qbits()) + ">");
 		}
 
 		for (size_t i = 0; i < num_results; ++i) {
@@ -432,7 +425,7 @@ void QSim_GUI::update_probabilities_window(std::vector<Amplitude> const &amplitu
 	float *data = new float[amplitudes.size()];
 
 	for (size_t index = 0; index < amplitudes.size(); ++index) {
-		segment_label_strings.push_back("|" + to_binary_string(amplitudes[index].state) + ">");
+		segment_label_strings.push_back("|" + to_binary_string(amplitudes[index].state, qsim->get_num_qbits()) + ">");
 	}
 	for (size_t index = 0; index < amplitudes.size(); ++index) {
 		segment_labels[index] = segment_label_strings[index].c_str();
@@ -459,13 +452,17 @@ void QSim_GUI::update_waveform_window()
 	if (ImPlot::BeginPlot("Waveform", { -1, -1 }, ImPlotFlags_NoInputs)) {
 		ImPlot::SetupAxes(nullptr, nullptr, ImPlotAxisFlags_AutoFit, ImPlotAxisFlags_AutoFit);
 		ImPlot::SetupAxesLimits(samples_x[0], samples_x[samples_x.size() - 1], -2.0, 2.0);
-		std::vector<std::vector<uint8_t>> const &qbit_groups = qsim->get_qbit_groups();
-		for (size_t qbit_group_index = 0; qbit_group_index < qbit_groups.size(); ++qbit_group_index) {
-			std::string label = "q" + std::to_string(qbit_groups[qbit_group_index][0]);
-			for (size_t qbit_index = 1; qbit_index < qbit_groups[qbit_group_index].size(); ++qbit_index) {
-				label += "+q" + std::to_string(qbit_groups[qbit_group_index][qbit_index]);
+		// each group is labelled with its qbits in ascending order and plotted from the samples at its root
+		Entanglement_Tracker const &entanglements = qsim->get_entanglements();
+		std::vector<std::string> labels(qsim->get_num_qbits());
+		for (uint16_t qbit_index = 0; qbit_index < qsim->get_num_qbits(); ++qbit_index) {
+			std::string &label = labels[entanglements.find_root(qbit_index)];
+			label += (label.empty() ? "q" : "+q") + std::to_string(qbit_index);
+		}
+		for (uint16_t qbit_index = 0; qbit_index < qsim->get_num_qbits(); ++qbit_index) {
+			if (entanglements.is_root(qbit_index)) {
+				ImPlot::PlotLine(labels[qbit_index].c_str(), samples_x.data(), samples_y[qbit_index].data(), (int)num_samples);
 			}
-			ImPlot::PlotLine(label.c_str(), samples_x.data(), samples_y[qbit_group_index].data(), (int)num_samples);
 		}
 		ImPlot::EndPlot();
 	}
@@ -503,7 +500,7 @@ void QSim_GUI::update_menu_bar()
 			if (ImGui::MenuItem("Load Program", "Ctrl+O")) {
 				handle_load();
 			}
-			if (ImGui::MenuItem("Save Results", "Ctrl+S", false, !qsim->get_results().empty())) {
+			if (ImGui::MenuItem("Save Results", "Ctrl+S", false, !qsim->get_results().empty() || !qsim->get_wide_results().empty())) {
 				handle_save();
 			}
 			ImGui::Separator();
@@ -519,6 +516,9 @@ void QSim_GUI::update_menu_bar()
 			if (ImGui::MenuItem("Run", "F5")) {
 				handle_run();
 			}
+			if (ImGui::MenuItem("Step Back", "Backspace")) {
+				handle_step_back();
+			}
 			if (ImGui::MenuItem("Step", "Space")) {
 				handle_step();
 			}
@@ -571,7 +571,7 @@ void QSim_GUI::process_shortcuts()
 		} else if (ImGui::IsKeyPressed(ImGuiKey_Q)) {
 			handle_quit();
 		} else if (ImGui::IsKeyPressed(ImGuiKey_S)) {
-			if (!qsim->get_results().empty()) {
+			if (!qsim->get_results().empty() || !qsim->get_wide_results().empty()) {
 				handle_save();
 			}
 		}
@@ -580,6 +580,8 @@ void QSim_GUI::process_shortcuts()
 			handle_reset();
 		} else if (ImGui::IsKeyPressed(ImGuiKey_F5)) {
 			handle_run();
+		} else if (ImGui::IsKeyPressed(ImGuiKey_Backspace)) {
+			handle_step_back();
 		} else if (ImGui::IsKeyPressed(ImGuiKey_Space)) {
 			handle_step();
 		}
@@ -620,6 +622,14 @@ void QSim_GUI::handle_step()
 	update_waveform_samples();
 }
 
+void QSim_GUI::handle_step_back()
+{
+	if (qsim->get_next_gate_index() > 0) {
+		qsim->seek(qsim->get_next_gate_index() - 1);
+		update_waveform_samples();
+	}
+}
+
 void QSim_GUI::handle_quit()
 {
 	platform_quit();
@@ -663,10 +673,11 @@ void QSim_GUI::save_results_file(std::filesystem::path const &results_file)
 {
 	std::ofstream file_stream { results_file };
 	if (file_stream.is_open()) {
-		file_stream << "state,occurrences\n";
-		auto const &results = qsim->get_results();
-		for (auto const &result : results) {
-			file_stream << '|' << to_binary_string(result.state) << ">," << result.num_times << '\n';
+		// results on a tableau can be too wide for a state index
+		if (qsim->get_active_representation() == Representation::STABILIZER) {
+			write_results_csv(file_stream, qsim->get_wide_results());
+		} else {
+			write_results_csv(file_stream, qsim->get_results(), qsim->get_num_qbits());
 		}
 		print_to_console("Saved results to " + results_file.string());
 	} else {
@@ -683,20 +694,24 @@ void QSim_GUI::update_waveform_samples()
 {
 	static double const ket_zero_freq_mul = 1.0;
 	static double const ket_one_freq_mul = 2.0;
-	std::vector<std::vector<uint8_t>> const &qbit_groups = qsim->get_qbit_groups();
-	for (size_t qbit_group_index = 0; qbit_group_index < qbit_groups.size(); ++qbit_group_index) {
-		for (uint8_t qbit_index : qbit_groups[qbit_group_index]) {
-			std::array<std::complex<double>, 2> const qbit_state = qsim->get_qbit_state((uint8_t)qbit_index);
-			for (size_t sample_index = 0; sample_index < samples_y[qbit_index].size(); ++sample_index) {
+	Entanglement_Tracker const &entanglements = qsim->get_entanglements();
+	samples_y.resize(qsim->get_num_qbits());
+	for (uint16_t root = 0; root < qsim->get_num_qbits(); ++root) {
+		if (!entanglements.is_root(root)) {
+			continue;
+		}
+		entanglements.for_each_member(root, [&](uint16_t qbit_index) {
+			std::array<std::complex<double>, 2> const qbit_state = qsim->get_qbit_state(qbit_index);
+			for (size_t sample_index = 0; sample_index < samples_y[root].size(); ++sample_index) {
 				float const zero_amplitude = (float)(std::sin((samples_x[sample_index] + (qbit_state[0].imag() * CONST_TAU)) * ket_zero_freq_mul) * std::abs(qbit_state[0]));
 				float const one_amplitude = (float)(std::sin((samples_x[sample_index] + (qbit_state[1].imag() * CONST_TAU)) * ket_one_freq_mul) * std::abs(qbit_state[1]));
 				float const sample = zero_amplitude + one_amplitude;
-				if (qbit_index == qbit_groups[qbit_group_index][0]) {
-					samples_y[qbit_group_index][sample_index] = sample;
+				if (qbit_index == root) {
+					samples_y[root][sample_index] = sample;
 				} else {
-					samples_y[qbit_group_index][sample_index] += sample;
+					samples_y[root][sample_index] += sample;
 				}
 			}
-		}
+		});
 	}
 }
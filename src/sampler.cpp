@@ -0,0 +1,115 @@
+#include <algorithm>
+
+#include "sampler.h"
+
+void Alias_Table::fill_aliases(uint32_t first_column, uint32_t num_columns, double total_probability)
+{
+	// Vose's method: scale the probabilities so they average one, then repeatedly top up an under-full column with
+	// the excess of an over-full one, which becomes that column's alias.
+	small_entries.clear();
+	large_entries.clear();
+	for (uint32_t column = first_column; column < first_column + num_columns; ++column) {
+		thresholds[column] *= (double)num_columns / total_probability;
+		aliases[column] = column;
+		(thresholds[column] < 1.0 ? small_entries : large_entries).push_back(column);
+	}
+
+	while (!small_entries.empty() && !large_entries.empty()) {
+		uint32_t const small_entry = small_entries.back();
+		uint32_t const large_entry = large_entries.back();
+		small_entries.pop_back();
+		aliases[small_entry] = large_entry;
+		thresholds[large_entry] -= 1.0 - thresholds[small_entry];
+		if (thresholds[large_entry] < 1.0) {
+			large_entries.pop_back();
+			small_entries.push_back(large_entry);
+		}
+	}
+
+	// anything left over is only short of one through rounding error
+	for (uint32_t entry : small_entries) {
+		thresholds[entry] = 1.0;
+	}
+	for (uint32_t entry : large_entries) {
+		thresholds[entry] = 1.0;
+	}
+}
+
+void Alias_Table::build_segments(double const *probabilities, uint64_t num_segments)
+{
+	segment_probabilities.assign(probabilities, probabilities + num_segments);
+	states.clear();
+	state_columns.clear();
+	segment_entries.clear();
+	build_segment_table();
+}
+
+void Alias_Table::build_segment_table()
+{
+	thresholds.clear();
+	segment_columns.clear();
+	double total_probability = 0.0;
+	for (uint64_t segment = 0; segment < segment_probabilities.size(); ++segment) {
+		if (segment_probabilities[segment] > 0.0) {
+			segment_columns.push_back({ 0.0, {}, { (uint32_t)segment, (uint32_t)segment }, {} });
+			thresholds.push_back(segment_probabilities[segment]);
+			total_probability += segment_probabilities[segment];
+		}
+	}
+	aliases.resize(thresholds.size());
+	fill_aliases(0, (uint32_t)thresholds.size(), total_probability);
+
+	// what is left of a random number either side of the threshold is scaled back to [0, 1)
+	for (size_t column = 0; column < segment_columns.size(); ++column) {
+		Segment_Column &segment_column = segment_columns[column];
+		segment_column.threshold = thresholds[column];
+		segment_column.scales[0] = thresholds[column] < 1.0 ? 1.0 / (1.0 - thresholds[column]) : 0.0;
+		segment_column.scales[1] = 1.0 / thresholds[column];
+		segment_column.segments[0] = segment_columns[aliases[column]].segments[1];
+		// only a full table has the states of its segments
+		if (!segment_entries.empty()) {
+			segment_column.entries[0] = segment_entries[segment_column.segments[0]];
+			segment_column.entries[1] = segment_entries[segment_column.segments[1]];
+		}
+	}
+}
+
+template <typename Real>
+void Alias_Table::build(std::complex<Real> const *state, uint64_t num_states)
+{
+	uint64_t const segment_size = get_segment_size(num_states);
+	uint64_t const num_segments = segment_size == 0 ? 0 : num_states / segment_size;
+	states.clear();
+	thresholds.clear();
+	segment_entries.clear();
+	// the segment probabilities are summed as get_total_probability sums them, so they match those of other samplers
+	segment_probabilities.resize(num_segments);
+	for (uint64_t segment = 0; segment < num_segments; ++segment) {
+		std::complex<Real> const *segment_state = state + (segment * segment_size);
+		segment_probabilities[segment] = get_total_probability(segment_state, segment_size);
+		uint32_t const first_entry = (uint32_t)states.size();
+		for (uint64_t index = 0; index < segment_size; ++index) {
+			double const probability = std::norm(std::complex<double>(segment_state[index]));
+			if (probability > 0.0) {
+				states.push_back((segment * segment_size) + index);
+				thresholds.push_back(probability);
+			}
+		}
+		segment_entries.push_back({ first_entry, (uint32_t)states.size() - first_entry });
+	}
+
+	aliases.resize(states.size());
+	for (uint64_t segment = 0; segment < num_segments; ++segment) {
+		if (segment_entries[segment].num_entries > 0) {
+			fill_aliases(segment_entries[segment].first_entry, segment_entries[segment].num_entries, segment_probabilities[segment]);
+		}
+	}
+	state_columns.resize(states.size());
+	for (size_t entry = 0; entry < states.size(); ++entry) {
+		state_columns[entry] = { thresholds[entry], { aliases[entry], (uint32_t)entry } };
+	}
+	build_segment_table();
+}
+
+template void Alias_Table::build<double>(std::complex<double> const *state, uint64_t num_states);
+template void Alias_Table::build<float>(std::complex<float> const *state, uint64_t num_states);
@@ -0,0 +1,203 @@
+#include <algorithm>
+#include <numeric>
+
+#include "gates.h"
+#include "kernels.h"
+#include "schedule.h"
+
+// number of operations after a gate on a high qbit that are looked at to decide whether moving the qbit pays off
+static constexpr size_t remap_lookahead = 64;
+
+// Tracks where each of the program's qbits currently is, and emits the passes of a schedule.
+struct Scheduler
+{
+	size_t first_low_qbit;
+	// the place of each program qbit, and the program qbit in each place
+	std::vector<uint16_t> places;
+	std::vector<uint16_t> occupants;
+	std::vector<Gate_Pass> passes;
+
+	bool is_low(std::vector<uint16_t> const &qbit_places, Fused_Operation const &operation) const
+	{
+		// a table of phases only depends on each amplitude's index, so it applies to a block wherever its qbits are
+		return operation.kind == Fused_Kind::DIAGONAL ||
+		       std::all_of(operation.qbits.begin(), operation.qbits.end(), [&](uint16_t qbit) { return qbit_places[qbit] >= first_low_qbit; });
+	}
+
+	// Returns the number of sweeps over the state the operations take with the qbits in the given places, with each run
+	// of operations within a block taking one.
+	size_t count_sweeps(std::vector<uint16_t> const &qbit_places, std::vector<Fused_Operation>::const_iterator begin,
+	                    std::vector<Fused_Operation>::const_iterator end) const
+	{
+		size_t num_sweeps = 0;
+		bool is_in_block_run = false;
+		for (auto operation = begin; operation != end; ++operation) {
+			bool const is_blocked = is_low(qbit_places, *operation);
+			num_sweeps += is_blocked && is_in_block_run ? 0 : 1;
+			is_in_block_run = is_blocked;
+		}
+		return num_sweeps;
+	}
+
+	void add_pass(Fused_Operation operation, bool is_blocked)
+	{
+		if (is_blocked && !passes.empty() && passes.back().is_blocked) {
+			passes.back().operations.push_back(std::move(operation));
+		} else {
+			passes.push_back({ is_blocked, { std::move(operation) } });
+		}
+	}
+
+	void add_operation(Fused_Operation const &operation)
+	{
+		// the operation is moved onto the places of its qbits, keeping the order of its qbits and operands
+		bool const is_blocked = is_low(places, operation);
+		Fused_Operation placed_operation = operation;
+		for (auto &qbit : placed_operation.qbits) {
+			qbit = places[qbit];
+		}
+		if (operation.kind == Fused_Kind::GATE) {
+			for (uint8_t index = 0; index < get_num_operands(operation.operation.gate); ++index) {
+				placed_operation.operation.operands[index] = places[operation.operation.operands[index]];
+			}
+		}
+		add_pass(std::move(placed_operation), is_blocked);
+	}
+
+	void add_swap(uint16_t first_place, uint16_t second_place)
+	{
+		Operation const swap = { Gate::SWAP, { first_place, second_place, 0 }, 0.0 };
+		Fused_Operation swap_operation = { Fused_Kind::GATE, swap, { std::min(first_place, second_place), std::max(first_place, second_place) } };
+		add_pass(std::move(swap_operation), first_place >= first_low_qbit && second_place >= first_low_qbit);
+
+		std::swap(occupants[first_place], occupants[second_place]);
+		places[occupants[first_place]] = first_place;
+		places[occupants[second_place]] = second_place;
+	}
+
+	// Moves the high qbits of the next operation to low places if that lets enough of the operations in the window
+	// keep within a block.
+	void remap(std::vector<Fused_Operation>::const_iterator next, std::vector<Fused_Operation>::const_iterator window_end)
+	{
+		// each low place is given up in order of how late its qbit is next used, so the qbits in use stay low
+		std::vector<size_t> next_uses(places.size(), remap_lookahead);
+		for (auto operation = window_end; operation != next;) {
+			--operation;
+			for (uint16_t qbit : operation->qbits) {
+				next_uses[qbit] = operation - next;
+			}
+		}
+		std::vector<uint16_t> low_places;
+		for (size_t place = first_low_qbit; place < places.size(); ++place) {
+			if (next_uses[occupants[place]] > 0) {
+				low_places.push_back((uint16_t)place);
+			}
+		}
+		std::stable_sort(low_places.begin(), low_places.end(), [&](uint16_t lhs, uint16_t rhs) {
+			return next_uses[occupants[lhs]] > next_uses[occupants[rhs]];
+		});
+
+		std::vector<std::pair<uint16_t, uint16_t>> swaps;
+		std::vector<uint16_t> new_places = places;
+		for (uint16_t qbit : next->qbits) {
+			if (new_places[qbit] < first_low_qbit) {
+				if (swaps.size() == low_places.size()) {
+					return;
+				}
+				uint16_t const low_place = low_places[swaps.size()];
+				swaps.push_back({ new_places[qbit], low_place });
+				new_places[occupants[low_place]] = new_places[qbit];
+				new_places[qbit] = low_place;
+			}
+		}
+
+		// Each swap is a sweep over the whole state, and the qbit has to be swapped back later, so the move has to save
+		// more than two sweeps for each qbit moved.
+		size_t const num_sweeps = count_sweeps(places, next, window_end);
+		size_t const num_new_sweeps = count_sweeps(new_places, next, window_end);
+		if (num_new_sweeps + (2 * swaps.size()) < num_sweeps) {
+			for (auto const &[high_place, low_place] : swaps) {
+				add_swap(high_place, low_place);
+			}
+		}
+	}
+};
+
+std::vector<Gate_Pass> schedule_operations(std::vector<Fused_Operation> const &operations, size_t num_qbits, size_t block_qbits)
+{
+	Scheduler scheduler = { num_qbits - std::min(block_qbits, num_qbits), std::vector<uint16_t>(num_qbits), std::vector<uint16_t>(num_qbits), {} };
+	std::iota(scheduler.places.begin(), scheduler.places.end(), (uint16_t)0);
+	std::iota(scheduler.occupants.begin(), scheduler.occupants.end(), (uint16_t)0);
+
+	for (auto operation = operations.begin(); operation != operations.end(); ++operation) {
+		if (!scheduler.is_low(scheduler.places, *operation)) {
+			scheduler.remap(operation, operation + std::min((size_t)(operations.end() - operation), remap_lookahead));
+		}
+		scheduler.add_operation(*operation);
+	}
+
+	for (uint16_t qbit = 0; qbit < num_qbits; ++qbit) {
+		if (scheduler.places[qbit] != qbit) {
+			scheduler.add_swap(qbit, scheduler.places[qbit]);
+		}
+	}
+
+	// a blocked pass of one operation saves nothing over sweeping the whole state with it
+	for (auto &pass : scheduler.passes) {
+		pass.is_blocked = pass.is_blocked && pass.operations.size() > 1;
+	}
+	return std::move(scheduler.passes);
+}
+
+template <typename Real>
+void apply_block_operation(Gate_Kernels<Real> const &kernels, Fused_Operation const &fused_operation, size_t num_qbits,
+                           std::complex<Real> *block, uint64_t first_index, uint64_t num_block_states)
+{
+	auto const qbit_bit = [num_qbits](uint16_t qbit) { return (uint64_t)(num_qbits - 1 - qbit); };
+	std::array<uint64_t, MAX_FUSED_DIAGONAL_QBITS> bits;
+	for (size_t index = 0; index < fused_operation.qbits.size(); ++index) {
+		bits[index] = qbit_bit(fused_operation.qbits[index]);
+	}
+
+	switch (fused_operation.kind) {
+		case Fused_Kind::GATE: {
+			Operation const &operation = fused_operation.operation;
+			uint64_t const bit = qbit_bit(operation.operands[0]);
+			Fixed_Gate const fixed_gate = get_fixed_gate(operation.gate);
+			std::optional<std::array<std::complex<double>, 2>> const diagonal_phases = get_diagonal_phases(operation);
+			if (fixed_gate != Fixed_Gate::NONE) {
+				kernels.apply_fixed[(size_t)fixed_gate](block, bit, 0, num_block_states >> 1);
+			} else if (diagonal_phases) {
+				kernels.apply_diagonal(block, bit, (*diagonal_phases)[0], (*diagonal_phases)[1], 0, num_block_states >> 1);
+			} else if (operation.gate == Gate::CNOT) {
+				apply_cnot_range(block, bit, qbit_bit(operation.operands[1]), 0, num_block_states >> 2);
+			} else if (operation.gate == Gate::SWAP) {
+				apply_swap_range(block, bit, qbit_bit(operation.operands[1]), 0, num_block_states >> 2);
+			} else if (operation.gate == Gate::TOFFOLI) {
+				apply_toffoli_range(block, { bit, qbit_bit(operation.operands[1]), qbit_bit(operation.operands[2]) }, 0, num_block_states >> 3);
+			} else {
+				kernels.apply_matrix(block, bit, get_gate_matrix(operation), 0, num_block_states >> 1);
+			}
+		} break;
+		case Fused_Kind::MATRIX: {
+			std::complex<double> const *elements = fused_operation.elements.data();
+			switch (fused_operation.qbits.size()) {
+				case 1: kernels.apply_matrix(block, bits[0], Gate_Matrix<1>::from_elements(elements), 0, num_block_states >> 1); break;
+				case 2: apply_dense_range(block, Gate_Matrix<2>::from_elements(elements), { bits[0], bits[1] }, 0, num_block_states >> 2); break;
+				case 3: apply_dense_range(block, Gate_Matrix<3>::from_elements(elements), { bits[0], bits[1], bits[2] }, 0, num_block_states >> 3); break;
+				case 4: apply_dense_range(block, Gate_Matrix<4>::from_elements(elements), { bits[0], bits[1], bits[2], bits[3] }, 0, num_block_states >> 4); break;
+			}
+		} break;
+		case Fused_Kind::DIAGONAL: {
+			// the first qbit is the most significant bit of the phase table index
+			std::reverse(bits.begin(), bits.begin() + fused_operation.qbits.size());
+			apply_diagonal_table_range(block, first_index, bits.data(), fused_operation.qbits.size(), fused_operation.elements.data(),
+			                           0, num_block_states);
+		} break;
+	}
+}
+
+template void apply_block_operation(Gate_Kernels<double> const &kernels, Fused_Operation const &fused_operation, size_t num_qbits,
+                                    std::complex<double> *block, uint64_t first_index, uint64_t num_block_states);
+template void apply_block_operation(Gate_Kernels<float> const &kernels, Fused_Operation const &fused_operation, size_t num_qbits,
+                                    std::complex<float> *block, uint64_t first_index, uint64_t num_block_states);
@@ -0,0 +1,252 @@
+#include <algorithm>
+#include <bitset>
+#include <utility>
+
+#include "stabilizer.h"
+
+static size_t count_bits(uint64_t word)
+{
+	return std::bitset<64>(word).count();
+}
+
+// Multiplies the target row on the left by the source row, which commutes with it, and returns the product's sign.
+static uint8_t multiply_rows(uint64_t *target_x, uint64_t *target_z, uint8_t target_sign, uint64_t const *source_x,
+                             uint64_t const *source_z, uint8_t source_sign, size_t num_words)
+{
+	// The product picks up a power of i of -1, 0 or 1 on each qbit. The qbits giving 1 and -1 are found a word at a
+	// time and counted, and as the rows commute the total is 0 or 2 mod 4, a real sign.
+	int64_t exponent = 2 * (target_sign + source_sign);
+	for (size_t word = 0; word < num_words; ++word) {
+		uint64_t const x1 = source_x[word];
+		uint64_t const z1 = source_z[word];
+		uint64_t const x2 = target_x[word];
+		uint64_t const z2 = target_z[word];
+		uint64_t const plus = (x1 & z1 & z2 & ~x2) | (x1 & ~z1 & z2 & x2) | (~x1 & z1 & x2 & ~z2);
+		uint64_t const minus = (x1 & z1 & x2 & ~z2) | (x1 & ~z1 & z2 & ~x2) | (~x1 & z1 & x2 & z2);
+		exponent += (int64_t)count_bits(plus) - (int64_t)count_bits(minus);
+		target_x[word] = x2 ^ x1;
+		target_z[word] = z2 ^ z1;
+	}
+	return (uint8_t)((exponent & 3) >> 1);
+}
+
+static bool anticommutes(uint64_t const *x1, uint64_t const *z1, uint64_t const *x2, uint64_t const *z2, size_t num_words)
+{
+	size_t num_anticommuting_qbits = 0;
+	for (size_t word = 0; word < num_words; ++word) {
+		num_anticommuting_qbits += count_bits((x1[word] & z2[word]) ^ (z1[word] & x2[word]));
+	}
+	return num_anticommuting_qbits & 1;
+}
+
+// Calls function(x_bit, z_bit, sign) on the bits of the qbit in each row, which it updates in place.
+template <typename Function>
+static void update_qbit(std::vector<uint64_t> &x_words, std::vector<uint64_t> &z_words, std::vector<uint8_t> &signs,
+                        size_t num_words, size_t qbit, Function const &function)
+{
+	size_t const word = qbit / 64;
+	uint64_t const shift = qbit % 64;
+	for (size_t row = 0; row < signs.size(); ++row) {
+		uint64_t &x = x_words[(row * num_words) + word];
+		uint64_t &z = z_words[(row * num_words) + word];
+		uint8_t x_bit = (x >> shift) & 1;
+		uint8_t z_bit = (z >> shift) & 1;
+		function(x_bit, z_bit, signs[row]);
+		x = (x & ~((uint64_t)1 << shift)) | ((uint64_t)x_bit << shift);
+		z = (z & ~((uint64_t)1 << shift)) | ((uint64_t)z_bit << shift);
+	}
+}
+
+void Stabilizer_Tableau::reset(size_t new_num_qbits)
+{
+	// destabilizer q is X on qbit q and stabilizer q is Z on qbit q
+	num_qbits = new_num_qbits;
+	num_words = (num_qbits + 63) / 64;
+	x_words.assign(2 * num_qbits * num_words, 0);
+	z_words.assign(2 * num_qbits * num_words, 0);
+	signs.assign(2 * num_qbits, 0);
+	for (size_t qbit = 0; qbit < num_qbits; ++qbit) {
+		x_words[(qbit * num_words) + (qbit / 64)] |= (uint64_t)1 << (qbit % 64);
+		z_words[((num_qbits + qbit) * num_words) + (qbit / 64)] |= (uint64_t)1 << (qbit % 64);
+	}
+}
+
+void Stabilizer_Tableau::apply_hadamard(size_t qbit)
+{
+	update_qbit(x_words, z_words, signs, num_words, qbit, [](uint8_t &x, uint8_t &z, uint8_t &sign) {
+		sign ^= x & z;
+		std::swap(x, z);
+	});
+}
+
+void Stabilizer_Tableau::apply_phase(size_t qbit)
+{
+	update_qbit(x_words, z_words, signs, num_words, qbit, [](uint8_t &x, uint8_t &z, uint8_t &sign) {
+		sign ^= x & z;
+		z ^= x;
+	});
+}
+
+void Stabilizer_Tableau::apply_phase_dag(size_t qbit)
+{
+	update_qbit(x_words, z_words, signs, num_words, qbit, [](uint8_t &x, uint8_t &z, uint8_t &sign) {
+		sign ^= x & (z ^ 1);
+		z ^= x;
+	});
+}
+
+void Stabilizer_Tableau::apply_pauli_x(size_t qbit)
+{
+	update_qbit(x_words, z_words, signs, num_words, qbit, [](uint8_t &, uint8_t &z, uint8_t &sign) { sign ^= z; });
+}
+
+void Stabilizer_Tableau::apply_pauli_y(size_t qbit)
+{
+	update_qbit(x_words, z_words, signs, num_words, qbit, [](uint8_t &x, uint8_t &z, uint8_t &sign) { sign ^= x ^ z; });
+}
+
+void Stabilizer_Tableau::apply_pauli_z(size_t qbit)
+{
+	update_qbit(x_words, z_words, signs, num_words, qbit, [](uint8_t &x, uint8_t &, uint8_t &sign) { sign ^= x; });
+}
+
+void Stabilizer_Tableau::apply_cnot(size_t control_qbit, size_t target_qbit)
+{
+	size_t const control_word = control_qbit / 64;
+	size_t const target_word = target_qbit / 64;
+	uint64_t const control_shift = control_qbit % 64;
+	uint64_t const target_shift = target_qbit % 64;
+	for (size_t row = 0; row < signs.size(); ++row) {
+		uint64_t *x = &x_words[row * num_words];
+		uint64_t *z = &z_words[row * num_words];
+		uint64_t const control_x = (x[control_word] >> control_shift) & 1;
+		uint64_t const control_z = (z[control_word] >> control_shift) & 1;
+		uint64_t const target_x = (x[target_word] >> target_shift) & 1;
+		uint64_t const target_z = (z[target_word] >> target_shift) & 1;
+		signs[row] ^= (uint8_t)(control_x & target_z & (target_x ^ control_z ^ 1));
+		x[target_word] ^= control_x << target_shift;
+		z[control_word] ^= target_z << control_shift;
+	}
+}
+
+void Stabilizer_Tableau::apply_swap(size_t first_qbit, size_t second_qbit)
+{
+	size_t const first_word = first_qbit / 64;
+	size_t const second_word = second_qbit / 64;
+	uint64_t const first_shift = first_qbit % 64;
+	uint64_t const second_shift = second_qbit % 64;
+	for (size_t row = 0; row < signs.size(); ++row) {
+		for (uint64_t *words : { &x_words[row * num_words], &z_words[row * num_words] }) {
+			uint64_t const differ = ((words[first_word] >> first_shift) ^ (words[second_word] >> second_shift)) & 1;
+			words[first_word] ^= differ << first_shift;
+			words[second_word] ^= differ << second_shift;
+		}
+	}
+}
+
+template <typename Is_Anticommuting>
+int Stabilizer_Tableau::get_product_sign(Is_Anticommuting const &is_anticommuting) const
+{
+	// the string is, up to sign, the product of the stabilizers whose destabilizers it anticommutes with
+	std::vector<uint64_t> product_x(num_words, 0);
+	std::vector<uint64_t> product_z(num_words, 0);
+	uint8_t product_sign = 0;
+	for (size_t row = 0; row < num_qbits; ++row) {
+		if (is_anticommuting(row)) {
+			size_t const stabilizer_row = num_qbits + row;
+			product_sign = multiply_rows(product_x.data(), product_z.data(), product_sign, &x_words[stabilizer_row * num_words],
+			                             &z_words[stabilizer_row * num_words], signs[stabilizer_row], num_words);
+		}
+	}
+	return product_sign ? -1 : 1;
+}
+
+int Stabilizer_Tableau::get_expectation(uint64_t const *string_x_words, uint64_t const *string_z_words) const
+{
+	// a string that anticommutes with a stabilizer has zero expectation
+	for (size_t row = num_qbits; row < 2 * num_qbits; ++row) {
+		if (anticommutes(string_x_words, string_z_words, &x_words[row * num_words], &z_words[row * num_words], num_words)) {
+			return 0;
+		}
+	}
+	return get_product_sign([&](size_t row) {
+		return anticommutes(string_x_words, string_z_words, &x_words[row * num_words], &z_words[row * num_words], num_words);
+	});
+}
+
+int Stabilizer_Tableau::get_z_expectation(size_t qbit) const
+{
+	// Z on the qbit anticommutes with just the rows with an X bit on it
+	size_t const word = qbit / 64;
+	uint64_t const mask = (uint64_t)1 << (qbit % 64);
+	for (size_t row = num_qbits; row < 2 * num_qbits; ++row) {
+		if (x_words[(row * num_words) + word] & mask) {
+			return 0;
+		}
+	}
+	return get_product_sign([&](size_t row) { return (x_words[(row * num_words) + word] & mask) != 0; });
+}
+
+Stabilizer_Support Stabilizer_Tableau::get_support() const
+{
+	// Gaussian elimination over the stabilizers, multiplying rows together so that the group they generate is
+	// unchanged, leaves rows with independent X bits, which flip basis states, followed by rows with Z bits only, each
+	// of which fixes the parity of its qbits in every basis state to its sign.
+	std::vector<uint64_t> rows_x(x_words.begin() + (num_qbits * num_words), x_words.end());
+	std::vector<uint64_t> rows_z(z_words.begin() + (num_qbits * num_words), z_words.end());
+	std::vector<uint8_t> row_signs(signs.begin() + num_qbits, signs.end());
+
+	// Reduces the rows from first_row on to echelon form over the given bits, clearing each pivot from every other of
+	// those rows, and returns the row after the last pivot.
+	auto const eliminate = [&](std::vector<uint64_t> const &bits, size_t first_row) {
+		size_t pivot_row = first_row;
+		for (size_t qbit = 0; qbit < num_qbits && pivot_row < num_qbits; ++qbit) {
+			size_t const word = qbit / 64;
+			uint64_t const mask = (uint64_t)1 << (qbit % 64);
+			size_t row = pivot_row;
+			while (row < num_qbits && !(bits[(row * num_words) + word] & mask)) {
+				row += 1;
+			}
+			if (row == num_qbits) {
+				continue;
+			}
+
+			std::swap_ranges(&rows_x[row * num_words], &rows_x[(row + 1) * num_words], &rows_x[pivot_row * num_words]);
+			std::swap_ranges(&rows_z[row * num_words], &rows_z[(row + 1) * num_words], &rows_z[pivot_row * num_words]);
+			std::swap(row_signs[row], row_signs[pivot_row]);
+			for (row = first_row; row < num_qbits; ++row) {
+				if (row != pivot_row && (bits[(row * num_words) + word] & mask)) {
+					row_signs[row] = multiply_rows(&rows_x[row * num_words], &rows_z[row * num_words], row_signs[row],
+					                               &rows_x[pivot_row * num_words], &rows_z[pivot_row * num_words],
+					                               row_signs[pivot_row], num_words);
+				}
+			}
+			pivot_row += 1;
+		}
+		return pivot_row;
+	};
+	size_t const num_flip_rows = eliminate(rows_x, 0);
+	eliminate(rows_z, num_flip_rows);
+
+	// Setting each Z row's pivot qbit to its sign and the rest to zero satisfies every Z row, as no other holds it.
+	// The pivot is the row's first qbit.
+	Stabilizer_Support support = { std::vector<uint64_t>(num_words, 0), {} };
+	for (size_t row = num_flip_rows; row < num_qbits; ++row) {
+		uint64_t const *words = &rows_z[row * num_words];
+		size_t const word = (size_t)(std::find_if(words, words + num_words, [](uint64_t word) { return word != 0; }) - words);
+		support.seed_words[word] |= row_signs[row] ? words[word] & (~words[word] + 1) : 0;
+	}
+
+	// Y = iXZ, so each Y in a row adds a factor of i
+	for (size_t row = 0; row < num_flip_rows; ++row) {
+		std::vector<uint64_t> flip_words(&rows_x[row * num_words], &rows_x[(row + 1) * num_words]);
+		std::vector<uint64_t> sign_words(&rows_z[row * num_words], &rows_z[(row + 1) * num_words]);
+		size_t num_y_qbits = 0;
+		for (size_t word = 0; word < num_words; ++word) {
+			num_y_qbits += count_bits(flip_words[word] & sign_words[word]);
+		}
+		uint8_t const phase = (uint8_t)(((2 * row_signs[row]) + num_y_qbits) & 3);
+		support.generators.push_back({ std::move(flip_words), std::move(sign_words), phase });
+	}
+	return support;
+}
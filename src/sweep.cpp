@@ -0,0 +1,37 @@
+#include <algorithm>
+
+#include "sweep.h"
+#include "thread_pool.h"
+
+std::vector<Sweep_Result> run_sweep(Quantum_Program const &program, std::vector<std::vector<double>> const &bindings,
+                                    Sweep_Options const &options)
+{
+	std::vector<Sweep_Result> sweep_results(bindings.size());
+	if (!program.is_valid()) {
+		return sweep_results;
+	}
+
+	// each thread reuses one single threaded simulator, and so its state vector, for all of its bindings
+	Thread_Pool thread_pool(std::min(std::max(options.num_threads, (size_t)1), std::max(bindings.size(), (size_t)1)));
+	thread_pool.parallel_for(bindings.size(), [&](uint64_t begin, uint64_t end) {
+		if (begin == end) {
+			return;
+		}
+		QSim sim;
+		sim.set_precision(options.precision);
+		sim.set_representation(options.representation);
+		sim.set_program(&program);
+		// every binding resumes from the state before the first parameterised operation
+		sim.set_max_checkpoints(1);
+		for (uint64_t binding = begin; binding < end; ++binding) {
+			sim.set_seed(options.seed + binding);
+			sim.set_parameters(bindings[binding]);
+			sim.run(options.num_runs);
+			if (options.keep_amplitudes) {
+				sweep_results[binding].amplitudes = sim.get_amplitudes();
+			}
+			sweep_results[binding].results = sim.get_results();
+		}
+	});
+	return sweep_results;
+}
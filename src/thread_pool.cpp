@@ -0,0 +1,84 @@
+#include "thread_pool.h"
+
+Thread_Pool::Thread_Pool(size_t num_threads)
+{
+	for (size_t worker_index = 1; worker_index < num_threads; ++worker_index) {
+		workers.emplace_back(&Thread_Pool::worker_main, this, worker_index);
+	}
+}
+
+Thread_Pool::~Thread_Pool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	work_available.notify_all();
+
+	for (auto &worker : workers) {
+		worker.join();
+	}
+}
+
+void Thread_Pool::run(Range_Function function, uint64_t count)
+{
+	if (workers.empty()) {
+		function.invoke(function.context, 0, count);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		task = function;
+		task_size = count;
+		task_generation += 1;
+		num_busy_workers = workers.size();
+	}
+	work_available.notify_all();
+
+	auto const [begin, end] = get_range(0);
+	function.invoke(function.context, begin, end);
+
+	std::unique_lock<std::mutex> lock(mutex);
+	work_complete.wait(lock, [this] { return num_busy_workers == 0; });
+}
+
+void Thread_Pool::worker_main(size_t worker_index)
+{
+	uint64_t last_generation = 0;
+	for (;;) {
+		Range_Function function;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			work_available.wait(lock, [&] { return stopping || task_generation != last_generation; });
+			if (stopping) {
+				return;
+			}
+			last_generation = task_generation;
+			function = task;
+		}
+
+		auto const [begin, end] = get_range(worker_index);
+		if (begin < end) {
+			function.invoke(function.context, begin, end);
+		}
+
+		bool is_last;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			num_busy_workers -= 1;
+			is_last = num_busy_workers == 0;
+		}
+		if (is_last) {
+			work_complete.notify_one();
+		}
+	}
+}
+
+std::pair<uint64_t, uint64_t> Thread_Pool::get_range(size_t thread_index) const
+{
+	uint64_t const num_threads = get_num_threads();
+	uint64_t const begin = (task_size * thread_index) / num_threads;
+	uint64_t const end = (task_size * (thread_index + 1)) / num_threads;
+	return { begin, end };
+}
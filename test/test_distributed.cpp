@@ -0,0 +1,178 @@
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "catch2/catch_test_macros.hpp"
+#include "distributed.h"
+#include "process_group.h"
+#include "qasm.h"
+#include "qsim.h"
+
+// The tests below fork, and only rank 0 returns from Process_Group::finish to check the results, so the other ranks
+// never reach a REQUIRE.
+
+TEST_CASE("Process Group Exchanges Between Pairs", "[distributed]")
+{
+	// each buffer is larger than a socket's buffer, so both ranks of a pair have to send and receive at once
+	Process_Group group;
+	REQUIRE(group.spawn(4));
+	size_t const rank = group.get_rank();
+	std::vector<uint32_t> sent((size_t)1 << 20);
+	std::iota(sent.begin(), sent.end(), (uint32_t)rank << 24);
+	std::vector<uint32_t> received(sent.size());
+	bool is_success = group.exchange(rank ^ 1, sent.data(), received.data(), sent.size() * sizeof(uint32_t));
+	for (size_t index = 0; index < received.size(); ++index) {
+		is_success = is_success && received[index] == (((uint32_t)(rank ^ 1) << 24) + index);
+	}
+	REQUIRE(group.finish(is_success));
+	REQUIRE(group.get_num_ranks() == 1);
+}
+
+// Runs the program on one QSim and across the processes of a group, and expects the same amplitudes to the last bit.
+static void require_distributed_run_matches(Quantum_Program const &program, size_t num_ranks, Precision precision,
+                                            size_t cache_block_qbits)
+{
+	REQUIRE(program.is_valid());
+	Process_Group group;
+	REQUIRE(group.spawn(num_ranks));
+	std::vector<Amplitude> distributed_amplitudes;
+	bool is_success = false;
+	{
+		Distributed_QSim distributed_sim(group);
+		distributed_sim.set_precision(precision);
+		distributed_sim.set_cache_block_qbits(cache_block_qbits);
+		distributed_sim.set_program(&program);
+		is_success = distributed_sim.run(1) && distributed_sim.gather_amplitudes(distributed_amplitudes);
+	}
+	REQUIRE(group.finish(is_success));
+
+	QSim sim;
+	sim.set_precision(precision);
+	sim.set_cache_block_qbits(cache_block_qbits);
+	sim.set_program(&program);
+	sim.run(1);
+	std::vector<Amplitude> const amplitudes = sim.get_amplitudes();
+	REQUIRE(distributed_amplitudes.size() == amplitudes.size());
+	for (size_t index = 0; index < amplitudes.size(); ++index) {
+		REQUIRE(distributed_amplitudes[index].state == amplitudes[index].state);
+		REQUIRE(distributed_amplitudes[index].amplitude == amplitudes[index].amplitude);
+	}
+}
+
+TEST_CASE("Distributed Runs Match QSim", "[distributed]")
+{
+	// random programs over 10 qbits, whose gates on the first qbits mix the chunks of different ranks
+	std::mt19937 rng(11);
+	for (int program_index = 0; program_index < 4; ++program_index) {
+		std::string source = "qbits 10\n";
+		for (int gate = 0; gate < 60; ++gate) {
+			std::string const first = "q" + std::to_string(rng() % 10);
+			std::string second = "q" + std::to_string(rng() % 10);
+			std::string third = "q" + std::to_string(rng() % 10);
+			while (second == first) {
+				second = "q" + std::to_string(rng() % 10);
+			}
+			while (third == first || third == second) {
+				third = "q" + std::to_string(rng() % 10);
+			}
+			switch (rng() % 6) {
+				case 0: source += "h " + first + "\n"; break;
+				case 1: source += "ry " + first + " 0." + std::to_string(rng() % 100) + "\n"; break;
+				case 2: source += "t " + first + "\n"; break;
+				case 3: source += "cnot " + first + " " + second + "\n"; break;
+				case 4: source += "swap " + first + " " + second + "\n"; break;
+				case 5: source += "toffoli " + first + " " + second + " " + third + "\n"; break;
+			}
+		}
+		Quantum_Program const program { source };
+		for (Precision precision : { Precision::DOUBLE, Precision::SINGLE }) {
+			require_distributed_run_matches(program, 2, precision, 0);
+			require_distributed_run_matches(program, 4, precision, 0);
+		}
+		// blocks within a chunk, and blocks wider than one, with qbits moved into the blocks as on one process
+		require_distributed_run_matches(program, 4, Precision::DOUBLE, 4);
+		require_distributed_run_matches(program, 4, Precision::DOUBLE, 9);
+	}
+}
+
+TEST_CASE("Distributed Runs Swap Qbits In Segments", "[distributed]")
+{
+	// each half chunk is larger than one segment of an exchange, and the dense block acts on a global qbit
+	Quantum_Program const program { "qbits 19\nh q0\nry q18 0.3\ncnot q0 q18\nh q1\nry q0 0.9\ncnot q1 q0\nt q0\n"
+	                                "toffoli q0 q1 q17\nh q16\nry q0 0.2\ncnot q16 q0" };
+	require_distributed_run_matches(program, 2, Precision::DOUBLE, 0);
+	require_distributed_run_matches(program, 4, Precision::SINGLE, 0);
+}
+
+TEST_CASE("Distributed Results Follow The State", "[distributed]")
+{
+	Quantum_Program const program { "qbits 9\nh q0\ncnot q0 q1\ncnot q1 q2\ncnot q2 q3\ncnot q3 q4\ncnot q4 q5\ncnot q5 q6\ncnot q6 q7\ncnot q7 q8" };
+	REQUIRE(program.is_valid());
+	Process_Group group;
+	REQUIRE(group.spawn(4));
+	Distributed_QSim sim(group);
+	sim.set_seed(5);
+	sim.set_program(&program);
+	bool const is_run = sim.run(1000);
+	std::vector<Result> const results = sim.get_results();
+	REQUIRE(group.finish(is_run && (group.get_rank() == 0 || results.empty())));
+
+	// the two states of the GHZ state are on the first and last ranks
+	REQUIRE(results.size() == 2);
+	REQUIRE(results[0].state == 0);
+	REQUIRE(results[1].state == 511);
+	REQUIRE(results[0].num_times + results[1].num_times == 1000);
+	REQUIRE(results[0].num_times > 400);
+	REQUIRE(results[1].num_times > 400);
+}
+
+TEST_CASE("Distributed Results Match QSim", "[distributed]")
+{
+	// a spread of states across every rank, with single shots, one batch of shots and several
+	Quantum_Program const program { "qbits 10\nh q0\nry q1 0.7\ncnot q0 q5\nh q2\nry q9 1.3\ncnot q2 q8\nh q4\nrx q6 0.4\n"
+	                                "cnot q1 q7\nry q3 0.2" };
+	REQUIRE(program.is_valid());
+	for (Precision precision : { Precision::DOUBLE, Precision::SINGLE }) {
+		for (int num_runs : { 1, 1000, 200000 }) {
+			Process_Group group;
+			REQUIRE(group.spawn(4));
+			std::vector<Result> distributed_results;
+			bool is_run = false;
+			{
+				Distributed_QSim distributed_sim(group);
+				distributed_sim.set_seed(17);
+				distributed_sim.set_precision(precision);
+				distributed_sim.set_program(&program);
+				is_run = distributed_sim.run(num_runs) && distributed_sim.run(num_runs);
+				distributed_results = distributed_sim.get_results();
+			}
+			REQUIRE(group.finish(is_run));
+
+			// the second run of each, as the seeds of later samplings follow on from the first
+			QSim sim;
+			sim.set_seed(17);
+			sim.set_precision(precision);
+			sim.set_program(&program);
+			sim.run(num_runs);
+			sim.run(num_runs);
+			std::vector<Result> const results = sim.get_results();
+			REQUIRE(distributed_results.size() == results.size());
+			for (size_t index = 0; index < results.size(); ++index) {
+				REQUIRE(distributed_results[index].state == results[index].state);
+				REQUIRE(distributed_results[index].num_times == results[index].num_times);
+			}
+		}
+	}
+}
+
+TEST_CASE("Distributed Runs Need Enough Local Qbits", "[distributed]")
+{
+	Quantum_Program const program { "qbits 4\nh q0\ncnot q0 q3" };
+	REQUIRE(program.is_valid());
+	Process_Group group;
+	REQUIRE(group.spawn(4));
+	Distributed_QSim sim(group);
+	sim.set_program(&program);
+	REQUIRE(group.finish(!sim.run(1)));
+}
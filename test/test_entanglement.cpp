@@ -0,0 +1,70 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "catch2/catch_test_macros.hpp"
+#include "entanglement.h"
+
+TEST_CASE("Entanglement Tracker Merges Groups", "[entanglement]")
+{
+	Entanglement_Tracker entanglements;
+	entanglements.reset(6);
+	REQUIRE(entanglements.get_num_groups() == 6);
+	REQUIRE(entanglements.get_groups() == std::vector<std::vector<uint16_t>> { { 0 }, { 1 }, { 2 }, { 3 }, { 4 }, { 5 } });
+
+	entanglements.merge(4, 1);
+	entanglements.merge(5, 2);
+	REQUIRE(entanglements.get_num_groups() == 4);
+	REQUIRE(entanglements.are_entangled(1, 4));
+	REQUIRE(!entanglements.are_entangled(1, 2));
+
+	uint16_t const root = entanglements.merge(2, 4);
+	REQUIRE(entanglements.is_root(root));
+	REQUIRE(entanglements.find_root(5) == root);
+	REQUIRE(entanglements.get_group_size(1) == 4);
+	REQUIRE(entanglements.merge(1, 5) == root);
+	REQUIRE(entanglements.get_num_groups() == 3);
+	REQUIRE(entanglements.get_groups() == std::vector<std::vector<uint16_t>> { { 0 }, { 1, 2, 4, 5 }, { 3 } });
+
+	std::vector<uint16_t> members;
+	entanglements.for_each_member(5, [&](uint16_t member) { members.push_back(member); });
+	std::sort(members.begin(), members.end());
+	REQUIRE(members == std::vector<uint16_t> { 1, 2, 4, 5 });
+
+	entanglements.reset(3);
+	REQUIRE(entanglements.get_groups() == std::vector<std::vector<uint16_t>> { { 0 }, { 1 }, { 2 } });
+}
+
+TEST_CASE("Entanglement Tracker Matches Naive Groups", "[entanglement]")
+{
+	// the tracker is compared against groups merged by relabelling every member after random merges
+	size_t const num_qbits = 64;
+	std::mt19937 rng(7);
+	std::uniform_int_distribution<int> qbit_distribution(0, num_qbits - 1);
+	Entanglement_Tracker entanglements;
+	entanglements.reset(num_qbits);
+	std::vector<size_t> labels(num_qbits);
+	for (size_t qbit = 0; qbit < num_qbits; ++qbit) {
+		labels[qbit] = qbit;
+	}
+
+	for (int merge_index = 0; merge_index < 100; ++merge_index) {
+		uint16_t const first_qbit = (uint16_t)qbit_distribution(rng);
+		uint16_t const second_qbit = (uint16_t)qbit_distribution(rng);
+		entanglements.merge(first_qbit, second_qbit);
+		size_t const merged_label = labels[second_qbit];
+		std::replace(labels.begin(), labels.end(), merged_label, labels[first_qbit]);
+
+		for (size_t qbit = 0; qbit < num_qbits; ++qbit) {
+			size_t const group_size = (size_t)std::count(labels.begin(), labels.end(), labels[qbit]);
+			REQUIRE(entanglements.get_group_size((uint16_t)qbit) == group_size);
+			REQUIRE(entanglements.are_entangled((uint16_t)qbit, first_qbit) == (labels[qbit] == labels[first_qbit]));
+			size_t num_members = 0;
+			entanglements.for_each_member((uint16_t)qbit, [&](uint16_t member) {
+				REQUIRE(labels[member] == labels[qbit]);
+				num_members += 1;
+			});
+			REQUIRE(num_members == group_size);
+		}
+	}
+}
@@ -0,0 +1,94 @@
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "catch2/catch_test_macros.hpp"
+#include "fusion.h"
+#include "qasm.h"
+#include "qsim.h"
+
+static bool runs_match_steps(std::string const &source)
+{
+	Quantum_Program program(source);
+	if (!program.is_valid()) {
+		return false;
+	}
+
+	QSim run_sim;
+	run_sim.set_program(&program);
+	run_sim.run(1);
+
+	QSim step_sim;
+	step_sim.set_program(&program);
+	for (size_t gate_index = 0; gate_index < program.get_operations().size(); ++gate_index) {
+		step_sim.step();
+	}
+
+	std::vector<Amplitude> const run_amplitudes = run_sim.get_amplitudes();
+	std::vector<Amplitude> const step_amplitudes = step_sim.get_amplitudes();
+	for (auto const &step_amplitude : step_amplitudes) {
+		auto const run_amplitude = std::find_if(run_amplitudes.begin(), run_amplitudes.end(), [&](Amplitude const &amplitude) {
+			return amplitude.state == step_amplitude.state;
+		});
+		bool const run_has_amplitude = run_amplitude != run_amplitudes.end() &&
+		                               std::abs(run_amplitude->amplitude - step_amplitude.amplitude) < 1e-9;
+		if (!run_has_amplitude && std::abs(step_amplitude.amplitude) > 1e-9) {
+			return false;
+		}
+	}
+	return run_sim.get_qbit_groups() == step_sim.get_qbit_groups();
+}
+
+TEST_CASE("Fusion Cancels Inverse Pairs", "[fusion]")
+{
+	Quantum_Program program("h q0\nx q1\ncnot q0 q1\ncnot q0 q1\nx q1\nh q0\nt q2\ntdag q2\nswap q3 q4\nswap q4 q3\ni q5");
+	REQUIRE(program.is_valid());
+	REQUIRE(fuse_operations(program.get_operations()).empty());
+}
+
+TEST_CASE("Fusion Merges Single Qbit Runs", "[fusion]")
+{
+	Quantum_Program program("h q0\nry q0 0.3\ncnot q1 q2\nt q0\nx q0");
+	REQUIRE(program.is_valid());
+	std::vector<Fused_Operation> const fused_operations = fuse_operations(program.get_operations());
+
+	// the gates on q0 become one matrix, independently of the cnot on other qbits
+	REQUIRE(fused_operations.size() == 2);
+	REQUIRE(fused_operations[0].kind == Fused_Kind::GATE);
+	REQUIRE(fused_operations[0].operation.gate == Gate::CNOT);
+	REQUIRE(fused_operations[1].kind == Fused_Kind::MATRIX);
+	REQUIRE(fused_operations[1].qbits == std::vector<uint16_t> { 0 });
+}
+
+TEST_CASE("Fusion Combines Diagonal Runs", "[fusion]")
+{
+	Quantum_Program program("h q0\nh q1\nh q2\nz q0\ns q1\nt q2\nrz q1 0.5");
+	REQUIRE(program.is_valid());
+	std::vector<Fused_Operation> const fused_operations = fuse_operations(program.get_operations());
+	REQUIRE(std::count_if(fused_operations.begin(), fused_operations.end(), [](Fused_Operation const &fused) {
+		return fused.kind == Fused_Kind::DIAGONAL;
+	}) <= 1);
+}
+
+TEST_CASE("Fusion Forms Dense Blocks", "[fusion]")
+{
+	Quantum_Program program("cnot q0 q1\nry q0 0.5\nrx q1 0.2\ncnot q1 q0\nh q1\ncnot q0 q1");
+	REQUIRE(program.is_valid());
+	std::vector<Fused_Operation> const fused_operations = fuse_operations(program.get_operations());
+	REQUIRE(fused_operations.size() == 1);
+	REQUIRE(fused_operations[0].kind == Fused_Kind::MATRIX);
+	REQUIRE(fused_operations[0].qbits == std::vector<uint16_t> { 0, 1 });
+}
+
+TEST_CASE("Fused Programs Match Unfused Programs", "[fusion]")
+{
+	std::vector<std::string> const programs = {
+		"h q0\nh q1\nh q2\nz q0\ns q1\nt q2\nrz q1 0.5\nx q0\nt q0",
+		"cnot q0 q1\nry q0 0.5\nrx q1 0.2\ncnot q1 q0\nh q1\ncnot q0 q1",
+		"h q0\nh q3\ntoffoli q0 q3 q6\nswap q6 q1\ny q1\nrx q7 0.9\ncnot q7 q2\nsdag q2\nh q2\ncnot q2 q3\nt q3\nh q0",
+		"qbits 12\nh q11\nh q4\ncnot q11 q0\nrz q0 1.2\nswap q4 q0\ntoffoli q0 q4 q9\ns q9\nh q9\nx q11\ny q4\nh q4\ntdag q0",
+	};
+	for (auto const &source : programs) {
+		REQUIRE(runs_match_steps(source));
+	}
+}
@@ -0,0 +1,97 @@
+#include <complex>
+#include <type_traits>
+#include <vector>
+
+#include "catch2/catch_template_test_macros.hpp"
+#include "catch2/catch_test_macros.hpp"
+#include "gates.h"
+#include "kernels.h"
+
+using namespace std::literals;
+
+template <typename Real>
+static std::vector<std::complex<Real>> make_test_state(size_t num_qbits)
+{
+	std::vector<std::complex<Real>> state(size_t(1) << num_qbits);
+	for (size_t index = 0; index < state.size(); ++index) {
+		state[index] = { (Real)std::sin(index * 0.37), (Real)std::cos(index * 0.91) };
+	}
+	return state;
+}
+
+template <typename Real>
+static bool states_match(std::vector<std::complex<Real>> const &lhs, std::vector<std::complex<Real>> const &rhs)
+{
+	// vector and scalar kernels may round differently where the vector kernels use fused multiply adds
+	Real const tolerance = std::is_same_v<Real, float> ? (Real)1e-5 : (Real)1e-12;
+	for (size_t index = 0; index < lhs.size(); ++index) {
+		if (std::abs(lhs[index] - rhs[index]) > tolerance) {
+			return false;
+		}
+	}
+	return true;
+}
+
+TEMPLATE_TEST_CASE("Vector Kernels Match Scalar Kernels", "[kernels]", double, float)
+{
+	static size_t const num_qbits = 6;
+	static size_t const num_pairs = (size_t(1) << num_qbits) / 2;
+	Gate_Matrix<1> const gate = { 0.6 + 0.1i, -0.3i, 0.2 - 0.5i, 0.8 };
+	Gate_Kernels<TestType> const &scalar = get_gate_kernels<TestType>(Instruction_Set::SCALAR);
+	Instruction_Set const detected = detect_instruction_set();
+
+	for (Instruction_Set instruction_set : { Instruction_Set::AVX2, Instruction_Set::AVX512 }) {
+		if ((uint8_t)instruction_set > (uint8_t)detected) {
+			continue;
+		}
+		Gate_Kernels<TestType> const &kernels = get_gate_kernels<TestType>(instruction_set);
+		for (uint64_t bit = 0; bit < num_qbits; ++bit) {
+			// unaligned ranges exercise the scalar head and tail of the vector loops
+			for (uint64_t begin : { 0, 1, 3 }) {
+				uint64_t const end = num_pairs - begin;
+
+				std::vector<std::complex<TestType>> expected = make_test_state<TestType>(num_qbits);
+				std::vector<std::complex<TestType>> actual = expected;
+				scalar.apply_matrix(expected.data(), bit, gate, begin, end);
+				kernels.apply_matrix(actual.data(), bit, gate, begin, end);
+				REQUIRE(states_match(expected, actual));
+
+				scalar.apply_diagonal(expected.data(), bit, gate[0], gate[3], begin, end);
+				kernels.apply_diagonal(actual.data(), bit, gate[0], gate[3], begin, end);
+				REQUIRE(states_match(expected, actual));
+			}
+		}
+	}
+}
+
+TEMPLATE_TEST_CASE("Fixed Gate Kernels Match Gate Matrices", "[kernels]", double, float)
+{
+	static size_t const num_qbits = 6;
+	static size_t const num_pairs = (size_t(1) << num_qbits) / 2;
+	Gate_Kernels<TestType> const &scalar = get_gate_kernels<TestType>(Instruction_Set::SCALAR);
+	Instruction_Set const detected = detect_instruction_set();
+
+	for (Gate gate : { Gate::PAULI_X, Gate::PAULI_Y, Gate::PAULI_Z, Gate::HADAMARD }) {
+		Fixed_Gate const fixed_gate = get_fixed_gate(gate);
+		REQUIRE(fixed_gate != Fixed_Gate::NONE);
+		Gate_Matrix<1> const matrix = get_gate_matrix({ gate, { 0, 0, 0 }, 0.0 });
+
+		for (Instruction_Set instruction_set : { Instruction_Set::SCALAR, Instruction_Set::AVX2, Instruction_Set::AVX512 }) {
+			if ((uint8_t)instruction_set > (uint8_t)detected) {
+				continue;
+			}
+			Gate_Kernels<TestType> const &kernels = get_gate_kernels<TestType>(instruction_set);
+			for (uint64_t bit = 0; bit < num_qbits; ++bit) {
+				for (uint64_t begin : { 0, 1, 3 }) {
+					uint64_t const end = num_pairs - begin;
+
+					std::vector<std::complex<TestType>> expected = make_test_state<TestType>(num_qbits);
+					std::vector<std::complex<TestType>> actual = expected;
+					scalar.apply_matrix(expected.data(), bit, matrix, begin, end);
+					kernels.apply_fixed[(size_t)fixed_gate](actual.data(), bit, begin, end);
+					REQUIRE(states_match(expected, actual));
+				}
+			}
+		}
+	}
+}
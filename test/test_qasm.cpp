@@ -31,8 +31,8 @@ TEST_CASE("Valid Qasm Program Compiles All Gates", "[qasm]")
 	REQUIRE(program.is_valid());
 
 	// check all qbits are active
-	std::vector<uint8_t> const &active_qbits = program.get_active_qbits();
-	for (uint8_t qbit_index = 0; qbit_index < 8; ++qbit_index) {
+	std::vector<uint16_t> const &active_qbits = program.get_active_qbits();
+	for (uint16_t qbit_index = 0; qbit_index < 8; ++qbit_index) {
 		REQUIRE(std::find(active_qbits.begin(), active_qbits.end(), qbit_index) != active_qbits.end());
 	}
 
@@ -112,7 +112,7 @@ TEST_CASE("Qasm Correctly Reports Active QBits", "[qasm]")
 	REQUIRE(program.is_valid());
 
 	// check active qbits reported correctly, in order from MSB to LSB
-	std::vector<uint8_t> const &active_qbits = program.get_active_qbits();
+	std::vector<uint16_t> const &active_qbits = program.get_active_qbits();
 	REQUIRE(active_qbits.size() == 3);
 	REQUIRE(active_qbits[0] == 6);
 	REQUIRE(active_qbits[1] == 3);
@@ -133,6 +133,8 @@ TEST_CASE("Qasm Rejects Invalid Commands", "[qasm]")
 		"rx q0 q1\n",            // second argument qbit instead of immediate
 		"ry 1.0 2.0\n",          // first argument immediate instead of qbit
 		"rz q4 0.1abc\n",        // immediate not numeric
+		"rx q0 1theta\n",        // parameter name starting with a digit
+		"ry q0 theta-1\n",       // parameter name with invalid characters
 		"x 1.0\n",               // immediate argument instead of qbit
 		"toffoli q0 q1\n",       // missing argument
 		"toffoli q0 q0 q1\n",    // duplicated argument
@@ -141,6 +143,13 @@ TEST_CASE("Qasm Rejects Invalid Commands", "[qasm]")
 		"toffoli q0 q0 q0\n",    // duplicated argument
 		"toffoli q0 q1 q2 q3\n", // too many arguments
 		"z #q0\n",               // argument commented out
+		"qbits 4097\n",          // register width too large
+		"qbits 31\nt q0\n",      // non Clifford gate on a register too wide for a state vector
+		"qbits 0\n",             // register width too small
+		"qbits q4\n",            // register width not numeric
+		"qbits 4\ni q4\n",       // qbit index beyond register width
+		"qbits 4\ni q18446744073709551618\n", // qbit index wrapping around to one in the register
+		"i q0\nqbits 10\n",      // register width set after first gate
 	};
 
 	for (auto const &command : commands) {
@@ -148,3 +157,53 @@ TEST_CASE("Qasm Rejects Invalid Commands", "[qasm]")
 		REQUIRE(!program.is_valid());
 	}
 }
+
+TEST_CASE("Qasm Sets Register Width", "[qasm]")
+{
+	Quantum_Program default_program("i q7");
+	REQUIRE(default_program.is_valid());
+	REQUIRE(default_program.get_num_qbits() == 8);
+
+	Quantum_Program wide_program("# wide register\nqbits 20\nh q19\ncnot q19 q8");
+	REQUIRE(wide_program.is_valid());
+	REQUIRE(wide_program.get_num_qbits() == 20);
+	REQUIRE(wide_program.get_operations()[0].operands[0] == 19);
+
+	// registers of Clifford gates can be as wide as a tableau allows
+	Quantum_Program stabilizer_program("qbits 4096\nh q4095\ncnot q4095 q300");
+	REQUIRE(stabilizer_program.is_valid());
+	REQUIRE(stabilizer_program.get_operations()[1].operands[0] == 4095);
+	REQUIRE(stabilizer_program.get_operations()[1].operands[1] == 300);
+	REQUIRE(stabilizer_program.get_active_qbits() == std::vector<uint16_t> { 4095, 300 });
+}
+
+TEST_CASE("Qasm Detects Clifford Programs", "[qasm]")
+{
+	REQUIRE(Quantum_Program("h q0\ns q1\nsdag q2\nx q3\ny q4\nz q5\ncnot q0 q1\nswap q2 q3\ni q6").is_clifford());
+	REQUIRE(!Quantum_Program("h q0\nt q0").is_clifford());
+	REQUIRE(!Quantum_Program("rz q0 theta").is_clifford());
+	REQUIRE(!Quantum_Program("toffoli q0 q1 q2").is_clifford());
+
+	Quantum_Program wide_program("qbits 64\nh q0\ncnot q0 q63");
+	REQUIRE(wide_program.is_valid());
+	REQUIRE(wide_program.is_clifford());
+	REQUIRE(wide_program.get_num_qbits() == 64);
+}
+
+TEST_CASE("Qasm Parses Named Parameters", "[qasm]")
+{
+	Quantum_Program program("rx q0 theta\nry q1 0.5\nrz q2 Phi_2\nrx q3 theta");
+	REQUIRE(program.is_valid());
+
+	std::vector<std::string> const &parameter_names = program.get_parameter_names();
+	REQUIRE(parameter_names.size() == 2);
+	REQUIRE(parameter_names[0] == "theta");
+	REQUIRE(parameter_names[1] == "phi_2");
+
+	std::vector<Operation> const &operations = program.get_operations();
+	REQUIRE(operations[0].parameter == 0);
+	REQUIRE(operations[1].parameter == NO_PARAMETER);
+	REQUIRE(operations[1].immediate == 0.5);
+	REQUIRE(operations[2].parameter == 1);
+	REQUIRE(operations[3].parameter == 0);
+}
@@ -1,4 +1,10 @@
 #include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <new>
 
 #include "catch2/catch_template_test_macros.hpp"
 #include "catch2/catch_test_macros.hpp"
@@ -8,11 +14,72 @@
 
 using namespace std::literals;
 
+// Allocation counting hook: every replaceable global allocation function is replaced for the test executable, so tests
+// can check how many heap allocations a piece of code makes. All of them share one scheme, in which malloc's pointer is
+// kept just before the aligned block, so any form of delete can free memory from any form of new.
+static std::atomic<size_t> num_allocations { 0 };
+
+static void *allocate(size_t size, size_t alignment) noexcept
+{
+	num_allocations += 1;
+	alignment = std::max(alignment, alignof(void *));
+	void *const memory = std::malloc(size + alignment + sizeof(void *));
+	if (!memory) {
+		return nullptr;
+	}
+	uintptr_t const block = ((uintptr_t)memory + sizeof(void *) + alignment - 1) & ~(uintptr_t)(alignment - 1);
+	reinterpret_cast<void **>(block)[-1] = memory;
+	return reinterpret_cast<void *>(block);
+}
+
+static void *allocate_or_throw(size_t size, size_t alignment)
+{
+	if (void *memory = allocate(size, alignment)) {
+		return memory;
+	}
+	throw std::bad_alloc();
+}
+
+static void deallocate(void *memory) noexcept
+{
+	if (memory) {
+		std::free(static_cast<void **>(memory)[-1]);
+	}
+}
+
+void *operator new(size_t size) { return allocate_or_throw(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__); }
+void *operator new[](size_t size) { return allocate_or_throw(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__); }
+void *operator new(size_t size, std::align_val_t alignment) { return allocate_or_throw(size, (size_t)alignment); }
+void *operator new[](size_t size, std::align_val_t alignment) { return allocate_or_throw(size, (size_t)alignment); }
+void *operator new(size_t size, std::nothrow_t const &) noexcept { return allocate(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__); }
+void *operator new[](size_t size, std::nothrow_t const &) noexcept { return allocate(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__); }
+void *operator new(size_t size, std::align_val_t alignment, std::nothrow_t const &) noexcept { return allocate(size, (size_t)alignment); }
+void *operator new[](size_t size, std::align_val_t alignment, std::nothrow_t const &) noexcept { return allocate(size, (size_t)alignment); }
+
+void operator delete(void *memory) noexcept { deallocate(memory); }
+void operator delete[](void *memory) noexcept { deallocate(memory); }
+void operator delete(void *memory, size_t) noexcept { deallocate(memory); }
+void operator delete[](void *memory, size_t) noexcept { deallocate(memory); }
+void operator delete(void *memory, std::align_val_t) noexcept { deallocate(memory); }
+void operator delete[](void *memory, std::align_val_t) noexcept { deallocate(memory); }
+void operator delete(void *memory, size_t, std::align_val_t) noexcept { deallocate(memory); }
+void operator delete[](void *memory, size_t, std::align_val_t) noexcept { deallocate(memory); }
+void operator delete(void *memory, std::nothrow_t const &) noexcept { deallocate(memory); }
+void operator delete[](void *memory, std::nothrow_t const &) noexcept { deallocate(memory); }
+void operator delete(void *memory, std::align_val_t, std::nothrow_t const &) noexcept { deallocate(memory); }
+void operator delete[](void *memory, std::align_val_t, std::nothrow_t const &) noexcept { deallocate(memory); }
+
+// Runs the program in both double and single precision and in the factored representation, and expects all of them to
+// reach the same amplitudes.
 struct QSim_Test_Fixture
 {
 	Quantum_Program program;
 	QSim sim;
+	QSim single_sim;
+	QSim factored_sim;
 	std::vector<Amplitude> amplitudes;
+	std::vector<Amplitude> single_amplitudes;
+	std::vector<Amplitude> factored_amplitudes;
 
 	QSim_Test_Fixture(std::string const &source)
 		: program(source)
@@ -20,9 +87,19 @@ struct QSim_Test_Fixture
 		sim.set_program(&program);
 		sim.run(1);
 		amplitudes = sim.get_amplitudes();
+
+		single_sim.set_precision(Precision::SINGLE);
+		single_sim.set_program(&program);
+		single_sim.run(1);
+		single_amplitudes = single_sim.get_amplitudes();
+
+		factored_sim.set_representation(Representation::FACTORED);
+		factored_sim.set_program(&program);
+		factored_sim.run(1);
+		factored_amplitudes = factored_sim.get_amplitudes();
 	}
 
-	bool has_state_amplitude(uint8_t state, std::complex<double> amplitude) const
+	static bool has_state_amplitude(std::vector<Amplitude> const &amplitudes, uint64_t state, std::complex<double> amplitude)
 	{
 		auto state_amplitude = std::find_if(amplitudes.begin(), amplitudes.end(),
 	                                        [state](Amplitude const &amplitude)
@@ -32,6 +109,12 @@ struct QSim_Test_Fixture
 		}
 		return std::abs(state_amplitude->amplitude - amplitude) < 0.001;
 	}
+
+	bool has_state_amplitude(uint64_t state, std::complex<double> amplitude) const
+	{
+		return has_state_amplitude(amplitudes, state, amplitude) && has_state_amplitude(single_amplitudes, state, amplitude) &&
+		       has_state_amplitude(factored_amplitudes, state, amplitude);
+	}
 };
 
 TEMPLATE_TEST_CASE_SIG("QSim CNot Gate", "[qsim]",
@@ -161,3 +244,737 @@ TEMPLATE_TEST_CASE_SIG("QSim Toffoli Gate", "[qsim]",
 	QSim_Test_Fixture fixture(programs[program_index]);
 	REQUIRE(fixture.has_state_amplitude(state, 1.0));
 }
+
+TEST_CASE("QSim Gates On Separate Qbits", "[qsim]")
+{
+	QSim_Test_Fixture fixture { "h q0\nx q3\nh q7" };
+	REQUIRE(fixture.has_state_amplitude(0b00010000, 0.5));
+	REQUIRE(fixture.has_state_amplitude(0b00010001, 0.5));
+	REQUIRE(fixture.has_state_amplitude(0b10010000, 0.5));
+	REQUIRE(fixture.has_state_amplitude(0b10010001, 0.5));
+}
+
+TEST_CASE("QSim Toffoli Gate On Superposition", "[qsim]")
+{
+	QSim_Test_Fixture fixture { "h q0\nx q5\ntoffoli q0 q5 q2\nswap q2 q7" };
+	REQUIRE(fixture.has_state_amplitude(0b00000100, 1.0 / std::sqrt(2.0)));
+	REQUIRE(fixture.has_state_amplitude(0b10000101, 1.0 / std::sqrt(2.0)));
+}
+
+TEST_CASE("QSim Register Width From Program", "[qsim]")
+{
+	QSim_Test_Fixture fixture { "qbits 12\nx q0\nh q11\ncnot q11 q9" };
+	REQUIRE(fixture.sim.get_num_qbits() == 12);
+	REQUIRE(fixture.has_state_amplitude(0b100000000000, 1.0 / std::sqrt(2.0)));
+	REQUIRE(fixture.has_state_amplitude(0b100000000101, 1.0 / std::sqrt(2.0)));
+}
+
+TEST_CASE("QSim Multithreaded Matches Single Threaded", "[qsim]")
+{
+	Quantum_Program program { "qbits 16\nh q0\nh q15\nry q7 0.3\ncnot q0 q8\nswap q15 q3\ntoffoli q0 q3 q12\nt q12\nrx q1 1.2" };
+	REQUIRE(program.is_valid());
+
+	QSim serial_sim(1);
+	serial_sim.set_program(&program);
+	serial_sim.run(1);
+
+	QSim threaded_sim(4);
+	threaded_sim.set_program(&program);
+	threaded_sim.run(1);
+
+	std::vector<Amplitude> const serial_amplitudes = serial_sim.get_amplitudes();
+	std::vector<Amplitude> const threaded_amplitudes = threaded_sim.get_amplitudes();
+	REQUIRE(serial_amplitudes.size() == threaded_amplitudes.size());
+	for (size_t index = 0; index < serial_amplitudes.size(); ++index) {
+		REQUIRE(serial_amplitudes[index].state == threaded_amplitudes[index].state);
+		REQUIRE(serial_amplitudes[index].amplitude == threaded_amplitudes[index].amplitude);
+	}
+}
+
+TEST_CASE("QSim Fused Diagonal Gates Match Single Steps", "[qsim]")
+{
+	Quantum_Program program { "h q0\nh q1\nh q2\nh q3\nz q0\ns q1\nt q2\nrz q3 0.7\ntdag q0\ni q5\nsdag q2\nx q1\nt q1" };
+	REQUIRE(program.is_valid());
+
+	QSim run_sim;
+	run_sim.set_program(&program);
+	run_sim.run(1);
+
+	QSim step_sim;
+	step_sim.set_program(&program);
+	for (size_t gate_index = 0; gate_index < program.get_operations().size(); ++gate_index) {
+		step_sim.step();
+	}
+
+	std::vector<Amplitude> const run_amplitudes = run_sim.get_amplitudes();
+	std::vector<Amplitude> const step_amplitudes = step_sim.get_amplitudes();
+	REQUIRE(run_amplitudes.size() == 16);
+	REQUIRE(run_amplitudes.size() == step_amplitudes.size());
+	for (size_t index = 0; index < run_amplitudes.size(); ++index) {
+		REQUIRE(run_amplitudes[index].state == step_amplitudes[index].state);
+		REQUIRE(std::abs(run_amplitudes[index].amplitude - step_amplitudes[index].amplitude) < 1e-12);
+	}
+}
+
+TEST_CASE("QSim Results Follow State Probabilities", "[qsim]")
+{
+	Quantum_Program program { "ry q0 1.0\nh q3\ncnot q3 q5" };
+	REQUIRE(program.is_valid());
+
+	static int const num_runs = 200000;
+	QSim sim;
+	sim.set_program(&program);
+	sim.run(num_runs);
+
+	std::vector<Amplitude> const amplitudes = sim.get_amplitudes();
+	std::vector<Result> const &results = sim.get_results();
+	REQUIRE(results.size() == amplitudes.size());
+
+	uint64_t total_runs = 0;
+	for (size_t index = 0; index < results.size(); ++index) {
+		REQUIRE(results[index].state == amplitudes[index].state);
+		double const expected_fraction = std::norm(amplitudes[index].amplitude);
+		double const actual_fraction = (double)results[index].num_times / num_runs;
+		REQUIRE(std::abs(actual_fraction - expected_fraction) < 0.01);
+		total_runs += results[index].num_times;
+	}
+	REQUIRE(total_runs == num_runs);
+}
+
+TEST_CASE("QSim Results Are Reproducible From A Seed", "[qsim]")
+{
+	Quantum_Program program { "h q0\nh q1\nry q2 0.4\ncnot q1 q6" };
+	REQUIRE(program.is_valid());
+
+	static int const num_runs = 1000000;
+	auto run_with_seed = [&](uint64_t seed) {
+		QSim sim(4);
+		sim.set_program(&program);
+		sim.set_seed(seed);
+		sim.run(num_runs);
+		return sim.get_results();
+	};
+
+	std::vector<Result> const first_results = run_with_seed(1234);
+	std::vector<Result> const second_results = run_with_seed(1234);
+	std::vector<Result> const other_results = run_with_seed(4321);
+
+	auto results_match = [](std::vector<Result> const &lhs, std::vector<Result> const &rhs) {
+		return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin(), [](Result const &lhs, Result const &rhs) {
+			return lhs.state == rhs.state && lhs.num_times == rhs.num_times;
+		});
+	};
+	REQUIRE(results_match(first_results, second_results));
+	REQUIRE(!results_match(first_results, other_results));
+
+	uint64_t total_runs = 0;
+	for (auto const &result : first_results) {
+		total_runs += result.num_times;
+	}
+	REQUIRE(total_runs == num_runs);
+}
+
+TEST_CASE("QSim Steps Without Allocating", "[qsim]")
+{
+	Quantum_Program program { "qbits 6\nh q0\nry q1 0.4\ncnot q0 q1\nswap q2 q3\nt q2\ntoffoli q0 q2 q4\nrz q5 0.2\ncnot q3 q5\nx q4" };
+	REQUIRE(program.is_valid());
+
+	QSim sim;
+	sim.set_program(&program);
+
+	// counted from set_program, through the single shot taken after the last step, and again after a reset
+	size_t const initial_num_allocations = num_allocations;
+	while (sim.get_next_gate_index() < program.get_operations().size()) {
+		sim.step();
+	}
+	size_t const first_num_results = sim.get_results().size();
+	sim.reset();
+	while (sim.get_next_gate_index() < program.get_operations().size()) {
+		sim.step();
+	}
+	size_t const step_num_allocations = num_allocations - initial_num_allocations;
+	REQUIRE(step_num_allocations == 0);
+	REQUIRE(first_num_results == 1);
+	REQUIRE(sim.get_results().size() == 1);
+	REQUIRE(sim.get_qbit_groups().size() == 1);
+
+	// the factored groups grow to their widest on the first pass, and are recycled on every pass after a reset
+	QSim factored_sim;
+	factored_sim.set_representation(Representation::FACTORED);
+	factored_sim.set_program(&program);
+	while (factored_sim.get_next_gate_index() < program.get_operations().size()) {
+		factored_sim.step();
+	}
+	size_t const initial_factored_num_allocations = num_allocations;
+	for (int pass = 0; pass < 2; ++pass) {
+		factored_sim.reset();
+		while (factored_sim.get_next_gate_index() < program.get_operations().size()) {
+			factored_sim.step();
+		}
+	}
+	size_t const factored_step_num_allocations = num_allocations - initial_factored_num_allocations;
+	REQUIRE(factored_step_num_allocations == 0);
+	REQUIRE(factored_sim.get_results().size() == 1);
+	REQUIRE(factored_sim.get_qbit_groups().size() == 1);
+}
+
+TEST_CASE("QSim Single Precision Matches Double Precision", "[qsim]")
+{
+	// wide enough for the vector kernels and the thread pool, with fused blocks and single steps
+	Quantum_Program program { "qbits 16\nh q0\nh q5\nry q15 0.7\ncnot q0 q15\ny q3\nrx q3 1.2\ntoffoli q0 q3 q9\n"
+	                          "t q9\nswap q9 q14\nh q14\nrz q14 0.4\ncnot q14 q2\nz q2\nsdag q5\nh q7\ncnot q7 q6" };
+	REQUIRE(program.is_valid());
+
+	QSim double_sim(4);
+	double_sim.set_program(&program);
+	double_sim.run(1);
+
+	QSim single_sim(4);
+	single_sim.set_precision(Precision::SINGLE);
+	REQUIRE(single_sim.get_precision() == Precision::SINGLE);
+	single_sim.set_program(&program);
+	single_sim.run(1);
+
+	QSim single_step_sim;
+	single_step_sim.set_precision(Precision::SINGLE);
+	single_step_sim.set_program(&program);
+	while (single_step_sim.get_next_gate_index() < program.get_operations().size()) {
+		single_step_sim.step();
+	}
+
+	std::vector<Amplitude> const double_amplitudes = double_sim.get_amplitudes();
+	for (QSim const *sim : { &single_sim, &single_step_sim }) {
+		std::vector<Amplitude> const single_amplitudes = sim->get_amplitudes();
+		REQUIRE(single_amplitudes.size() == double_amplitudes.size());
+		for (size_t index = 0; index < double_amplitudes.size(); ++index) {
+			REQUIRE(single_amplitudes[index].state == double_amplitudes[index].state);
+			REQUIRE(std::abs(single_amplitudes[index].amplitude - double_amplitudes[index].amplitude) < 1e-5);
+		}
+	}
+}
+
+TEST_CASE("QSim Expectation Values Of Pauli Strings", "[qsim]")
+{
+	Quantum_Program program { "qbits 4\nh q0\ncnot q0 q1\nry q2 0.6\nh q3" };
+	REQUIRE(program.is_valid());
+
+	for (Precision precision : { Precision::DOUBLE, Precision::SINGLE }) {
+		QSim sim;
+		sim.set_precision(precision);
+		sim.set_program(&program);
+		sim.run(1);
+
+		REQUIRE(std::abs(sim.compute_expectation({ { 1.0, { { Pauli::Z, 0 }, { Pauli::Z, 1 } } } }) - 1.0) < 1e-5);
+		REQUIRE(std::abs(sim.compute_expectation({ { 1.0, { { Pauli::X, 0 }, { Pauli::X, 1 } } } }) - 1.0) < 1e-5);
+		REQUIRE(std::abs(sim.compute_expectation({ { 1.0, { { Pauli::Y, 0 }, { Pauli::Y, 1 } } } }) + 1.0) < 1e-5);
+		REQUIRE(std::abs(sim.compute_expectation({ { 1.0, { { Pauli::Z, 0 } } } })) < 1e-5);
+		REQUIRE(std::abs(sim.compute_expectation({ { 1.0, { { Pauli::Z, 2 } } } }) - std::cos(0.6)) < 1e-5);
+		REQUIRE(std::abs(std::abs(sim.compute_expectation({ { 1.0, { { Pauli::X, 2 } } } })) - std::sin(0.6)) < 1e-5);
+		REQUIRE(std::abs(sim.compute_expectation({ { 1.0, { { Pauli::X, 3 } } } }) - 1.0) < 1e-5);
+
+		// a weighted sum, with the identity and terms sharing flipped qbits, and a term outside the register skipped
+		Observable const observable = {
+			{ 0.5, { { Pauli::Z, 0 }, { Pauli::Z, 1 } } },
+			{ 2.0, {} },
+			{ -1.5, { { Pauli::X, 3 } } },
+			{ 0.25, { { Pauli::Y, 3 } } },
+			{ 3.0, { { Pauli::Z, 7 } } },
+		};
+		double const expected = 0.5 + 2.0 - 1.5;
+		REQUIRE(std::abs(sim.compute_expectation(observable) - expected) < 1e-5);
+
+		// products on the same qbit multiply, so X Y Z is i times the identity, and Z Z is the identity
+		REQUIRE(std::abs(sim.compute_expectation({ { 1.0, { { Pauli::X, 2 }, { Pauli::Y, 2 }, { Pauli::Z, 2 } } } })) < 1e-5);
+		REQUIRE(std::abs(sim.compute_expectation({ { 1.0, { { Pauli::Z, 2 }, { Pauli::Z, 2 } } } }) - 1.0) < 1e-5);
+	}
+}
+
+TEST_CASE("QSim Expectation Values Match The Amplitudes", "[qsim]")
+{
+	// wide enough to split the pass across the thread pool
+	Quantum_Program program { "qbits 16\nh q0\nry q3 0.9\ncnot q0 q3\nrx q7 1.3\ncnot q3 q7\nh q12\nt q12\ncnot q12 q15\nry q9 -0.4" };
+	REQUIRE(program.is_valid());
+
+	QSim sim(4);
+	sim.set_program(&program);
+	sim.run(1);
+
+	Observable const observable = {
+		{ 0.7, { { Pauli::Z, 0 }, { Pauli::Z, 3 } } },
+		{ -0.3, { { Pauli::X, 0 }, { Pauli::Y, 3 }, { Pauli::Z, 7 } } },
+		{ 1.1, { { Pauli::Y, 7 }, { Pauli::X, 12 } } },
+		{ 0.4, { { Pauli::X, 12 }, { Pauli::X, 15 } } },
+		{ -0.9, { { Pauli::Y, 12 }, { Pauli::Y, 15 }, { Pauli::Z, 9 } } },
+		{ 0.2, { { Pauli::X, 9 } } },
+	};
+
+	// apply each term to every basis state separately, with qbit 0 as the most significant bit of the state
+	std::vector<Amplitude> const amplitudes = sim.get_amplitudes();
+	std::complex<double> expected = 0.0;
+	for (auto const &term : observable) {
+		for (auto const &amplitude : amplitudes) {
+			uint64_t state = amplitude.state;
+			std::complex<double> value = amplitude.amplitude;
+			for (auto factor = term.factors.rbegin(); factor != term.factors.rend(); ++factor) {
+				uint64_t const mask = (uint64_t)1 << (15 - factor->qbit);
+				bool const is_one = state & mask;
+				if (factor->pauli == Pauli::Z && is_one) {
+					value = -value;
+				} else if (factor->pauli == Pauli::Y) {
+					value *= is_one ? -1.0i : 1.0i;
+				}
+				if (factor->pauli != Pauli::Z) {
+					state ^= mask;
+				}
+			}
+			auto const target = std::find_if(amplitudes.begin(), amplitudes.end(), [state](Amplitude const &amplitude) { return amplitude.state == state; });
+			if (target != amplitudes.end()) {
+				expected += term.coefficient * std::conj(target->amplitude) * value;
+			}
+		}
+	}
+	REQUIRE(std::abs(expected.imag()) < 1e-9);
+	REQUIRE(std::abs(sim.compute_expectation(observable) - expected.real()) < 1e-9);
+}
+
+static bool amplitudes_match(std::vector<Amplitude> const &lhs, std::vector<Amplitude> const &rhs)
+{
+	return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin(), [](Amplitude const &lhs, Amplitude const &rhs) {
+		return lhs.state == rhs.state && std::abs(lhs.amplitude - rhs.amplitude) < 1e-9;
+	});
+}
+
+TEST_CASE("QSim Restores Snapshots", "[qsim]")
+{
+	Quantum_Program program { "h q0\ncnot q0 q1\nry q2 0.3\nswap q1 q2\nt q0\nh q1" };
+	REQUIRE(program.is_valid());
+
+	QSim sim;
+	sim.set_program(&program);
+	sim.step();
+	sim.step();
+	sim.step();
+	std::vector<Amplitude> const snapshot_amplitudes = sim.get_amplitudes();
+	std::vector<std::vector<uint16_t>> const snapshot_qbit_groups = sim.get_qbit_groups();
+	QSim_Snapshot snapshot;
+	sim.save_snapshot(snapshot);
+	REQUIRE(snapshot.gate_index == 3);
+
+	sim.run(1);
+	REQUIRE(sim.restore_snapshot(snapshot));
+	REQUIRE(sim.get_next_gate_index() == 3);
+	REQUIRE(amplitudes_match(sim.get_amplitudes(), snapshot_amplitudes));
+	REQUIRE(sim.get_qbit_groups() == snapshot_qbit_groups);
+
+	// the snapshot also fits a program that starts with the same operations, but not one that differs before it
+	Quantum_Program longer_program { "h q0\ncnot q0 q1\nry q2 0.3\nx q3" };
+	sim.set_program(&longer_program);
+	REQUIRE(sim.restore_snapshot(snapshot));
+	sim.step();
+	REQUIRE(sim.get_next_gate_index() == 4);
+
+	Quantum_Program other_program { "h q0\ncnot q0 q1\nry q2 0.4\nswap q1 q2" };
+	sim.set_program(&other_program);
+	REQUIRE_FALSE(sim.restore_snapshot(snapshot));
+	REQUIRE(sim.get_next_gate_index() == 0);
+
+	sim.set_program(&program);
+	sim.set_precision(Precision::SINGLE);
+	REQUIRE_FALSE(sim.restore_snapshot(snapshot));
+}
+
+TEST_CASE("QSim Resumes Runs From Checkpoints", "[qsim]")
+{
+	Quantum_Program program { "qbits 5\nh q0\ncnot q0 q1\nry q2 0.3\ntoffoli q0 q1 q3\nrx q4 theta\ncnot q4 q2\nry q3 phi" };
+	REQUIRE(program.is_valid());
+
+	QSim sim;
+	sim.set_program(&program);
+	sim.set_max_checkpoints(2);
+	QSim reference_sim;
+	reference_sim.set_program(&program);
+
+	for (std::vector<double> const &values : { std::vector<double> { 0.1, 0.2 }, { 1.4, -0.7 }, { -2.0, 0.0 } }) {
+		sim.set_parameters(values);
+		sim.run(1);
+		reference_sim.set_parameters(values);
+		reference_sim.run(1);
+		REQUIRE(sim.get_next_gate_index() == program.get_operations().size());
+		REQUIRE(amplitudes_match(sim.get_amplitudes(), reference_sim.get_amplitudes()));
+		REQUIRE(sim.get_qbit_groups() == reference_sim.get_qbit_groups());
+	}
+}
+
+TEST_CASE("QSim Seeks Through Programs", "[qsim]")
+{
+	std::string source = "qbits 6\n";
+	for (int gate = 0; gate < 20; ++gate) {
+		source += "h q" + std::to_string(gate % 6) + "\ncnot q" + std::to_string(gate % 6) + " q" + std::to_string((gate + 1) % 6) +
+		          "\nry q" + std::to_string((gate + 3) % 6) + " 0." + std::to_string(gate + 1) + "\n";
+	}
+	Quantum_Program program { source };
+	REQUIRE(program.is_valid());
+
+	QSim sim;
+	sim.set_program(&program);
+	sim.set_max_checkpoints(4);
+	for (size_t gate_index : { (size_t)50, (size_t)7, (size_t)33, (size_t)60, (size_t)0, (size_t)49, (size_t)48, (size_t)17 }) {
+		sim.seek(gate_index);
+		REQUIRE(sim.get_next_gate_index() == gate_index);
+
+		QSim reference_sim;
+		reference_sim.set_program(&program);
+		while (reference_sim.get_next_gate_index() < gate_index) {
+			reference_sim.step();
+		}
+		REQUIRE(amplitudes_match(sim.get_amplitudes(), reference_sim.get_amplitudes()));
+		REQUIRE(sim.get_qbit_groups() == reference_sim.get_qbit_groups());
+	}
+}
+
+TEST_CASE("QSim Resumes From A State File", "[qsim]")
+{
+	// wide enough that the threads sweep the mapped state in blocks
+	std::string source = "qbits 18\n";
+	for (int gate = 0; gate < 24; ++gate) {
+		source += "h q" + std::to_string((gate * 7) % 18) + "\ncnot q" + std::to_string((gate * 7) % 18) + " q" +
+		          std::to_string((gate * 5 + 1) % 18) + "\nry q" + std::to_string((gate * 11 + 3) % 18) + " 0." + std::to_string(gate + 1) + "\n";
+	}
+	Quantum_Program program { source };
+	REQUIRE(program.is_valid());
+	std::filesystem::path const path = std::filesystem::temp_directory_path() / "fqcsim_test_state.bin";
+	std::filesystem::remove(path);
+
+	QSim reference_sim(4);
+	reference_sim.set_program(&program);
+	{
+		QSim sim(4);
+		sim.set_program(&program);
+		REQUIRE(sim.set_state_file(path));
+		REQUIRE(sim.is_state_mapped());
+		while (sim.get_next_gate_index() < 40) {
+			sim.step();
+			reference_sim.step();
+		}
+		REQUIRE(amplitudes_match(sim.get_amplitudes(), reference_sim.get_amplitudes()));
+		sim.flush_state_file();
+	}
+
+	// a new simulation picks up where the file left off, with the same entanglements
+	QSim sim(4);
+	sim.set_program(&program);
+	REQUIRE(sim.set_state_file(path));
+	REQUIRE(sim.get_next_gate_index() == 40);
+	REQUIRE(amplitudes_match(sim.get_amplitudes(), reference_sim.get_amplitudes()));
+	REQUIRE(sim.get_qbit_groups() == reference_sim.get_qbit_groups());
+
+	// fusing the rest of the program rounds differently, so the qbit states are compared rather than the amplitudes
+	sim.run(1);
+	reference_sim.run(1);
+	REQUIRE(sim.get_next_gate_index() == program.get_operations().size());
+	for (uint16_t qbit = 0; qbit < 18; ++qbit) {
+		for (size_t value = 0; value < 2; ++value) {
+			REQUIRE(std::abs(sim.get_qbit_state(qbit)[value] - reference_sim.get_qbit_state(qbit)[value]) < 1e-9);
+		}
+	}
+	sim.clear_state_file();
+	REQUIRE_FALSE(sim.is_state_mapped());
+
+	// a state from another program or precision starts over
+	Quantum_Program other_program { "qbits 18\nx q0" };
+	sim.set_program(&other_program);
+	REQUIRE(sim.set_state_file(path));
+	REQUIRE(sim.get_next_gate_index() == 0);
+	sim.clear_state_file();
+	sim.set_program(&program);
+	sim.set_precision(Precision::SINGLE);
+	REQUIRE(sim.set_state_file(path));
+	REQUIRE(sim.get_next_gate_index() == 0);
+	sim.clear_state_file();
+	std::filesystem::remove(path);
+
+	// a file that isn't a state file is refused and left as it was
+	{
+		std::ofstream notes(path, std::ios::binary);
+		notes << "notes\n";
+	}
+	REQUIRE_FALSE(sim.set_state_file(path));
+	REQUIRE_FALSE(sim.is_state_mapped());
+	REQUIRE(std::filesystem::file_size(path) == 6);
+	sim.run(1);
+	REQUIRE(sim.get_next_gate_index() == program.get_operations().size());
+	REQUIRE(std::filesystem::file_size(path) == 6);
+	std::filesystem::remove(path);
+}
+
+TEST_CASE("QSim Factored Representation Matches Full Representation", "[qsim]")
+{
+	Quantum_Program program { "qbits 12\nh q0\nry q1 0.8\ncnot q0 q5\nrx q7 1.1\nswap q1 q9\nt q9\nh q11\ntoffoli q11 q9 q3\n"
+	                          "y q2\nrz q2 0.3\nh q4\ncnot q4 q6\nsdag q6\nh q6" };
+	REQUIRE(program.is_valid());
+
+	Observable const observable = {
+		{ 0.5, { { Pauli::Z, 0 }, { Pauli::Z, 5 } } },
+		{ -1.2, { { Pauli::X, 4 }, { Pauli::Y, 6 }, { Pauli::Z, 7 } } },
+		{ 0.8, { { Pauli::Y, 2 }, { Pauli::X, 11 }, { Pauli::Z, 3 } } },
+		{ 0.3, { { Pauli::X, 1 } } },
+	};
+
+	for (Precision precision : { Precision::DOUBLE, Precision::SINGLE }) {
+		QSim full_sim;
+		full_sim.set_precision(precision);
+		full_sim.set_program(&program);
+		full_sim.run(1);
+
+		QSim factored_sim;
+		factored_sim.set_precision(precision);
+		factored_sim.set_representation(Representation::FACTORED);
+		REQUIRE(factored_sim.get_representation() == Representation::FACTORED);
+		factored_sim.set_program(&program);
+		factored_sim.run(1);
+
+		std::vector<Amplitude> const full_amplitudes = full_sim.get_amplitudes();
+		std::vector<Amplitude> const factored_amplitudes = factored_sim.get_amplitudes();
+		REQUIRE(factored_amplitudes.size() == full_amplitudes.size());
+		for (size_t index = 0; index < full_amplitudes.size(); ++index) {
+			REQUIRE(factored_amplitudes[index].state == full_amplitudes[index].state);
+			REQUIRE(std::abs(factored_amplitudes[index].amplitude - full_amplitudes[index].amplitude) < 1e-5);
+		}
+
+		REQUIRE(factored_sim.get_qbit_groups() == full_sim.get_qbit_groups());
+		for (uint16_t qbit = 0; qbit < 12; ++qbit) {
+			std::array<std::complex<double>, 2> const full_state = full_sim.get_qbit_state(qbit);
+			std::array<std::complex<double>, 2> const factored_state = factored_sim.get_qbit_state(qbit);
+			REQUIRE(std::abs(full_state[0] - factored_state[0]) < 1e-5);
+			REQUIRE(std::abs(full_state[1] - factored_state[1]) < 1e-5);
+		}
+		REQUIRE(std::abs(factored_sim.compute_expectation(observable) - full_sim.compute_expectation(observable)) < 1e-5);
+	}
+}
+
+TEST_CASE("QSim Factored Representation Samples Independent Groups", "[qsim]")
+{
+	// a wide register of pairs, which would need 2^30 amplitudes in the full representation
+	std::string source = "qbits 30\n";
+	for (int pair = 0; pair < 15; ++pair) {
+		source += "h q" + std::to_string(pair * 2) + "\ncnot q" + std::to_string(pair * 2) + " q" + std::to_string((pair * 2) + 1) + "\n";
+	}
+	Quantum_Program program { source };
+	REQUIRE(program.is_valid());
+
+	QSim sim(4);
+	sim.set_representation(Representation::FACTORED);
+	sim.set_program(&program);
+	int const num_runs = 100000;
+	sim.run(num_runs);
+
+	REQUIRE(sim.get_qbit_groups().size() == 15);
+	REQUIRE(std::abs(sim.compute_expectation({ { 1.0, { { Pauli::Z, 4 }, { Pauli::Z, 5 } } } }) - 1.0) < 1e-9);
+	REQUIRE(std::abs(sim.compute_expectation({ { 1.0, { { Pauli::X, 0 }, { Pauli::X, 1 }, { Pauli::X, 28 }, { Pauli::X, 29 } } } }) - 1.0) < 1e-9);
+
+	// each pair of qbits is sampled as both zero or both one, independently of the other pairs
+	uint32_t total_runs = 0;
+	uint32_t first_qbit_ones = 0;
+	for (auto const &result : sim.get_results()) {
+		for (int pair = 0; pair < 15; ++pair) {
+			uint64_t const pair_bits = (result.state >> (28 - (pair * 2))) & 0b11;
+			REQUIRE((pair_bits == 0b00 || pair_bits == 0b11));
+		}
+		total_runs += result.num_times;
+		first_qbit_ones += (result.state >> 29) & 1 ? result.num_times : 0;
+	}
+	REQUIRE(total_runs == num_runs);
+	REQUIRE(std::abs(((double)first_qbit_ones / num_runs) - 0.5) < 0.01);
+
+	// sampling is reproducible for a seed
+	std::vector<Result> const results = sim.get_results();
+	sim.set_seed(std::mt19937::default_seed);
+	sim.run(num_runs);
+	REQUIRE(sim.get_results().size() == results.size());
+	REQUIRE(std::equal(results.begin(), results.end(), sim.get_results().begin(), [](Result const &lhs, Result const &rhs) {
+		return lhs.state == rhs.state && lhs.num_times == rhs.num_times;
+	}));
+}
+
+TEST_CASE("QSim Stabilizer Representation Matches Full Representation", "[qsim]")
+{
+	// random Clifford programs, with every gate a tableau applies
+	std::mt19937 rng(11);
+	char const *const single_qbit_gates[] = { "h", "s", "sdag", "x", "y", "z", "i" };
+	for (int program_index = 0; program_index < 20; ++program_index) {
+		std::string source = "qbits 6\n";
+		for (int gate_index = 0; gate_index < 40; ++gate_index) {
+			int const first_qbit = (int)(rng() % 6);
+			int const second_qbit = (first_qbit + 1 + (int)(rng() % 5)) % 6;
+			switch (rng() % 4) {
+				case 0: source += "cnot q" + std::to_string(first_qbit) + " q" + std::to_string(second_qbit) + "\n"; break;
+				case 1: source += "swap q" + std::to_string(first_qbit) + " q" + std::to_string(second_qbit) + "\n"; break;
+				default: source += std::string(single_qbit_gates[rng() % 7]) + " q" + std::to_string(first_qbit) + "\n"; break;
+			}
+		}
+		Quantum_Program program { source };
+		REQUIRE(program.is_clifford());
+
+		QSim full_sim;
+		full_sim.set_program(&program);
+		full_sim.run(1);
+
+		QSim stabilizer_sim;
+		stabilizer_sim.set_representation(Representation::STABILIZER);
+		stabilizer_sim.set_program(&program);
+		stabilizer_sim.run(1);
+		REQUIRE(stabilizer_sim.get_active_representation() == Representation::STABILIZER);
+
+		// a tableau doesn't keep the global phase, so the amplitudes match up to one phase
+		std::vector<Amplitude> full_amplitudes = full_sim.get_amplitudes();
+		full_amplitudes.erase(std::remove_if(full_amplitudes.begin(), full_amplitudes.end(),
+		                                     [](Amplitude const &amplitude) { return std::abs(amplitude.amplitude) < 1e-9; }),
+		                      full_amplitudes.end());
+		std::vector<Amplitude> const stabilizer_amplitudes = stabilizer_sim.get_amplitudes();
+		REQUIRE(stabilizer_amplitudes.size() == full_amplitudes.size());
+		std::complex<double> const global_phase = full_amplitudes[0].amplitude / stabilizer_amplitudes[0].amplitude;
+		REQUIRE(std::abs(std::abs(global_phase) - 1.0) < 1e-9);
+		for (size_t index = 0; index < full_amplitudes.size(); ++index) {
+			REQUIRE(stabilizer_amplitudes[index].state == full_amplitudes[index].state);
+			REQUIRE(std::abs((stabilizer_amplitudes[index].amplitude * global_phase) - full_amplitudes[index].amplitude) < 1e-9);
+		}
+
+		REQUIRE(stabilizer_sim.get_qbit_groups() == full_sim.get_qbit_groups());
+		// a tableau gives each qbit's probabilities, which are summed from the full amplitudes here
+		for (uint16_t qbit = 0; qbit < 6; ++qbit) {
+			std::array<double, 2> probabilities = { 0.0, 0.0 };
+			for (auto const &amplitude : full_amplitudes) {
+				probabilities[(amplitude.state >> (5 - qbit)) & 1] += std::norm(amplitude.amplitude);
+			}
+			std::array<std::complex<double>, 2> const stabilizer_state = stabilizer_sim.get_qbit_state(qbit);
+			REQUIRE(std::abs(std::norm(stabilizer_state[0]) - probabilities[0]) < 1e-9);
+			REQUIRE(std::abs(std::norm(stabilizer_state[1]) - probabilities[1]) < 1e-9);
+		}
+
+		// terms of up to three factors, which may repeat a qbit
+		Observable observable;
+		for (int term_index = 0; term_index < 10; ++term_index) {
+			Pauli_Term term = { (double)(term_index + 1) / 10.0, {} };
+			size_t const num_factors = rng() % 4;
+			for (size_t factor = 0; factor < num_factors; ++factor) {
+				term.factors.push_back({ (Pauli)(rng() % 3), (uint16_t)(rng() % 6) });
+			}
+			observable.push_back(term);
+		}
+		REQUIRE(std::abs(stabilizer_sim.compute_expectation(observable) - full_sim.compute_expectation(observable)) < 1e-9);
+	}
+}
+
+TEST_CASE("QSim Stabilizer Representation Falls Back For Other Programs", "[qsim]")
+{
+	Quantum_Program program { "h q0\nt q0\ncnot q0 q1" };
+	REQUIRE(!program.is_clifford());
+
+	QSim sim;
+	sim.set_representation(Representation::STABILIZER);
+	sim.set_program(&program);
+	sim.run(1);
+	REQUIRE(sim.get_representation() == Representation::STABILIZER);
+	REQUIRE(sim.get_active_representation() == Representation::FULL);
+	REQUIRE(sim.get_amplitudes().size() == 2);
+}
+
+TEST_CASE("QSim Stabilizer Representation Samples Wide Registers", "[qsim]")
+{
+	// a GHZ state over a register far too wide for a state vector, which always runs on a tableau
+	std::string source = "qbits 64\nh q0\n";
+	for (int qbit = 1; qbit < 64; ++qbit) {
+		source += "cnot q" + std::to_string(qbit - 1) + " q" + std::to_string(qbit) + "\n";
+	}
+	source += "x q63\n";
+	Quantum_Program program { source };
+	REQUIRE(program.is_valid());
+
+	QSim sim(4);
+	sim.set_program(&program);
+	REQUIRE(sim.get_active_representation() == Representation::STABILIZER);
+	int const num_runs = 100000;
+	sim.run(num_runs);
+
+	REQUIRE(sim.get_results().size() == 2);
+	REQUIRE(sim.get_results()[0].state == 1);
+	REQUIRE(sim.get_results()[1].state == ~(uint64_t)1);
+	REQUIRE(sim.get_results()[0].num_times + sim.get_results()[1].num_times == num_runs);
+	REQUIRE(std::abs(((double)sim.get_results()[0].num_times / num_runs) - 0.5) < 0.01);
+	REQUIRE(sim.get_qbit_groups().size() == 1);
+
+	REQUIRE(std::abs(sim.compute_expectation({ { 1.0, { { Pauli::Z, 0 }, { Pauli::Z, 63 } } } }) + 1.0) < 1e-9);
+	REQUIRE(std::abs(sim.compute_expectation({ { 1.0, { { Pauli::Z, 5 } } } })) < 1e-9);
+	std::vector<Amplitude> const amplitudes = sim.get_amplitudes();
+	REQUIRE(amplitudes.size() == 2);
+	REQUIRE(std::abs(std::abs(amplitudes[0].amplitude) - CONST_SQRT1_2) < 1e-9);
+	REQUIRE(std::abs(std::abs(sim.get_qbit_state(40)[1]) - CONST_SQRT1_2) < 1e-9);
+
+	// snapshots hold the tableau
+	QSim_Snapshot snapshot;
+	sim.seek(10);
+	sim.save_snapshot(snapshot);
+	sim.seek(64);
+	REQUIRE(sim.restore_snapshot(snapshot));
+	REQUIRE(sim.get_next_gate_index() == 10);
+	REQUIRE(sim.get_amplitudes().size() == 2);
+	REQUIRE(sim.get_qbit_groups().size() == 55);
+}
+
+TEST_CASE("QSim Stabilizer Representation Samples Registers Wider Than A State Index", "[qsim]")
+{
+	// a GHZ state over 1000 qbits, with the last qbit flipped
+	std::string source = "qbits 1000\nh q0\n";
+	for (int qbit = 1; qbit < 1000; ++qbit) {
+		source += "cnot q" + std::to_string(qbit - 1) + " q" + std::to_string(qbit) + "\n";
+	}
+	source += "x q999\n";
+	Quantum_Program program { source };
+	REQUIRE(program.is_valid());
+
+	QSim sim(4);
+	sim.set_program(&program);
+	REQUIRE(sim.get_active_representation() == Representation::STABILIZER);
+	int const num_runs = 100000;
+	sim.run(num_runs);
+
+	// only the wide results can hold the states, and the one with qbit 0 clear comes first
+	REQUIRE(sim.get_results().empty());
+	std::vector<Wide_Result> const &results = sim.get_wide_results();
+	REQUIRE(results.size() == 2);
+	for (size_t qbit = 0; qbit < 1000; ++qbit) {
+		REQUIRE(results[0].qbits[qbit] == (qbit == 999));
+		REQUIRE(results[1].qbits[qbit] == (qbit != 999));
+	}
+	REQUIRE(results[0].num_times + results[1].num_times == num_runs);
+	REQUIRE(std::abs(((double)results[0].num_times / num_runs) - 0.5) < 0.01);
+	REQUIRE(sim.get_qbit_groups().size() == 1);
+	REQUIRE(sim.get_amplitudes().empty());
+	REQUIRE(std::abs(std::norm(sim.get_qbit_state(700)[1]) - 0.5) < 1e-9);
+	REQUIRE(std::abs(sim.compute_expectation({ { 1.0, { { Pauli::Z, 3 }, { Pauli::Z, 999 } } } }) + 1.0) < 1e-9);
+	REQUIRE(std::abs(sim.compute_expectation({ { 1.0, { { Pauli::Z, 500 }, { Pauli::Z, 700 } } } }) - 1.0) < 1e-9);
+}
+
+TEST_CASE("QSim Stabilizer Representation Reads Qbits Of Wide Supports", "[qsim]")
+{
+	// too many basis states to list, while each qbit's state still comes straight from the tableau
+	std::string source = "qbits 40\n";
+	for (int qbit = 0; qbit < 30; ++qbit) {
+		source += "h q" + std::to_string(qbit) + "\n";
+	}
+	source += "x q35\n";
+	Quantum_Program program { source };
+	REQUIRE(program.is_valid());
+
+	QSim sim;
+	sim.set_program(&program);
+	sim.run(1);
+	REQUIRE(sim.get_active_representation() == Representation::STABILIZER);
+	REQUIRE(sim.get_amplitudes().empty());
+	for (uint16_t qbit = 0; qbit < 40; ++qbit) {
+		std::array<std::complex<double>, 2> const qbit_state = sim.get_qbit_state(qbit);
+		double const one_probability = qbit < 30 ? 0.5 : (qbit == 35 ? 1.0 : 0.0);
+		REQUIRE(std::abs(std::norm(qbit_state[1]) - one_probability) < 1e-9);
+		REQUIRE(std::abs(std::norm(qbit_state[0]) - (1.0 - one_probability)) < 1e-9);
+	}
+}
@@ -0,0 +1,150 @@
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "catch2/catch_test_macros.hpp"
+#include "fusion.h"
+#include "qasm.h"
+#include "qsim.h"
+#include "schedule.h"
+
+static Fused_Operation make_gate(Gate gate, std::vector<uint16_t> operands)
+{
+	Fused_Operation fused = { Fused_Kind::GATE, { gate, { 0, 0, 0 }, 0.0 } };
+	std::copy(operands.begin(), operands.end(), fused.operation.operands.begin());
+	std::sort(operands.begin(), operands.end());
+	fused.qbits = operands;
+	if (operands.size() > 1) {
+		fused.entangled_qbits.push_back(operands);
+	}
+	return fused;
+}
+
+static size_t count_sweeps(std::vector<Gate_Pass> const &passes)
+{
+	size_t num_sweeps = 0;
+	for (auto const &pass : passes) {
+		num_sweeps += pass.is_blocked ? 1 : pass.operations.size();
+	}
+	return num_sweeps;
+}
+
+TEST_CASE("Schedule Groups Gates On Low Qbits", "[schedule]")
+{
+	// with 4 of 10 qbits in a block, q6 to q9 are low
+	std::vector<Fused_Operation> const operations = {
+		make_gate(Gate::HADAMARD, { 9 }), make_gate(Gate::CNOT, { 9, 8 }), make_gate(Gate::PAULI_X, { 6 }),
+		make_gate(Gate::HADAMARD, { 0 }), make_gate(Gate::HADAMARD, { 7 }),
+	};
+	std::vector<Gate_Pass> const passes = schedule_operations(operations, 10, 4);
+	REQUIRE(passes.size() == 3);
+	REQUIRE(passes[0].is_blocked);
+	REQUIRE(passes[0].operations.size() == 3);
+	REQUIRE_FALSE(passes[1].is_blocked);
+	REQUIRE(passes[1].operations[0].qbits == std::vector<uint16_t> { 0 });
+	REQUIRE_FALSE(passes[2].is_blocked);
+}
+
+TEST_CASE("Schedule Moves Busy High Qbits Low", "[schedule]")
+{
+	// q0 is used by every gate, so it is swapped into a block for them and back at the end
+	std::vector<Fused_Operation> operations;
+	for (uint8_t gate = 0; gate < 12; ++gate) {
+		operations.push_back(make_gate(Gate::HADAMARD, { 0 }));
+		operations.push_back(make_gate(Gate::CNOT, { 0, (uint16_t)(8 + (gate % 2)) }));
+	}
+	std::vector<Gate_Pass> const passes = schedule_operations(operations, 10, 4);
+	REQUIRE(count_sweeps(passes) < count_sweeps(schedule_operations(operations, 10, 0)));
+	REQUIRE(passes.size() == 3);
+	REQUIRE(passes.front().operations[0].operation.gate == Gate::SWAP);
+	REQUIRE(passes.front().operations[0].entangled_qbits.empty());
+	REQUIRE(passes[1].is_blocked);
+	REQUIRE(passes.back().operations[0].qbits == passes.front().operations[0].qbits);
+
+	// the moved gates still name the program's qbits for entanglement tracking
+	for (auto const &operation : passes[1].operations) {
+		for (auto const &entangled_qbits : operation.entangled_qbits) {
+			REQUIRE(entangled_qbits[0] == 0);
+		}
+	}
+}
+
+TEST_CASE("Schedule Leaves Rarely Used High Qbits In Place", "[schedule]")
+{
+	std::vector<Fused_Operation> const operations = {
+		make_gate(Gate::HADAMARD, { 9 }), make_gate(Gate::HADAMARD, { 0 }), make_gate(Gate::HADAMARD, { 8 }),
+		make_gate(Gate::HADAMARD, { 9 }),
+	};
+	std::vector<Gate_Pass> const passes = schedule_operations(operations, 10, 4);
+	REQUIRE(std::none_of(passes.begin(), passes.end(), [](Gate_Pass const &pass) {
+		return pass.operations[0].kind == Fused_Kind::GATE && pass.operations[0].operation.gate == Gate::SWAP;
+	}));
+}
+
+// Runs the program in blocks of 2^block_qbits amplitudes and as one sweep per fused operation, in both precisions, and
+// expects them to reach the same state.
+static void require_blocked_runs_match(Quantum_Program const &program, size_t block_qbits)
+{
+	REQUIRE(program.is_valid());
+	for (Precision precision : { Precision::DOUBLE, Precision::SINGLE }) {
+		QSim blocked_sim(4);
+		blocked_sim.set_precision(precision);
+		blocked_sim.set_cache_block_qbits(block_qbits);
+		blocked_sim.set_program(&program);
+		blocked_sim.run(1);
+		QSim sim;
+		sim.set_precision(precision);
+		sim.set_cache_block_qbits(0);
+		sim.set_program(&program);
+		sim.run(1);
+
+		std::vector<Amplitude> const blocked_amplitudes = blocked_sim.get_amplitudes();
+		std::vector<Amplitude> const amplitudes = sim.get_amplitudes();
+		REQUIRE(blocked_amplitudes.size() == amplitudes.size());
+		for (size_t index = 0; index < amplitudes.size(); ++index) {
+			REQUIRE(blocked_amplitudes[index].state == amplitudes[index].state);
+			REQUIRE(std::abs(blocked_amplitudes[index].amplitude - amplitudes[index].amplitude) < 1e-6);
+		}
+		REQUIRE(blocked_sim.get_qbit_groups() == sim.get_qbit_groups());
+	}
+}
+
+TEST_CASE("Cache Blocked Runs Match Unblocked Runs", "[schedule]")
+{
+	// random programs over 12 qbits, with blocks of 16 amplitudes, so most gates straddle blocks
+	std::mt19937 rng(7);
+	for (int program_index = 0; program_index < 8; ++program_index) {
+		std::string source = "qbits 12\n";
+		for (int gate = 0; gate < 80; ++gate) {
+			std::string const first = "q" + std::to_string(rng() % 12);
+			std::string second = "q" + std::to_string(rng() % 12);
+			while (second == first) {
+				second = "q" + std::to_string(rng() % 12);
+			}
+			switch (rng() % 6) {
+				case 0: source += "h " + first + "\n"; break;
+				case 1: source += "ry " + first + " 0." + std::to_string(rng() % 100) + "\n"; break;
+				case 2: source += "t " + first + "\n"; break;
+				case 3: source += "cnot " + first + " " + second + "\n"; break;
+				case 4: source += "swap " + first + " " + second + "\n"; break;
+				case 5: source += (first == "q11" ? "cnot q10 " : "cnot q11 ") + first + "\n"; break;
+			}
+		}
+		require_blocked_runs_match(Quantum_Program { source }, 4);
+	}
+
+	// q0 is moved into the blocks for the gates linking it to the last qbits
+	std::string source = "qbits 12\n";
+	for (int gate = 0; gate < 24; ++gate) {
+		source += "cnot q0 q" + std::to_string(8 + (gate % 4)) + "\nry q" + std::to_string(8 + ((gate + 2) % 4)) + " 0." +
+		          std::to_string(gate + 1) + "\nh q0\n" + (gate % 8 == 0 ? "h q3\n" : "");
+	}
+	Quantum_Program const program { source };
+	REQUIRE(program.is_valid());
+	std::vector<Gate_Pass> const passes = schedule_operations(fuse_operations(program.get_operations()), 12, 5);
+	REQUIRE(std::any_of(passes.begin(), passes.end(), [](Gate_Pass const &pass) {
+		return pass.operations[0].kind == Fused_Kind::GATE && pass.operations[0].operation.gate == Gate::SWAP;
+	}));
+	require_blocked_runs_match(program, 5);
+}
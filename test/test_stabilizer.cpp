@@ -0,0 +1,141 @@
+#include <vector>
+
+#include "catch2/catch_test_macros.hpp"
+#include "stabilizer.h"
+
+// Returns the X and Z words of a Pauli string over the tableau's qbits, with Y where a qbit is in both lists.
+static std::vector<uint64_t> make_words(size_t num_qbits, std::vector<size_t> const &qbits)
+{
+	std::vector<uint64_t> words((num_qbits + 63) / 64, 0);
+	for (size_t qbit : qbits) {
+		words[qbit / 64] |= (uint64_t)1 << (qbit % 64);
+	}
+	return words;
+}
+
+TEST_CASE("Stabilizer Tableau Spans Several Words", "[stabilizer]")
+{
+	// a GHZ state over qbits in different words of each row
+	size_t const num_qbits = 200;
+	Stabilizer_Tableau tableau;
+	tableau.reset(num_qbits);
+	tableau.apply_hadamard(0);
+	for (size_t qbit = 1; qbit < num_qbits; ++qbit) {
+		tableau.apply_cnot(qbit - 1, qbit);
+	}
+	tableau.apply_swap(5, 130);
+	tableau.apply_pauli_x(130);
+
+	std::vector<uint64_t> const none = make_words(num_qbits, {});
+	std::vector<uint64_t> const z_pair = make_words(num_qbits, { 3, 199 });
+	std::vector<uint64_t> const z_flipped_pair = make_words(num_qbits, { 3, 130 });
+	std::vector<uint64_t> const z_single = make_words(num_qbits, { 64 });
+	REQUIRE(tableau.get_expectation(none.data(), z_pair.data()) == 1);
+	REQUIRE(tableau.get_expectation(none.data(), z_flipped_pair.data()) == -1);
+	REQUIRE(tableau.get_expectation(none.data(), z_single.data()) == 0);
+
+	// X on every qbit swaps the two basis states, and turning two of them into Y negates the string
+	std::vector<size_t> every_qbit;
+	for (size_t qbit = 0; qbit < num_qbits; ++qbit) {
+		every_qbit.push_back(qbit);
+	}
+	std::vector<uint64_t> const x_all = make_words(num_qbits, every_qbit);
+	std::vector<uint64_t> const z_y_pair = make_words(num_qbits, { 70, 150 });
+	REQUIRE(tableau.get_expectation(x_all.data(), none.data()) == 1);
+	REQUIRE(tableau.get_expectation(x_all.data(), z_y_pair.data()) == -1);
+
+	// reading one bit of each row gives the same as a general string with a single Z
+	for (size_t qbit : { 0, 64, 130, 199 }) {
+		std::vector<uint64_t> const z_qbit = make_words(num_qbits, { qbit });
+		REQUIRE(tableau.get_z_expectation(qbit) == tableau.get_expectation(none.data(), z_qbit.data()));
+	}
+
+	tableau.apply_phase(0);
+	REQUIRE(tableau.get_expectation(x_all.data(), none.data()) == 0);
+	tableau.apply_phase_dag(0);
+	tableau.apply_pauli_z(199);
+	REQUIRE(tableau.get_expectation(x_all.data(), none.data()) == -1);
+}
+
+TEST_CASE("Stabilizer Tableau Reads Single Qbits", "[stabilizer]")
+{
+	// |0>, |1>, |+> and a Bell pair with a phase, whose qbits are each equally likely to be 0 or 1
+	Stabilizer_Tableau tableau;
+	tableau.reset(5);
+	tableau.apply_pauli_x(1);
+	tableau.apply_hadamard(2);
+	tableau.apply_hadamard(3);
+	tableau.apply_cnot(3, 4);
+	tableau.apply_phase(4);
+	REQUIRE(tableau.get_z_expectation(0) == 1);
+	REQUIRE(tableau.get_z_expectation(1) == -1);
+	REQUIRE(tableau.get_z_expectation(2) == 0);
+	REQUIRE(tableau.get_z_expectation(3) == 0);
+	REQUIRE(tableau.get_z_expectation(4) == 0);
+
+	// undoing the pair leaves its qbits certain again
+	tableau.apply_phase_dag(4);
+	tableau.apply_cnot(3, 4);
+	tableau.apply_hadamard(3);
+	tableau.apply_pauli_y(4);
+	REQUIRE(tableau.get_z_expectation(3) == 1);
+	REQUIRE(tableau.get_z_expectation(4) == -1);
+}
+
+TEST_CASE("Stabilizer Tableau Support Lists Basis States", "[stabilizer]")
+{
+	// |+> on qbit 0, |1> on qbit 1 and a Bell pair with a phase on qbits 2 and 3
+	Stabilizer_Tableau tableau;
+	tableau.reset(4);
+	tableau.apply_hadamard(0);
+	tableau.apply_pauli_x(1);
+	tableau.apply_hadamard(2);
+	tableau.apply_cnot(2, 3);
+	tableau.apply_phase(3);
+
+	// qbit q is bit q of the first word
+	Stabilizer_Support const support = tableau.get_support();
+	REQUIRE(support.generators.size() == 2);
+	uint64_t const seed_state = support.seed_words[0];
+	REQUIRE((seed_state & 0b0010) == 0b0010);
+	uint64_t reachable = 0;
+	for (auto const &generator : support.generators) {
+		reachable |= generator.flip_words[0];
+	}
+	REQUIRE(reachable == 0b1101);
+	REQUIRE((seed_state & 0b1100) == ((seed_state >> 2) & 0b0001) * 0b1100);
+}
+
+TEST_CASE("Stabilizer Tableau Support Spans Several Words", "[stabilizer]")
+{
+	// Bell pairs across the words of a wide register, and one qbit set in the last word
+	size_t const num_qbits = 300;
+	Stabilizer_Tableau tableau;
+	tableau.reset(num_qbits);
+	for (size_t qbit = 0; qbit < 100; ++qbit) {
+		tableau.apply_hadamard(qbit);
+		tableau.apply_cnot(qbit, qbit + 150);
+	}
+	tableau.apply_pauli_x(299);
+
+	Stabilizer_Support const support = tableau.get_support();
+	REQUIRE(support.seed_words.size() == 5);
+	REQUIRE(support.generators.size() == 100);
+	std::vector<uint64_t> reachable(5, 0);
+	for (auto const &generator : support.generators) {
+		for (size_t word = 0; word < 5; ++word) {
+			reachable[word] |= generator.flip_words[word];
+		}
+	}
+	for (size_t qbit = 0; qbit < num_qbits; ++qbit) {
+		bool const is_reachable = (reachable[qbit / 64] >> (qbit % 64)) & 1;
+		bool const is_seed_set = (support.seed_words[qbit / 64] >> (qbit % 64)) & 1;
+		REQUIRE(is_reachable == (qbit < 100 || (qbit >= 150 && qbit < 250)));
+		if (!is_reachable) {
+			REQUIRE(is_seed_set == (qbit == 299));
+		}
+		if (qbit < 100) {
+			REQUIRE(is_seed_set == (bool)((support.seed_words[(qbit + 150) / 64] >> ((qbit + 150) % 64)) & 1));
+		}
+	}
+}
@@ -0,0 +1,81 @@
+#include <algorithm>
+#include <string>
+
+#include "catch2/catch_test_macros.hpp"
+#include "qasm.h"
+#include "qsim.h"
+#include "sweep.h"
+
+static bool results_match(std::vector<Result> const &lhs, std::vector<Result> const &rhs)
+{
+	return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin(), [](Result const &lhs, Result const &rhs) {
+		return lhs.state == rhs.state && lhs.num_times == rhs.num_times;
+	});
+}
+
+TEST_CASE("Sweep Matches Programs With Literal Angles", "[sweep]")
+{
+	Quantum_Program program { "h q0\nrx q1 theta\ncnot q0 q1\nry q2 phi\nrz q1 theta\ncnot q1 q2" };
+	REQUIRE(program.is_valid());
+	REQUIRE(program.get_parameter_names().size() == 2);
+
+	std::vector<std::vector<double>> const bindings = { { 0.0, 0.0 }, { 0.3, 1.2 }, { -2.0, 0.7 }, { 3.1, -0.4 }, { 1.0 } };
+	Sweep_Options options;
+	options.num_runs = 1000;
+	options.num_threads = 3;
+	options.keep_amplitudes = true;
+	std::vector<Sweep_Result> const sweep_results = run_sweep(program, bindings, options);
+	REQUIRE(sweep_results.size() == bindings.size());
+
+	for (size_t binding = 0; binding < bindings.size(); ++binding) {
+		// missing values are bound to zero
+		double const theta = bindings[binding][0];
+		double const phi = bindings[binding].size() > 1 ? bindings[binding][1] : 0.0;
+		Quantum_Program literal_program { "h q0\nrx q1 " + std::to_string(theta) + "\ncnot q0 q1\nry q2 " + std::to_string(phi) +
+		                                  "\nrz q1 " + std::to_string(theta) + "\ncnot q1 q2" };
+		REQUIRE(literal_program.is_valid());
+
+		QSim sim;
+		sim.set_seed(options.seed + binding);
+		sim.set_program(&literal_program);
+		sim.run(options.num_runs);
+
+		std::vector<Amplitude> const expected_amplitudes = sim.get_amplitudes();
+		std::vector<Amplitude> const &amplitudes = sweep_results[binding].amplitudes;
+		REQUIRE(amplitudes.size() == expected_amplitudes.size());
+		for (size_t index = 0; index < amplitudes.size(); ++index) {
+			REQUIRE(amplitudes[index].state == expected_amplitudes[index].state);
+			REQUIRE(std::abs(amplitudes[index].amplitude - expected_amplitudes[index].amplitude) < 1e-5);
+		}
+	}
+}
+
+TEST_CASE("Sweep Results Do Not Depend On Threads", "[sweep]")
+{
+	Quantum_Program program { "ry q0 a\nry q1 b\ncnot q0 q2\nrx q2 a" };
+	REQUIRE(program.is_valid());
+
+	std::vector<std::vector<double>> bindings;
+	for (int binding = 0; binding < 16; ++binding) {
+		bindings.push_back({ binding * 0.2, 1.0 - (binding * 0.1) });
+	}
+
+	Sweep_Options options;
+	options.num_runs = 5000;
+	std::vector<Sweep_Result> const serial_results = run_sweep(program, bindings, options);
+	options.num_threads = 4;
+	std::vector<Sweep_Result> const threaded_results = run_sweep(program, bindings, options);
+
+	for (size_t binding = 0; binding < bindings.size(); ++binding) {
+		REQUIRE(serial_results[binding].amplitudes.empty());
+		REQUIRE(results_match(serial_results[binding].results, threaded_results[binding].results));
+	}
+
+	// a parameterised program can also be bound directly on a simulator
+	QSim sim;
+	sim.set_program(&program);
+	sim.set_seed(options.seed + 5);
+	sim.set_parameters(bindings[5]);
+	sim.run(options.num_runs);
+	REQUIRE(results_match(sim.get_results(), serial_results[5].results));
+}